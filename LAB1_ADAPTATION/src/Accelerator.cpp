@@ -0,0 +1,225 @@
+#include "Accelerator.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+namespace ML {
+
+AcceleratorConfig AcceleratorConfig::parse(const std::string& text) {
+    AcceleratorConfig config;
+    std::istringstream iss(text);
+    std::string item;
+    while (std::getline(iss, item, ',')) {
+        const std::size_t eq = item.find('=');
+        if (eq == std::string::npos) throw std::runtime_error("Accelerator option `" + item + "` is not key=value");
+        const std::string key = item.substr(0, eq), value = item.substr(eq + 1);
+        if (key == "bus") {
+            config.busBytes = std::stoul(value);
+        } else if (key == "fifo") {
+            config.fifoDepth = std::stoul(value);
+        } else if (key == "lanes") {
+            config.lanes = std::stoul(value);
+        } else if (key == "wbuf") {
+            config.weightBufferBytes = std::stoul(value);
+        } else if (key == "mac") {
+            if (value != "pipelined" && value != "staged") throw std::runtime_error("Accelerator MAC is pipelined or staged, not " + value);
+            config.pipelined = value == "pipelined";
+        } else if (key == "stages") {
+            config.macStages = std::stoul(value);
+        } else if (key == "result") {
+            config.resultCycles = std::stoul(value);
+        } else if (key == "mhz") {
+            config.clockMHz = std::stod(value);
+        } else {
+            throw std::runtime_error("Unknown accelerator option: " + key);
+        }
+    }
+    return config;
+}
+
+std::string AcceleratorConfig::str() const {
+    std::ostringstream out;
+    out << "bus=" << busBytes << ",fifo=" << fifoDepth << ",lanes=" << lanes << ",wbuf=" << weightBufferBytes
+        << ",mac=" << (pipelined ? "pipelined" : "staged") << ",stages=" << macStages << ",result=" << resultCycles << ",mhz=" << clockMHz;
+    return out.str();
+}
+
+AcceleratorStats& AcceleratorStats::operator+=(const AcceleratorStats& other) {
+    transactions += other.transactions;
+    weightLoads += other.weightLoads;
+    macs += other.macs;
+    beats += other.beats;
+    bytesIn += other.bytesIn;
+    payloadBytes += other.payloadBytes;
+    bytesOut += other.bytesOut;
+    cycles += other.cycles;
+    fifoStalls += other.fifoStalls;
+    macIdle += other.macIdle;
+    return *this;
+}
+
+AcceleratorStats AcceleratorStats::operator-(const AcceleratorStats& other) const {
+    AcceleratorStats diff;
+    diff.transactions = transactions - other.transactions;
+    diff.weightLoads = weightLoads - other.weightLoads;
+    diff.macs = macs - other.macs;
+    diff.beats = beats - other.beats;
+    diff.bytesIn = bytesIn - other.bytesIn;
+    diff.payloadBytes = payloadBytes - other.payloadBytes;
+    diff.bytesOut = bytesOut - other.bytesOut;
+    diff.cycles = cycles - other.cycles;
+    diff.fifoStalls = fifoStalls - other.fifoStalls;
+    diff.macIdle = macIdle - other.macIdle;
+    return diff;
+}
+
+MacAccelerator::MacAccelerator(const AcceleratorConfig& config) { configure(config); }
+
+MacAccelerator& MacAccelerator::shared() {
+    static MacAccelerator device;
+    return device;
+}
+
+void MacAccelerator::configure(const AcceleratorConfig& newConfig) {
+    if (newConfig.busBytes == 0 || newConfig.fifoDepth == 0 || newConfig.lanes == 0 || newConfig.macStages == 0) {
+        throw std::runtime_error("Accelerator bus width, FIFO depth, lanes and MAC stages must be at least 1");
+    }
+    packer = StreamPacker(newConfig.lanes);
+    config = newConfig;
+    fifo.assign(config.fifoDepth * config.busBytes, 0);
+    consumeTimes.assign(config.fifoDepth, 0);
+    laneActivations.assign(config.fifoDepth * config.busBytes, 0);
+    laneWeights.assign(config.lanes * config.fifoDepth * config.busBytes, 0);
+    residentLength = 0;
+}
+
+void MacAccelerator::loadWeights(const i8* weights, std::size_t length) {
+    const std::size_t bytes = config.lanes * length;
+    if (bytes > config.weightBufferBytes) throw std::runtime_error("Accelerator weight tile does not fit the weight buffer");
+
+    // Streamed at a beat per cycle straight into the buffer, the MAC is idle meanwhile
+    weightBuffer.assign(weights, weights + bytes);
+    residentLength = length;
+
+    const ui64 beats = (bytes + config.busBytes - 1) / config.busBytes;
+    stats.weightLoads++;
+    stats.beats += beats;
+    stats.bytesIn += beats * config.busBytes;
+    stats.payloadBytes += bytes;
+    stats.cycles += beats;
+}
+
+void MacAccelerator::resetStream() { streamBeats = lastPush = lastConsume = 0; }
+
+// The stream pushes a beat per cycle unless the FIFO is full, a slot frees the cycle after the MAC took the beat
+// fifoDepth beats earlier; the MAC takes a beat one cycle after it was pushed, at most one per `interval` cycles
+void MacAccelerator::pushBeat() {
+    const ui64 interval = config.pipelined ? 1 : config.macStages;
+    const std::size_t slot = streamBeats % config.fifoDepth;
+
+    const ui64 ready = streamBeats ? lastPush + 1 : 0;
+    const ui64 room = streamBeats >= config.fifoDepth ? consumeTimes[slot] + 1 : 0;
+    const ui64 push = std::max(ready, room);
+    stats.fifoStalls += push - ready;
+
+    const ui64 earliest = streamBeats ? lastConsume + interval : 0;
+    const ui64 consume = std::max(push + 1, earliest);
+    if (streamBeats) stats.macIdle += consume - earliest;
+
+    consumeTimes[slot] = consume;
+    lastPush = push;
+    lastConsume = consume;
+    streamBeats++;
+}
+
+void MacAccelerator::multiply(const ui8* stream, std::size_t length, bool resident, i32* results) {
+    if (resident && length != residentLength) throw std::runtime_error("Accelerator multiply expects resident weights that were not loaded");
+
+    // Whole elements per beat, the rest of the beat is padding
+    const std::size_t lanes = config.lanes;
+    const std::size_t stride = resident ? 1 : packer.stride();
+    const std::size_t perBeat = config.busBytes / stride;
+    if (perBeat == 0) throw std::runtime_error("Accelerator beat too narrow for " + std::to_string(lanes) + " streamed lanes");
+    const std::size_t beats = (length + perBeat - 1) / perBeat;
+    const bool contiguous = config.busBytes % stride == 0;  // Consecutive beats are the packed stream again
+
+    std::fill(results, results + lanes, 0);
+    resetStream();
+    for (std::size_t first = 0; first < beats; first += config.fifoDepth) {
+        const std::size_t count = std::min(config.fifoDepth, beats - first);
+        const std::size_t k0 = first * perBeat, elements = std::min(count * perBeat, length - k0);
+
+        // Producer: copy up to a FIFO's worth of beats out of the stream, zero padding each
+        for (std::size_t b = 0; b < count; b++) {
+            ui8* beat = fifo.data() + b * config.busBytes;
+            const std::size_t bytes = (std::min(perBeat, elements - b * perBeat)) * stride;
+            std::memcpy(beat, stream + (k0 + b * perBeat) * stride, bytes);
+            std::memset(beat + bytes, 0, config.busBytes - bytes);
+            pushBeat();
+        }
+
+        // MAC lanes: unpack activations and lane weights, accumulate in int32 (integer sums, so bit-exact in any order)
+        const ui8* activations = fifo.data();
+        const i8* weights = laneWeights.data();
+        if (!resident) {
+            if (contiguous) {
+                packer.unpack(fifo.data(), elements, laneActivations.data(), laneWeights.data(), elements);
+            } else {
+                for (std::size_t b = 0; b < count; b++) {
+                    const std::size_t e = b * perBeat;
+                    packer.unpack(fifo.data() + b * config.busBytes, std::min(perBeat, elements - e), laneActivations.data() + e,
+                                  laneWeights.data() + e, elements);
+                }
+            }
+            activations = laneActivations.data();
+        }
+        for (std::size_t l = 0; l < lanes; l++) {
+            const i8* w = resident ? weightBuffer.data() + l * length + k0 : weights + l * elements;
+            i32 sum = 0;
+            for (std::size_t k = 0; k < elements; k++) sum += i32(activations[k]) * i32(w[k]);
+            results[l] += sum;
+        }
+    }
+
+    // Last beat through the MAC, then one result per lane on the output stream
+    stats.transactions++;
+    stats.macs += ui64(lanes) * length;
+    stats.beats += beats;
+    stats.bytesIn += ui64(beats) * config.busBytes;
+    stats.payloadBytes += ui64(length) * stride;
+    stats.bytesOut += ui64(lanes) * sizeof(i32);
+    stats.cycles += (beats ? lastConsume + config.macStages : 0) + lanes * config.resultCycles;
+}
+
+void AcceleratorWeights::load(const QuantizedWeights& weights, const AcceleratorConfig& config, const StreamPacker& packer) {
+    lanes = config.lanes;
+    length = weights.length;
+    tiles = (weights.outputs + lanes - 1) / lanes;
+    resident = lanes * length <= config.weightBufferBytes;
+    data.assign(tiles * tileBytes(), 0);
+
+    std::vector<i8> rows(resident ? 0 : lanes * length);
+    for (std::size_t t = 0; t < tiles; t++) {
+        const std::size_t count = std::min(lanes, weights.outputs - t * lanes);
+        const i8* source = weights.weights.data() + t * lanes * length;
+        ui8* destination = data.data() + t * tileBytes();
+        if (resident) {
+            std::memcpy(destination, source, count * length);
+        } else {
+            std::fill(rows.begin(), rows.end(), 0);
+            std::memcpy(rows.data(), source, count * length);
+            packer.packWeights(rows.data(), length, length, destination);
+        }
+    }
+}
+
+void AcceleratorWeights::clear() {
+    lanes = length = tiles = 0;
+    resident = false;
+    data.clear();
+    data.shrink_to_fit();
+}
+
+}  // namespace ML
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Packing.h"
+#include "Quantization.h"
+#include "Types.h"
+
+namespace ML {
+
+// Parameters of the planned AXI-Stream MAC unit on the ZedBoard fabric
+// The PS streams uint8 activations and int8 weights through an input FIFO of `fifoDepth` beats of `busBytes` each
+// (one beat per cycle while the FIFO has room). `lanes` MAC lanes produce one output each and share the activation
+// stream: with a weight buffer large enough for a tile of lanes weight rows the weights are loaded once per tile and
+// every beat carries busBytes activations, otherwise each activation byte travels with its `lanes` weight bytes
+// A pipelined MAC takes a beat every cycle after `macStages` cycles of latency, a staged one takes `macStages` cycles
+// per beat. Every lane returns its int32 sum over the output stream, requantization stays on the PS
+struct AcceleratorConfig {
+    std::size_t busBytes = 8;           // TDATA width
+    std::size_t fifoDepth = 16;         // Beats
+    std::size_t lanes = 1;              // MAC lanes, output channels per tile
+    std::size_t weightBufferBytes = 0;  // BRAM for resident weights, 0 streams every weight with its activation
+    bool pipelined = true;
+    std::size_t macStages = 3;          // Multiply, add, accumulate
+    std::size_t resultCycles = 1;       // Per int32 result on the output stream
+    double clockMHz = 100;              // Fabric clock the cycle counts are converted at
+
+    // Parse "bus=8,fifo=16,lanes=4,wbuf=65536,mac=staged|pipelined,stages=3,result=1,mhz=100" (any subset)
+    static AcceleratorConfig parse(const std::string& text);
+    std::string str() const;
+};
+
+// Traffic and timing the emulator accumulates (all counts since the last reset)
+struct AcceleratorStats {
+    ui64 transactions = 0;     // Activation streams, one per output pixel and lane tile
+    ui64 weightLoads = 0;      // Weight tiles loaded into the weight buffer
+    ui64 macs = 0;
+    ui64 beats = 0;            // Input stream beats, weight loads included
+    ui64 bytesIn = 0;          // beats * busBytes, padding of partial beats included
+    ui64 payloadBytes = 0;     // Operand bytes actually carried
+    ui64 bytesOut = 0;         // int32 results
+    ui64 cycles = 0;           // Estimated fabric cycles, transfers of consecutive transactions not overlapped
+    ui64 fifoStalls = 0;       // Cycles the stream had a beat ready but the FIFO was full
+    ui64 macIdle = 0;          // Cycles the MAC waited for a beat after its first
+
+    AcceleratorStats& operator+=(const AcceleratorStats& other);
+    AcceleratorStats operator-(const AcceleratorStats& other) const;
+};
+
+// Int8 weights of a Conv/Dense layer laid out for the accelerator once at load, per tile of `lanes` outputs (the last
+// tile zero padded): the [lanes][K] rows for the weight buffer when a tile fits it, otherwise the packed stream image
+// whose empty activation bytes StreamPacker::insertActivations fills per transaction
+struct AcceleratorWeights {
+    std::size_t lanes = 0, length = 0, tiles = 0;
+    bool resident = false;
+    std::vector<ui8> data;
+
+    void load(const QuantizedWeights& weights, const AcceleratorConfig& config, const StreamPacker& packer);
+    void clear();
+    inline bool matches(const AcceleratorConfig& config) const {
+        return lanes == config.lanes && resident == (lanes * length <= config.weightBufferBytes);
+    }
+
+    // Bytes of one tile and of the stream of one transaction (activations only when resident)
+    inline std::size_t tileBytes() const { return resident ? lanes * length : (lanes + 1) * length; }
+    inline std::size_t streamBytes() const { return resident ? length : (lanes + 1) * length; }
+    inline const ui8* tile(std::size_t t) const { return data.data() + t * tileBytes(); }
+};
+
+// Cycle-approximate software model of the MAC unit, bit-exact with the int8 kernels (dotU8S8)
+// The stream is copied into beats and unpacked by the MAC lanes, so packing layouts are exercised end to end
+// There is one device: layers hold lock() for the whole layer, which serializes concurrent models on it
+class MacAccelerator {
+   public:
+    explicit MacAccelerator(const AcceleratorConfig& config = AcceleratorConfig());
+
+    // Process-wide device the Conv/Dense ACCEL paths run on
+    static MacAccelerator& shared();
+
+    inline const AcceleratorConfig& getConfig() const { return config; }
+    inline const StreamPacker& getPacker() const { return packer; }
+    void configure(const AcceleratorConfig& newConfig);
+
+    inline std::mutex& lock() { return mutex; }
+    inline const AcceleratorStats& getStats() const { return stats; }
+    inline void resetStats() { stats = AcceleratorStats(); }
+
+    // Make one weight row of `length` bytes per lane (row l at weights + l * length) resident for the next multiplies
+    void loadWeights(const i8* weights, std::size_t length);
+
+    // results[l] = sum over k of activation k * weight k of lane l, for `length` elements of a packed stream
+    // The stream holds activations only when `resident` (weights from the last loadWeights), else stream words
+    void multiply(const ui8* stream, std::size_t length, bool resident, i32* results);
+
+   private:
+    // Beat timing of the current transaction: FIFO stalls, MAC idle cycles and when the MAC took the last beat
+    void resetStream();
+    void pushBeat();
+
+    AcceleratorConfig config;
+    StreamPacker packer{1};
+    AcceleratorStats stats;
+    std::mutex mutex;
+
+    std::vector<i8> weightBuffer;  // Resident rows, [lane][length]
+    std::size_t residentLength = 0;
+
+    std::vector<ui8> fifo;          // fifoDepth beats of busBytes
+    std::vector<ui8> laneActivations;  // MAC side unpacking of a FIFO's worth of elements
+    std::vector<i8> laneWeights;
+    std::vector<ui64> consumeTimes; // Cycle each beat in the FIFO window was taken by the MAC
+    ui64 streamBeats = 0, lastPush = 0, lastConsume = 0;
+};
+
+}  // namespace ML
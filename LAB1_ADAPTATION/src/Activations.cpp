@@ -0,0 +1,53 @@
+#include "Activations.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace ML {
+
+namespace {
+struct ConvertKernel {
+    const LayerData& in;
+    LayerData& out;
+
+    template <typename In, typename Out> ML_ISA_INLINE void operator()(In inCodec, Out outCodec) const {
+        const std::size_t count = in.getParams().flat_count();
+        const typename In::type* src = (const typename In::type*)in.raw();
+        typename Out::type* dst = (typename Out::type*)out.raw();
+        for (std::size_t i = 0; i < count; i++) dst[i] = outCodec.store(inCodec.load(src[i]));
+    }
+};
+}  // namespace
+
+void convertStorage(const LayerData& in, Layer::Storage inStorage, const QuantParams& inQuant, LayerData& out,
+                    Layer::Storage outStorage, const QuantParams& outQuant) {
+    withStorageCodecs(inStorage, inQuant, outStorage, outQuant, ConvertKernel{in, out});
+}
+
+void convertLayout(const LayerData& in, LayerData& out) {
+    const LayerParams& from = in.getParams();
+    const LayerParams& to = out.getParams();
+    if (from.dims != to.dims || from.elementSize != to.elementSize || from.dims.size() != 3) {
+        throw std::runtime_error("Layout conversion needs [H][W][C] activations of the same shape and element size");
+    }
+    const std::size_t H = from.dims[0], W = from.dims[1], C = from.dims[2], e = from.elementSize;
+    const std::size_t blockIn = from.channelBlock(), blockOut = to.channelBlock();
+    const char* src = (const char*)in.raw();
+    char* dst = (char*)out.raw();
+    if (to.flat_count() != H * W * C) std::memset(dst, 0, to.byte_size());
+
+    // Per pixel, copy the runs of channels that stay within one block on both sides
+    for (std::size_t h = 0; h < H; h++) {
+        for (std::size_t w = 0; w < W; w++) {
+            for (std::size_t c = 0; c < C;) {
+                const std::size_t n = std::min({blockIn - c % blockIn, blockOut - c % blockOut, C - c});
+                std::memcpy(dst + ((((c / blockOut) * H + h) * W + w) * blockOut + c % blockOut) * e,
+                            src + ((((c / blockIn) * H + h) * W + w) * blockIn + c % blockIn) * e, n * e);
+                c += n;
+            }
+        }
+    }
+}
+
+}  // namespace ML
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "CpuDispatch.h"
+#include "Half.h"
+#include "Quantization.h"
+#include "Types.h"
+#include "layers/Layer.h"
+
+namespace ML {
+
+// Codecs of the activation storage formats: load widens a stored element to fp32, store rounds an fp32 result into
+// the stored type. Kernels are templated on the codecs of their input and output so the choice costs nothing per element
+struct FP32Storage {
+    using type = fp32;
+    inline fp32 load(fp32 value) const { return value; }
+    inline fp32 store(fp32 value) const { return value; }
+};
+
+struct FP16Storage {
+    using type = fp16;
+    inline fp32 load(fp16 value) const { return halfToFloat(value); }
+    inline fp16 store(fp32 value) const { return floatToHalf(value); }
+};
+
+struct U8Storage {
+    using type = ui8;
+    QuantParams quant;
+
+    explicit U8Storage(const QuantParams& quant) : quant(quant) {}
+    inline fp32 load(ui8 value) const { return dequantize(value, quant); }
+    inline ui8 store(fp32 value) const { return quantize(value, quant); }
+};
+
+// Elements used as they are stored (fixed-point and int8 kernels that work on the raw values)
+template <typename T> struct RawStorage {
+    using type = T;
+    inline T load(T value) const { return value; }
+    inline T store(T value) const { return value; }
+};
+
+namespace detail {
+template <typename Kernel, typename In> void withOutputCodec(Layer::Storage storage, const QuantParams& quant, const Kernel& kernel, In in) {
+    switch (storage) {
+    case Layer::Storage::FP16:
+        return dispatchIsa(kernel, in, FP16Storage());
+    case Layer::Storage::U8:
+        return dispatchIsa(kernel, in, U8Storage(quant));
+    default:
+        return dispatchIsa(kernel, in, FP32Storage());
+    }
+}
+}  // namespace detail
+
+// Call kernel(inCodec, outCodec) with the codecs of the given input and output storage, in the variant compiled for
+// the active instruction set (dispatchIsa), so kernels declare their operator() and loop helpers ML_ISA_INLINE
+template <typename Kernel>
+void withStorageCodecs(Layer::Storage in, const QuantParams& inQuant, Layer::Storage out, const QuantParams& outQuant, const Kernel& kernel) {
+    switch (in) {
+    case Layer::Storage::FP16:
+        return detail::withOutputCodec(out, outQuant, kernel, FP16Storage());
+    case Layer::Storage::U8:
+        return detail::withOutputCodec(out, outQuant, kernel, U8Storage(inQuant));
+    default:
+        return detail::withOutputCodec(out, outQuant, kernel, FP32Storage());
+    }
+}
+
+// Same, with a layer's input and output storage and quantization
+template <typename Kernel> void withStorageCodecs(const Layer& layer, const Kernel& kernel) {
+    withStorageCodecs(layer.getInputStorage(), layer.getInputQuant(), layer.getOutputStorage(), layer.getOutputQuant(), kernel);
+}
+
+// Copy activations between storage formats (same element count)
+void convertStorage(const LayerData& in, Layer::Storage inStorage, const QuantParams& inQuant, LayerData& out,
+                    Layer::Storage outStorage, const QuantParams& outQuant);
+
+// Copy [H][W][C] activations between layouts (same dims and element size), zeroing the padding of a blocked output
+void convertLayout(const LayerData& in, LayerData& out);
+
+}  // namespace ML
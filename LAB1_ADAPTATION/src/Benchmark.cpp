@@ -0,0 +1,393 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+
+#include "Config.h"
+#include "Dataflow.h"
+#include "Packing.h"
+
+namespace ML {
+
+namespace {
+// Index of the most significant set bit (value must be non-zero)
+inline unsigned msb(ui64 value) { return 63 - __builtin_clzll(value); }
+
+// Evict caches and TLB entries by dirtying one byte per cache line of a buffer larger than the LLC
+void flushCaches(std::size_t bytes) {
+    static std::vector<ui8> buffer;
+    if (buffer.size() < bytes) buffer.resize(bytes);
+
+    volatile ui8* data = buffer.data();
+    for (std::size_t i = 0; i < bytes; i += Config::CACHE_LINE_SIZE) data[i] = data[i] + 1;
+}
+
+inline double toMs(ui64 ns) { return ns / 1e6; }
+}  // namespace
+
+LatencyHistogram::LatencyHistogram(unsigned subBucketBits) : subBucketBits(subBucketBits), counts((64 - subBucketBits + 1) << subBucketBits) {
+    reset();
+}
+
+void LatencyHistogram::reset() {
+    std::fill(counts.begin(), counts.end(), 0);
+    total = 0;
+    minValue = ~ui64(0);
+    maxValue = 0;
+    sum = 0;
+    sumSquares = 0;
+}
+
+// Values below 2^subBucketBits map 1:1, larger values keep their top subBucketBits bits
+std::size_t LatencyHistogram::bucketIndex(ui64 value) const {
+    if (value < (ui64(1) << subBucketBits)) return value;
+    const unsigned shift = msb(value) - subBucketBits + 1;
+    return (std::size_t(shift) << subBucketBits) | (value >> shift);
+}
+
+ui64 LatencyHistogram::bucketUpper(std::size_t index) const {
+    const unsigned shift = index >> subBucketBits;
+    const ui64 mantissa = index & ((ui64(1) << subBucketBits) - 1);
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(ui64 valueNs) {
+    counts[bucketIndex(valueNs)]++;
+    total++;
+    minValue = std::min(minValue, valueNs);
+    maxValue = std::max(maxValue, valueNs);
+    sum += double(valueNs);
+    sumSquares += double(valueNs) * double(valueNs);
+}
+
+double LatencyHistogram::mean() const { return total ? sum / total : 0; }
+
+double LatencyHistogram::stddev() const {
+    if (total < 2) return 0;
+    const double m = mean();
+    return std::sqrt(std::max(0.0, sumSquares / total - m * m));
+}
+
+ui64 LatencyHistogram::percentile(double percent) const {
+    if (total == 0) return 0;
+    const ui64 target = std::max<ui64>(1, ui64(std::ceil(percent / 100.0 * total)));
+
+    ui64 seen = 0;
+    for (std::size_t i = 0; i < counts.size(); i++) {
+        seen += counts[i];
+        if (seen >= target) return std::min(bucketUpper(i), maxValue);
+    }
+    return maxValue;
+}
+
+const char* infTypeName(Layer::InfType infType) {
+    switch (infType) {
+    case Layer::InfType::NAIVE:
+        return "naive";
+    case Layer::InfType::THREADED:
+        return "threaded";
+    case Layer::InfType::TILED:
+        return "tiled";
+    case Layer::InfType::SIMD:
+        return "simd";
+    case Layer::InfType::ACCEL:
+        return "accel";
+    default:
+        return "unknown";
+    }
+}
+
+// Fold one run's input density into the layer's min/mean/max
+void DensityStats::record(float density) {
+    min = std::min(min, density);
+    max = std::max(max, density);
+    sum += density;
+    runs++;
+}
+
+namespace {
+// Density every measuring layer saw in the run that just finished
+void recordDensity(const Model& model, std::vector<DensityStats>& stats) {
+    std::size_t next = 0;
+    for (std::size_t i = 0; i < model.getNumLayers(); i++) {
+        const float density = model[i].getInputDensity();
+        if (density < 0) continue;
+        if (next == stats.size()) {
+            stats.push_back(DensityStats());
+            stats.back().layer = model[i].getName();
+        }
+        stats[next++].record(density);
+    }
+}
+}  // namespace
+
+// Run inference repeatedly and collect its latency distribution
+BenchmarkResult runLatencyBenchmark(const Model& model, const LayerData& inData, Layer::InfType infType, const BenchmarkConfig& config) {
+    BenchmarkResult result;
+    result.infType = infType;
+
+    const std::size_t curveRuns = config.curveWindow * config.curvePoints;
+    double windowSumNs = 0;
+    std::size_t windowRuns = 0;
+
+    for (std::size_t run = 0; run < config.warmup + config.iterations; run++) {
+        if (config.cold) flushCaches(config.flushBytes);
+
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        model.inference(inData, infType);
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        const ui64 ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+
+        if (run >= config.warmup) {
+            result.histogram.record(ns);
+            recordDensity(model, result.density);
+        }
+
+        // The warm-up curve starts at the very first run so the settling behaviour is visible
+        if (run < curveRuns) {
+            windowSumNs += ns;
+            if (++windowRuns == config.curveWindow) {
+                result.warmupCurveMs.push_back(toMs(windowSumNs / windowRuns));
+                windowSumNs = 0;
+                windowRuns = 0;
+            }
+        }
+    }
+
+    // Short runs still get a (partial) last point
+    if (windowRuns) result.warmupCurveMs.push_back(toMs(windowSumNs / windowRuns));
+
+    return result;
+}
+
+// Print the percentile table (one row per result) followed by each warm-up curve
+void printBenchmarkResults(const std::vector<BenchmarkResult>& results, const BenchmarkConfig& config) {
+    std::cout << "\nLatency distribution (" << config.iterations << " runs after " << config.warmup << " warm-up, "
+              << (config.cold ? "cold: caches flushed between runs" : "warm") << "), all values in ms:\n";
+    const int w = 11;
+    std::size_t pw = 10;  // Precision plans can be long
+    for (const BenchmarkResult& result : results) pw = std::max(pw, result.precision.size() + 2);
+    std::cout << std::left << std::setw(10) << "InfType" << std::setw(pw) << "Precision" << std::right << std::setw(w) << "mean" << std::setw(w) << "min" << std::setw(w)
+              << "p50" << std::setw(w) << "p90" << std::setw(w) << "p99" << std::setw(w) << "p99.9" << std::setw(w) << "max" << std::setw(w)
+              << "stddev" << std::setw(w) << "p99-p50" << "\n";
+
+    std::cout << std::fixed << std::setprecision(3);
+    for (const BenchmarkResult& result : results) {
+        const LatencyHistogram& h = result.histogram;
+        std::cout << std::left << std::setw(10) << infTypeName(result.infType) << std::setw(pw) << result.precision << std::right << std::setw(w) << toMs(ui64(h.mean()))
+                  << std::setw(w) << toMs(h.min()) << std::setw(w) << toMs(h.percentile(50)) << std::setw(w) << toMs(h.percentile(90))
+                  << std::setw(w) << toMs(h.percentile(99)) << std::setw(w) << toMs(h.percentile(99.9)) << std::setw(w) << toMs(h.max())
+                  << std::setw(w) << toMs(ui64(h.stddev())) << std::setw(w) << toMs(h.percentile(99) - h.percentile(50)) << "\n";
+    }
+
+    bool anyDensity = false;
+    for (const BenchmarkResult& result : results) anyDensity |= !result.density.empty();
+    if (anyDensity) {
+        std::cout << "\nInput density of zero-skipping layers per request (fraction of nonzero inputs):\n";
+        std::cout << std::left << std::setw(10) << "InfType" << std::setw(pw) << "Precision" << std::setw(10) << "Layer" << std::right
+                  << std::setw(w) << "min" << std::setw(w) << "mean" << std::setw(w) << "max" << "\n";
+        for (const BenchmarkResult& result : results) {
+            for (const DensityStats& stats : result.density) {
+                std::cout << std::left << std::setw(10) << infTypeName(result.infType) << std::setw(pw) << result.precision << std::setw(10)
+                          << stats.layer << std::right << std::setw(w) << stats.min << std::setw(w) << stats.mean() << std::setw(w)
+                          << stats.max << "\n";
+            }
+        }
+    }
+
+    for (const BenchmarkResult& result : results) {
+        std::cout << "\nWarm-up curve (" << infTypeName(result.infType) << " " << result.precision << ", mean of each " << config.curveWindow << " runs):";
+        for (std::size_t i = 0; i < result.warmupCurveMs.size(); i++) {
+            std::cout << (i % 5 ? "  " : "\n  ") << "[" << std::setw(4) << i * config.curveWindow << "] " << std::setw(9)
+                      << result.warmupCurveMs[i];
+        }
+        std::cout << "\n";
+    }
+    std::cout.unsetf(std::ios::fixed);
+    std::cout << std::setprecision(6);
+}
+
+void runPackingBenchmark(std::size_t lanes, std::size_t iterations) {
+    const StreamPacker packer(lanes);
+    const std::size_t s = packer.stride();
+    std::cout << "\nStream packing, " << lanes << " lane(s), " << s << "-byte elements, " << packKernelName() << " kernel:\n";
+    std::cout << std::left << std::setw(8) << "Length" << std::setw(26) << "Method" << std::right << std::setw(12) << "ns/call"
+              << std::setw(12) << "ns/elem" << std::setw(10) << "GB/s" << std::setw(9) << "Speedup" << std::setw(8) << "Check" << "\n";
+
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> byte(-127, 127);
+    iterations = std::max<std::size_t>(iterations, 1);
+    for (std::size_t length : {std::size_t(3 * 3 * 64), std::size_t(12 * 12 * 128)}) {  // conv2_1 patch, fc1 input
+        LayerData activations({sizeof(ui8), {length}});
+        LayerData weights({sizeof(i8), {lanes, length}});
+        activations.allocData();
+        weights.allocData();
+        for (std::size_t i = 0; i < length; i++) activations.get<ui8>(i) = ui8(std::abs(byte(rng)));
+        for (std::size_t i = 0; i < lanes * length; i++) weights.get<i8>(i) = i8(byte(rng));
+        const ui8* a = (const ui8*)activations.raw();
+        const i8* w = (const i8*)weights.raw();
+
+        std::vector<ui8> reference(length * s), out(length * s), image(length * s);
+        packer.packScalar(a, w, length, length, reference.data());
+        packer.packWeights(w, length, length, image.data());
+        std::vector<ui8> unpackedA(length);
+        std::vector<i8> unpackedW(lanes * length);
+
+        double baselineNs = 0;
+        const auto measure = [&](const char* method, const std::function<void()>& body, const std::function<bool()>& check) {
+            std::fill(out.begin(), out.end(), 0);
+            body();  // Warm up
+            const auto begin = std::chrono::steady_clock::now();
+            for (std::size_t i = 0; i < iterations; i++) body();
+            const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / iterations;
+            if (baselineNs == 0) baselineNs = ns;
+            std::cout << std::left << std::setw(8) << length << std::setw(26) << method << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(12) << ns << std::setprecision(3) << std::setw(12) << ns / length << std::setprecision(2) << std::setw(10)
+                      << length * s / ns << std::setw(8) << baselineNs / ns << "x" << std::setw(8) << (check() ? "ok" : "FAIL") << "\n";
+        };
+        const auto packed = [&]() { return out == reference; };
+        const auto unpacked = [&]() {
+            return std::memcmp(unpackedA.data(), a, length) == 0 && std::memcmp(unpackedW.data(), w, lanes * length) == 0;
+        };
+
+        measure("pack LayerData::get", [&]() {
+            for (std::size_t e = 0; e < length; e++) {
+                out[e * s] = activations.get<ui8>(e);
+                for (std::size_t l = 0; l < lanes; l++) out[e * s + 1 + l] = ui8(weights.get<i8>(l * length + e));
+            }
+        }, packed);
+        measure("pack scalar", [&]() { packer.packScalar(a, w, length, length, out.data()); }, packed);
+        measure("pack simd", [&]() { packer.pack(a, w, length, length, out.data()); }, packed);
+        measure("pre-packed + insert", [&]() {
+            std::memcpy(out.data(), image.data(), image.size());
+            packer.insertActivations(a, length, out.data());
+        }, packed);
+        measure("unpack scalar", [&]() { packer.unpackScalar(reference.data(), length, unpackedA.data(), unpackedW.data(), length); },
+                unpacked);
+        measure("unpack simd", [&]() { packer.unpack(reference.data(), length, unpackedA.data(), unpackedW.data(), length); }, unpacked);
+    }
+    std::cout.unsetf(std::ios::fixed);
+    std::cout << std::setprecision(6);
+}
+
+void runDataflowBenchmark(Model& model, const LayerData& inData, std::size_t iterations) {
+    const CacheModel cacheModel;
+    std::cout << "\nConv dataflows (fp32 naive kernel; cache model with " << cacheModel.l1Bytes / 1024 << " KiB L1, "
+              << cacheModel.l2Bytes / 1024 << " KiB L2):\n";
+    std::cout << std::left << std::setw(10) << "Layer" << std::setw(9) << "Dataflow" << std::right << std::setw(9) << "Density"
+              << std::setw(10) << "L2 MB" << std::setw(10) << "Mem MB" << std::setw(12) << "Model ms" << std::setw(12) << "ms"
+              << std::setw(9) << "Speedup" << std::setw(12) << "Max diff" << "  Notes\n";
+
+    iterations = std::max<std::size_t>(iterations, 1);
+    const LayerData* x = &inData;
+    for (std::size_t i = 0; i < model.getNumLayers(); i++) {
+        Layer& layer = model[i];
+        if (layer.getLType() == Layer::LayerType::CONVOLUTIONAL && layer.getPrecision() == Layer::Precision::FP32) {
+            ConvolutionalLayer& conv = static_cast<ConvolutionalLayer&>(layer);
+            const Dataflow requested = conv.getRequestedDataflow();
+            const TileShape shape = conv.getTileShape();
+
+            // What AUTO picks for this input, then output-stationary first, the reference for speedup and differences
+            conv.setDataflow(Dataflow::AUTO);
+            conv.computeNaive(*x);
+            const Dataflow picked = conv.getDataflow();
+            const float density = conv.getInputDensity();
+
+            LayerData reference(layer.getOutputParams());
+            reference.allocData();
+            struct Row {
+                Dataflow dataflow;
+                double ms;
+                float maxDiff;
+            };
+            std::vector<Row> rows;
+            for (Dataflow dataflow : {Dataflow::OUTPUT, Dataflow::WEIGHT, Dataflow::INPUT}) {
+                conv.setDataflow(dataflow);
+                conv.computeNaive(*x);  // Warm up
+                const auto begin = std::chrono::steady_clock::now();
+                for (std::size_t it = 0; it < iterations; it++) conv.computeNaive(*x);
+                const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count() / iterations;
+                if (dataflow == Dataflow::OUTPUT) std::memcpy(reference.raw(), layer.getOutputData().raw(), reference.getParams().byte_size());
+                rows.push_back({dataflow, ms, layer.getOutputData().compareStats<fp32>(reference).maxAbs});
+            }
+            conv.setDataflow(requested);
+
+            const Row& fastest = *std::min_element(rows.begin(), rows.end(), [](const Row& a, const Row& b) { return a.ms < b.ms; });
+            for (const Row& row : rows) {
+                const DataflowEstimate estimate = cacheModel.estimate(shape, row.dataflow, density);
+                std::string notes;
+                if (row.dataflow == requested) notes += " requested";
+                if (row.dataflow == picked) notes += " auto";
+                if (&row == &fastest) notes += " fastest";
+                std::cout << std::left << std::setw(10) << layer.getName() << std::setw(9) << dataflowName(row.dataflow) << std::right
+                          << std::fixed << std::setprecision(2) << std::setw(9) << density << std::setw(10) << estimate.l2Bytes / 1e6
+                          << std::setw(10) << estimate.memoryBytes / 1e6 << std::setw(12) << estimate.ns / 1e6 << std::setw(12) << row.ms
+                          << std::setw(8) << rows[0].ms / row.ms << "x" << std::scientific << std::setprecision(1) << std::setw(12)
+                          << row.maxDiff << " " << notes << "\n";
+            }
+        }
+        layer.computeNaive(*x);
+        x = &layer.getOutputData();
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+}
+
+void runStaticModelBenchmark(const Model& model, const StaticAudioCNN& staticModel, const LayerData& inData,
+                             const std::vector<Layer::InfType>& infTypes, std::size_t iterations) {
+    if (model.getNumLayers() != StaticAudioCNN::LAYERS) throw std::runtime_error("Static model benchmark needs the 13 layer fp32 model");
+    iterations = std::max<std::size_t>(iterations, 1);
+    const auto time = [iterations](const std::function<void()>& run) {
+        run();  // Warm up
+        const auto begin = std::chrono::steady_clock::now();
+        for (std::size_t it = 0; it < iterations; it++) run();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count() / iterations;
+    };
+    const fp32* input = (const fp32*)inData.raw();
+
+    for (Layer::InfType infType : infTypes) {
+        std::cout << "\nStatic vs dynamic model (fp32, dynamic " << infTypeName(infType) << ", static single-threaded):\n";
+        std::cout << std::left << std::setw(10) << "Layer" << std::right << std::setw(14) << "Dynamic ms" << std::setw(12) << "Static ms"
+                  << std::setw(9) << "Speedup" << std::setw(12) << "Max diff" << "\n";
+
+        double dynamicTotal = 0, staticTotal = 0;
+        const LayerData* x = &inData;
+        for (std::size_t i = 0; i < model.getNumLayers(); i++) {
+            const Layer& layer = model[i];
+            const double dynamicMs = time([&]() { model.inferenceLayer(*x, i, infType); });
+            const double staticMs = time([&]() { staticModel.inferenceLayer(input, i); });
+            dynamicTotal += dynamicMs;
+            staticTotal += staticMs;
+
+            // Same inputs for both from here on: the static layer ran on its own previous output
+            float maxDiff = 0;
+            const fp32* dynamicOut = (const fp32*)layer.getOutputData().raw();
+            const fp32* staticOut = staticModel.getOutput(i);
+            for (std::size_t k = 0; k < staticModel.getOutputCount(i); k++) maxDiff = std::max(maxDiff, std::abs(dynamicOut[k] - staticOut[k]));
+
+            std::cout << std::left << std::setw(10) << layer.getName() << std::right << std::fixed << std::setprecision(3) << std::setw(14)
+                      << dynamicMs << std::setw(12) << staticMs << std::setprecision(2) << std::setw(8) << dynamicMs / staticMs << "x"
+                      << std::scientific << std::setprecision(1) << std::setw(12) << maxDiff << "\n";
+            x = &layer.getOutputData();
+        }
+
+        // Whole inferences, back to back
+        const double dynamicMs = time([&]() { model.inference(inData, infType); });
+        const double staticMs = time([&]() { staticModel.inference(input); });
+        std::cout << std::left << std::setw(10) << "sum" << std::right << std::fixed << std::setprecision(3) << std::setw(14) << dynamicTotal
+                  << std::setw(12) << staticTotal << std::setprecision(2) << std::setw(8) << dynamicTotal / staticTotal << "x\n";
+        std::cout << std::left << std::setw(10) << "inference" << std::right << std::setprecision(3) << std::setw(14) << dynamicMs
+                  << std::setw(12) << staticMs << std::setprecision(2) << std::setw(8) << dynamicMs / staticMs << "x\n";
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+}
+
+}  // namespace ML
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Model.h"
+#include "StaticModel.h"
+#include "Types.h"
+#include "Utils.h"
+
+namespace ML {
+
+// Log-linear latency histogram in the style of HdrHistogram
+// Values below 2^subBucketBits ns are exact, larger values land in buckets with < 2^-(subBucketBits-1) relative error
+class LatencyHistogram {
+   public:
+    explicit LatencyHistogram(unsigned subBucketBits = 8);
+
+    void record(ui64 valueNs);
+    void reset();
+
+    inline ui64 count() const { return total; }
+    inline ui64 min() const { return total ? minValue : 0; }
+    inline ui64 max() const { return maxValue; }
+    double mean() const;
+    double stddev() const;
+
+    // Smallest recorded bucket value that at least `percent`% of samples are at or below
+    ui64 percentile(double percent) const;
+
+   private:
+    std::size_t bucketIndex(ui64 value) const;
+    ui64 bucketUpper(std::size_t index) const;
+
+    unsigned subBucketBits;
+    std::vector<ui64> counts;
+    ui64 total;
+    ui64 minValue, maxValue;
+    double sum, sumSquares;
+};
+
+// Load harness settings
+struct BenchmarkConfig {
+    std::size_t iterations = 1000;  // Measured runs
+    std::size_t warmup = 10;        // Runs before measuring (still part of the warm-up curve)
+    bool cold = false;              // Flush caches and TLB between runs to emulate cold requests
+    std::size_t flushBytes = 64 << 20;  // Bytes streamed per flush, should exceed the LLC
+    std::size_t curveWindow = 10;   // Runs averaged per point of the warm-up curve
+    std::size_t curvePoints = 10;   // Points printed in the warm-up curve
+};
+
+// Nonzero input fraction one layer measured over the benchmark runs (Layer::getInputDensity)
+struct DensityStats {
+    std::string layer;
+    float min = 1, max = 0;
+    double sum = 0;
+    std::size_t runs = 0;
+
+    void record(float density);
+    inline double mean() const { return runs ? sum / runs : 0; }
+};
+
+// Latency distribution for one inference type and precision plan
+struct BenchmarkResult {
+    Layer::InfType infType;
+    std::string precision = "fp32";  // PrecisionPlan::str()
+    LatencyHistogram histogram;
+    std::vector<double> warmupCurveMs;  // Mean latency of each curveWindow-sized window from the first run on
+    std::vector<DensityStats> density;  // Per layer that measures its input density
+};
+
+// Run inference repeatedly and collect its latency distribution
+BenchmarkResult runLatencyBenchmark(const Model& model, const LayerData& inData, Layer::InfType infType, const BenchmarkConfig& config);
+
+// Print the percentile table (one row per result) followed by each warm-up curve
+void printBenchmarkResults(const std::vector<BenchmarkResult>& results, const BenchmarkConfig& config);
+
+// Printable name of an inference type
+const char* infTypeName(Layer::InfType infType);
+
+// Throughput of packing `lanes`-lane accelerator stream words for a conv patch and the fc1 input: element by element
+// through LayerData::get, the scalar and SIMD packers, insertion into pre-packed weights, and unpacking
+void runPackingBenchmark(std::size_t lanes, std::size_t iterations);
+
+// Per Conv layer of an fp32 model, time the naive kernel in every dataflow on the layer's actual input next to the
+// cache model's estimate for its input density, marking the requested dataflow, the one AUTO picks and the fastest
+void runDataflowBenchmark(Model& model, const LayerData& inData, std::size_t iterations);
+
+// Per layer and for the whole inference, time the fp32 dynamic model in each inference type next to the
+// compile-time specialized StaticAudioCNN on the same input, with the largest difference between their outputs
+void runStaticModelBenchmark(const Model& model, const StaticAudioCNN& staticModel, const LayerData& inData,
+                             const std::vector<Layer::InfType>& infTypes, std::size_t iterations);
+
+}  // namespace ML
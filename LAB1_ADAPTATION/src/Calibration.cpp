@@ -0,0 +1,120 @@
+#include "Calibration.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include "Quantization.h"
+
+namespace ML {
+
+void Calibration::record(const std::string& name, const LayerData& data) {
+    const std::size_t count = data.getParams().flat_count();
+    const fp32* values = (const fp32*)data.raw();
+
+    Range& range = ranges[name];
+    for (std::size_t i = 0; i < count; i++) {
+        range.min = std::min(range.min, values[i]);
+        range.max = std::max(range.max, values[i]);
+    }
+}
+
+QuantParams Calibration::quantParams(const std::string& name) const {
+    auto it = ranges.find(name);
+    if (it == ranges.end()) throw std::runtime_error("No calibration range for `" + name + "`");
+    return chooseQuantParams(it->second.min, it->second.max);
+}
+
+void Calibration::save(const Path& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) throw std::runtime_error("Failed to open calibration file for writing: " + path);
+
+    file << "# tensor min max\n" << std::setprecision(9);
+    for (const auto& entry : ranges) file << entry.first << " " << entry.second.min << " " << entry.second.max << "\n";
+}
+
+void Calibration::load(const Path& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) throw std::runtime_error("Failed to open calibration file: " + path);
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream iss(line);
+        std::string name;
+        Range range;
+        if (!(iss >> name >> range.min >> range.max)) throw std::runtime_error("Malformed calibration line: " + line);
+        ranges[name] = range;
+    }
+}
+
+// The model input is always fp32
+void Calibrator::beginLayer(std::size_t layerNum, const Layer&, const LayerData& dataIn) {
+    if (layerNum == 0) calibration.record("input", dataIn);
+}
+
+void Calibrator::endLayer(std::size_t, const Layer& layer, const LayerData& dataOut) {
+    if (layer.getPrecision() == Layer::Precision::FP32 && layer.getOutputStorage() == Layer::Storage::FP32 &&
+        layer.getLType() != Layer::LayerType::CONVERT) {
+        calibration.record(layer.getName(), dataOut);
+    }
+}
+
+// Output is [H][W][C], channels innermost
+void ChannelActivity::endLayer(std::size_t, const Layer& layer, const LayerData& dataOut) {
+    if (layer.getLType() != Layer::LayerType::CONVOLUTIONAL || layer.getPrecision() != Layer::Precision::FP32 ||
+        layer.getOutputStorage() != Layer::Storage::FP32 || layer.getOutputLayout() != Layout::NHWC) {
+        return;
+    }
+
+    const std::size_t channels = layer.getOutputParams().dims.back();
+    const std::size_t count = layer.getOutputParams().flat_count();
+    const fp32* values = (const fp32*)dataOut.raw();
+
+    std::vector<float>& channelMax = maxima[layer.getName()];
+    channelMax.resize(channels, 0.0f);
+    for (std::size_t i = 0; i < count; i++) channelMax[i % channels] = std::max(channelMax[i % channels], values[i]);
+}
+
+std::vector<std::size_t> ChannelActivity::liveChannels(const std::string& name, float threshold) const {
+    auto it = maxima.find(name);
+    if (it == maxima.end()) throw std::runtime_error("No channel activity recorded for `" + name + "`");
+
+    const std::vector<float>& channelMax = it->second;
+    std::vector<std::size_t> live;
+    for (std::size_t c = 0; c < channelMax.size(); c++) {
+        if (channelMax[c] > threshold) live.push_back(c);
+    }
+    if (live.empty()) live.push_back(std::max_element(channelMax.begin(), channelMax.end()) - channelMax.begin());
+    return live;
+}
+
+Calibration calibrate(Model& model, const std::vector<ValidationCase>& cases) {
+    Calibration calibration;
+    Calibrator calibrator(calibration);
+
+    for (const ValidationCase& validationCase : cases) {
+        LayerData input({sizeof(fp32), model[0].getInputParams().dims, validationCase.inputPath});
+        input.loadData();
+
+        model.addObserver(&calibrator);
+        model.inference(input);
+        model.removeObserver(&calibrator);
+
+        for (std::size_t i = 0; i < model.getNumLayers(); i++) {
+            const Layer& layer = model[i];
+            Path referencePath = findReferenceMap(validationCase.featureMapDir, i, layer);
+            if (referencePath.empty() || std::size_t(fileSize(referencePath)) != layer.getOutputParams().byte_size()) continue;
+
+            LayerData reference(layer.getOutputParams(), referencePath);
+            reference.loadData();
+            calibration.record(layer.getName(), reference);
+        }
+    }
+
+    return calibration;
+}
+
+}  // namespace ML
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Model.h"
+#include "Types.h"
+#include "Utils.h"
+#include "Validation.h"
+
+namespace ML {
+
+// Per-tensor activation ranges used to quantize a model to int8, keyed by layer name ("input" for the model input)
+class Calibration {
+   public:
+    struct Range {
+        float min = INFINITY;
+        float max = -INFINITY;
+    };
+
+    // Widen the range of a tensor by the values of an fp32 buffer
+    void record(const std::string& name, const LayerData& data);
+
+    bool has(const std::string& name) const { return ranges.count(name) != 0; }
+    const std::map<std::string, Range>& getRanges() const { return ranges; }
+
+    // Quantization of a recorded tensor (throws if it was never recorded)
+    QuantParams quantParams(const std::string& name) const;
+
+    // Plain text, one "name min max" line per tensor
+    void save(const Path& path) const;
+    void load(const Path& path);
+
+   private:
+    std::map<std::string, Range> ranges;
+};
+
+// Records the range of the model input and of every fp32 layer output during inference
+class Calibrator : public InferenceObserver {
+   public:
+    explicit Calibrator(Calibration& calibration) : calibration(calibration) {}
+    virtual ~Calibrator() {}
+
+    // InferenceObserver hooks
+    virtual void beginLayer(std::size_t layerNum, const Layer& layer, const LayerData& dataIn) override;
+    virtual void endLayer(std::size_t layerNum, const Layer& layer, const LayerData& dataOut) override;
+
+   private:
+    Calibration& calibration;
+};
+
+// Largest output each channel of every fp32 convolution reaches (after ReLU), over all inferences observed
+// Channels that never rise above zero carry no information downstream and can be removed from the model
+class ChannelActivity : public InferenceObserver {
+   public:
+    virtual ~ChannelActivity() {}
+
+    // InferenceObserver hooks
+    virtual void endLayer(std::size_t layerNum, const Layer& layer, const LayerData& dataOut) override;
+
+    const std::map<std::string, std::vector<float>>& getMaxima() const { return maxima; }
+
+    // Channels of a layer whose largest activation is above threshold, at least the most active one
+    std::vector<std::size_t> liveChannels(const std::string& name, float threshold) const;
+
+   private:
+    std::map<std::string, std::vector<float>> maxima;
+};
+
+// Calibrate an allocated fp32 model by running it on each case's input
+// Ranges are widened by the case's exported reference feature maps wherever one matches a layer's output size
+Calibration calibrate(Model& model, const std::vector<ValidationCase>& cases);
+
+}  // namespace ML
@@ -1,14 +1,52 @@
 #pragma once
 
+#include <cstddef>
+
 // Disable all timers
 // #define DISABLE_TIMING
 
+// Compile out worker tile tracing (layer tracing only costs a branch when no observer is attached)
+// #define DISABLE_TRACING
+
 namespace ML {
 namespace Config {
 constexpr bool ENABLE_SIMD = false;
 constexpr bool FANCY_LOGGING = true;
 
+// Cache line size used for traffic and bandwidth estimates
+constexpr unsigned CACHE_LINE_SIZE = 64;
+
+// Per-core L1 data and L2 caches of the host CPUs, as the conv dataflow cache model assumes them
+constexpr std::size_t L1_CACHE_BYTES = 32 * 1024;
+constexpr std::size_t L2_CACHE_BYTES = 256 * 1024;
+
 // Floating Point Compare Epsilon
 constexpr float EPSILON = 0.001;
+
+// Minimum cosine similarity for a layer output to match its reference
+constexpr float COSINE_SIMILARITY_THRESHOLD = 0.8f;
+
+// Zero-skipping Dense layers only stream the weight rows of nonzero inputs when at most this fraction is nonzero,
+// above it the index list costs more than the rows it saves
+constexpr float SPARSE_DENSITY_THRESHOLD = 0.7f;
+
+// Block shape of structured pruning and block-sparse weights: rows along the reduction (input) dimension, columns
+// along the output channels so each stored block row is one contiguous vector of outputs
+constexpr std::size_t SPARSE_BLOCK_ROWS = 4;
+constexpr std::size_t SPARSE_BLOCK_COLS = 16;
+
+// Conv/Dense fp32 weights with at most this fraction of nonzero blocks are loaded block-sparse
+constexpr float BLOCK_SPARSE_DENSITY_THRESHOLD = 0.5f;
+
+// Scratchpad the tiling planner fits a layer's double-buffered working set into, the per-core L2 of the host CPUs
+// (the ZedBoard fabric has a little over 500 KB of BRAM)
+constexpr std::size_t TILE_BUDGET_BYTES = L2_CACHE_BYTES;
+
+// fp32 tiles hold whole multiples of this many output channels, the width of the widest vectors their sums run in
+constexpr std::size_t TILE_CHANNEL_MULTIPLE = 16;
+
+// Classes a fused classifier head ranks (the top-5 printed by `ml test`) and the most it holds in registers
+constexpr std::size_t HEAD_TOP_K = 5;
+constexpr std::size_t HEAD_MAX_CLASSES = 16;
 } // namespace Config
 } // namespace ML::Config
\ No newline at end of file
@@ -0,0 +1,67 @@
+#include "CpuDispatch.h"
+
+#include <stdexcept>
+
+namespace ML {
+
+const char* isaName(Isa isa) {
+    switch (isa) {
+    case Isa::BASELINE: return "baseline";
+    case Isa::SSE42: return "sse4.2";
+    case Isa::AVX2: return "avx2";
+    case Isa::AVX512: return "avx512";
+    }
+    return "unknown";
+}
+
+Isa parseIsa(const std::string& name) {
+    for (Isa isa : {Isa::BASELINE, Isa::SSE42, Isa::AVX2, Isa::AVX512}) {
+        if (name == isaName(isa)) return isa;
+    }
+    throw std::runtime_error("Unknown instruction set: " + name + " (baseline, sse4.2, avx2 or avx512)");
+}
+
+namespace {
+Isa cpuIsa() {
+#if ML_HAS_ISA_TARGETS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl") &&
+        __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+        __builtin_cpu_supports("f16c")) {
+        return Isa::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c")) return Isa::AVX2;
+    if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt")) return Isa::SSE42;
+#endif
+    return Isa::BASELINE;
+}
+
+bool cpuVnni() {
+#if ML_HAS_ISA_TARGETS
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512vnni");
+#else
+    return false;
+#endif
+}
+
+// Probed once, before main() like the ifunc resolvers of multiversioned libraries
+const Isa detectedIsa = cpuIsa();
+const bool hasVnni = cpuVnni();
+Isa activeIsa = detectedIsa;
+}  // namespace
+
+Isa detectIsa() { return detectedIsa; }
+
+bool cpuHasAvx512Vnni() { return hasVnni; }
+
+Isa getIsa() { return activeIsa; }
+
+void setIsa(Isa isa) {
+    if (!isaSupported(isa)) {
+        throw std::runtime_error(std::string("This CPU does not support ") + isaName(isa) + " (up to " + isaName(detectedIsa) + ")");
+    }
+    activeIsa = isa;
+}
+
+}  // namespace ML
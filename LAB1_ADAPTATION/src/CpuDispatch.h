@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <utility>
+
+namespace ML {
+
+// Instruction set tiers the kernels are compiled for, each including the ones before it. BASELINE is whatever the
+// build flags target (SSE2 on x86-64, where it is part of the ABI; everything with SIMD=true's -march=native).
+// The other tiers exist on x86-64 only
+//  - SSE42:  SSE4.2 (with SSSE3 pshufb and popcnt)
+//  - AVX2:   AVX2, FMA and F16C (Haswell and later)
+//  - AVX512: AVX-512 F/BW/VL/DQ (Skylake-SP and later), VNNI used by the int8 dot product when present
+enum class Isa { BASELINE, SSE42, AVX2, AVX512 };
+
+const char* isaName(Isa isa);
+Isa parseIsa(const std::string& name);
+
+// Highest tier the CPU supports (cpuid), BASELINE on other architectures
+Isa detectIsa();
+inline bool isaSupported(Isa isa) { return isa <= detectIsa(); }
+
+// Extension beyond the AVX512 tier the int8 kernels use when the CPU has it
+bool cpuHasAvx512Vnni();
+
+// Tier every dispatched kernel runs in: the detected one unless lowered, e.g. by --isa (throws above detectIsa())
+Isa getIsa();
+void setIsa(Isa isa);
+
+// Kernel bodies meant to be compiled once per tier must be inlined all the way into the target functions below, so
+// they and every loop helper they call are declared ML_ISA_INLINE; anything called out of line runs in BASELINE code
+#define ML_ISA_INLINE inline __attribute__((always_inline))
+
+#if defined(__x86_64__)
+#    define ML_HAS_ISA_TARGETS 1
+#    define ML_TARGET_SSE42 __attribute__((target("sse4.2,popcnt")))
+#    define ML_TARGET_AVX2 __attribute__((target("avx2,fma,f16c,popcnt")))
+#    define ML_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx512vl,avx512dq,avx2,fma,f16c,popcnt")))
+#    define ML_TARGET_AVX512VNNI __attribute__((target("avx512vnni,avx512f,avx512bw,avx512vl,avx512dq,avx2,fma,f16c,popcnt")))
+#else
+#    define ML_HAS_ISA_TARGETS 0
+#    define ML_TARGET_SSE42
+#    define ML_TARGET_AVX2
+#    define ML_TARGET_AVX512
+#    define ML_TARGET_AVX512VNNI
+#endif
+
+namespace detail {
+template <typename Kernel, typename... Args> ML_TARGET_SSE42 void runSSE42(const Kernel& kernel, Args&&... args) {
+    kernel(std::forward<Args>(args)...);
+}
+template <typename Kernel, typename... Args> ML_TARGET_AVX2 void runAVX2(const Kernel& kernel, Args&&... args) {
+    kernel(std::forward<Args>(args)...);
+}
+template <typename Kernel, typename... Args> ML_TARGET_AVX512 void runAVX512(const Kernel& kernel, Args&&... args) {
+    kernel(std::forward<Args>(args)...);
+}
+}  // namespace detail
+
+// Call kernel(args...) in the copy of its ML_ISA_INLINE body compiled for getIsa(): the compiler vectorizes the same
+// loops with SSE, AVX2+FMA or AVX-512 registers, and one binary runs on any of the tiers
+template <typename Kernel, typename... Args> inline void dispatchIsa(const Kernel& kernel, Args&&... args) {
+#if ML_HAS_ISA_TARGETS
+    switch (getIsa()) {
+    case Isa::AVX512: return detail::runAVX512(kernel, std::forward<Args>(args)...);
+    case Isa::AVX2: return detail::runAVX2(kernel, std::forward<Args>(args)...);
+    case Isa::SSE42: return detail::runSSE42(kernel, std::forward<Args>(args)...);
+    case Isa::BASELINE: break;
+    }
+#endif
+    kernel(std::forward<Args>(args)...);
+}
+
+}  // namespace ML
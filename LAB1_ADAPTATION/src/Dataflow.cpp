@@ -0,0 +1,134 @@
+#include "Dataflow.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#include "Config.h"
+
+namespace ML {
+
+const char* dataflowName(Dataflow dataflow) {
+    switch (dataflow) {
+    case Dataflow::AUTO: return "auto";
+    case Dataflow::OUTPUT: return "output";
+    case Dataflow::WEIGHT: return "weight";
+    case Dataflow::INPUT: return "input";
+    }
+    return "unknown";
+}
+
+Dataflow parseDataflow(const std::string& name) {
+    if (name == "auto") return Dataflow::AUTO;
+    if (name == "output" || name == "os") return Dataflow::OUTPUT;
+    if (name == "weight" || name == "ws") return Dataflow::WEIGHT;
+    if (name == "input" || name == "is") return Dataflow::INPUT;
+    throw std::runtime_error("Unknown dataflow: " + name + " (auto, output, weight or input)");
+}
+
+DataflowEstimate CacheModel::estimate(const TileShape& shape, Dataflow dataflow, float inputDensity) const {
+    if (dataflow == Dataflow::AUTO) dataflow = select(shape, inputDensity);
+    const double d = inputDensity;
+    const ui64 e = shape.elementSize, line = Config::CACHE_LINE_SIZE;
+    const ui64 H = shape.H, W = shape.W, C = shape.C, P = shape.P, Q = shape.Q, M = shape.M, R = shape.R, S = shape.S;
+    const ui64 weights = R * S * C * M * e, inputs = H * W * C * e, outputs = P * Q * M * e;
+    const double macs = double(P) * Q * M * R * S * C;
+
+    DataflowEstimate estimate;
+    // First touch from memory, refetches from the level the working set fits in
+    const auto operand = [&](ui64 unique, ui64 workingSet, double refetched) {
+        estimate.memoryBytes += unique;
+        if (workingSet <= l1Bytes) return;
+        if (workingSet <= l2Bytes) {
+            estimate.l2Bytes += ui64(refetched);
+        } else {
+            estimate.memoryBytes += ui64(refetched);
+        }
+    };
+    switch (dataflow) {
+    case Dataflow::OUTPUT: {
+        // A column of R*S*C weights M apart takes a line per weight; once the lines of a column overflow L1 every
+        // output channel fetches its lines again
+        const ui64 column = R * S * C * line;
+        operand(weights, column > l1Bytes ? column : weights, double(P) * Q * (column > l1Bytes ? M * column : weights));
+        operand(inputs, R * W * C * e, double(P) * Q * R * S * C * e);
+        operand(outputs, 0, 0);
+        estimate.macs = macs;
+        break;
+    }
+    case Dataflow::WEIGHT: {
+        // A row of Q*M partial sums stays while every weight vector passes once per output row
+        const ui64 row = Q * M * e;
+        operand(weights, weights + row, double(P) * weights);
+        operand(outputs, row, double(outputs) * R * S * C);
+        operand(inputs, R * W * C * e, double(P) * R * S * C * Q * std::min(line, C * e));
+        estimate.macs = macs;
+        break;
+    }
+    case Dataflow::INPUT: {
+        // R rows of partial sums stay while every nonzero input sweeps the weights of its R*S*M contributions
+        const ui64 ring = R * Q * M * e;
+        operand(weights, weights + ring, d * H * W * weights);
+        operand(outputs, ring, d * H * W * C * R * S * M * e);
+        operand(inputs, 0, 0);
+        estimate.macs = d * macs;
+        break;
+    }
+    case Dataflow::AUTO: break;
+    }
+    const double rate = dataflow == Dataflow::OUTPUT ? scalarMacsPerNs : vectorMacsPerNs;
+    estimate.ns = estimate.macs / rate + estimate.l2Bytes / l2BytesPerNs + estimate.memoryBytes / memoryBytesPerNs;
+    return estimate;
+}
+
+Dataflow CacheModel::select(const TileShape& shape, float inputDensity) const {
+    Dataflow best = Dataflow::WEIGHT;
+    double bestNs = estimate(shape, best, inputDensity).ns;
+    for (Dataflow dataflow : {Dataflow::INPUT, Dataflow::OUTPUT}) {
+        const double ns = estimate(shape, dataflow, inputDensity).ns;
+        if (ns < bestNs) {
+            best = dataflow;
+            bestNs = ns;
+        }
+    }
+    return best;
+}
+
+Dataflow DataflowPlan::forLayer(const std::string& name) const {
+    const auto it = layers.find(name);
+    return it == layers.end() ? defaultDataflow : it->second;
+}
+
+DataflowPlan DataflowPlan::parse(const std::string& text) {
+    DataflowPlan plan;
+    std::istringstream iss(text);
+    std::string item;
+    bool first = true;
+    while (std::getline(iss, item, ',')) {
+        const std::size_t eq = item.find('=');
+        if (eq == std::string::npos) {
+            if (!first) throw std::runtime_error("Dataflow plan `" + text + "` must give the default first");
+            plan.defaultDataflow = parseDataflow(item);
+        } else {
+            plan.layers[item.substr(0, eq)] = parseDataflow(item.substr(eq + 1));
+        }
+        first = false;
+    }
+    return plan;
+}
+
+std::string DataflowPlan::str() const {
+    std::string text = dataflowName(defaultDataflow);
+    for (const auto& layer : layers) text += "," + layer.first + "=" + dataflowName(layer.second);
+    return text;
+}
+
+namespace {
+DataflowPlan dataflowPlan;
+}  // namespace
+
+const DataflowPlan& getDataflowPlan() { return dataflowPlan; }
+
+void setDataflowPlan(const DataflowPlan& plan) { dataflowPlan = plan; }
+
+}  // namespace ML
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <string>
+
+#include "Config.h"
+#include "Tiling.h"
+#include "Types.h"
+
+namespace ML {
+
+// Loop order of the fp32 convolution kernels, named after the operand that stays in registers/L1 the longest
+//  - OUTPUT: per output element the whole R*S*C reduction (weights read with a stride of M)
+//  - WEIGHT: per output row each weight vector w[r][s][c][0..M) is swept across the Q outputs it touches
+//  - INPUT:  each input element is read once and scattered into the R*S output vectors it contributes to, over a ring
+//            of R output rows; zero inputs (most of them after ReLU) are skipped
+enum class Dataflow { AUTO, OUTPUT, WEIGHT, INPUT };
+
+const char* dataflowName(Dataflow dataflow);
+Dataflow parseDataflow(const std::string& name);
+
+// Estimated cost of one inference of a conv loop nest in one dataflow
+struct DataflowEstimate {
+    ui64 l2Bytes = 0, memoryBytes = 0;  // Fetched from L2 / from memory
+    double macs = 0;                    // Executed, zero inputs skipped by INPUT
+    double ns = 0;
+};
+
+// Every operand is fetched from the first cache level its reused working set fits in: once from memory when it fits
+// L1, otherwise once per outer loop iteration that sweeps it, at a whole line per element for the strided weight
+// columns of OUTPUT. MACs run at the scalar rate in OUTPUT's strided reduction and at the vector rate in the
+// contiguous axpys of WEIGHT and INPUT. Rates are rough figures for the host CPUs
+struct CacheModel {
+    std::size_t l1Bytes = Config::L1_CACHE_BYTES, l2Bytes = Config::L2_CACHE_BYTES;
+    double scalarMacsPerNs = 1, vectorMacsPerNs = 8, l2BytesPerNs = 32, memoryBytesPerNs = 8;
+
+    DataflowEstimate estimate(const TileShape& shape, Dataflow dataflow, float inputDensity = 1) const;
+
+    // Cheapest estimate, ties going to the contiguous WEIGHT then INPUT loops
+    Dataflow select(const TileShape& shape, float inputDensity = 1) const;
+};
+
+// Dataflow per Conv layer: "auto,conv1_1=input,conv3_2=weight", the default first (auto picks with the CacheModel)
+struct DataflowPlan {
+    Dataflow defaultDataflow = Dataflow::AUTO;
+    std::map<std::string, Dataflow> layers;
+
+    Dataflow forLayer(const std::string& name) const;
+
+    static DataflowPlan parse(const std::string& text);
+    std::string str() const;
+};
+
+// Plan the Conv layers resolve their dataflow from at allocLayer (all auto unless set, e.g. by --dataflow)
+const DataflowPlan& getDataflowPlan();
+void setDataflowPlan(const DataflowPlan& plan);
+
+}  // namespace ML
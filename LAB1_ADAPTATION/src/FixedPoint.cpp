@@ -0,0 +1,56 @@
+#include "FixedPoint.h"
+
+#include <algorithm>
+
+namespace ML {
+
+QFormat chooseQFormat(float maxAbs, unsigned totalBits) {
+    // Integer bits needed for the magnitude plus the sign bit
+    unsigned intBits = 1;
+    while (intBits < totalBits && std::ldexp(1.0f, intBits - 1) <= maxAbs) intBits++;
+
+    QFormat format;
+    format.intBits = intBits;
+    format.fracBits = totalBits - intBits;
+    return format;
+}
+
+void FixedWeights::load(const LayerData& weightData, const LayerData& biasData) {
+    const std::size_t weightCount = weightData.getParams().flat_count();
+    const std::size_t biasCount = biasData.getParams().flat_count();
+    const fp32* w = (const fp32*)weightData.raw();
+    const fp32* b = (const fp32*)biasData.raw();
+
+    float maxAbs = 0;
+    for (std::size_t i = 0; i < weightCount; i++) maxAbs = std::max(maxAbs, std::fabs(w[i]));
+    format = chooseQFormat(maxAbs);
+
+    weights.resize(weightCount);
+    for (std::size_t i = 0; i < weightCount; i++) weights[i] = toFixedWeight(w[i], format.fracBits);
+
+    bias.resize(biasCount);
+    for (std::size_t i = 0; i < biasCount; i++) bias[i] = FixedAcc(toFixedAct(b[i]).to_raw()) * (FixedAcc(1) << format.fracBits);  // Shifting a negative is UB
+}
+
+void FixedWeights::clear() {
+    weights.clear();
+    weights.shrink_to_fit();
+    bias.clear();
+    bias.shrink_to_fit();
+}
+
+void floatToFixed(const LayerData& in, LayerData& out) {
+    const std::size_t count = in.getParams().flat_count();
+    const fp32* src = (const fp32*)in.raw();
+    FixedAct* dst = (FixedAct*)out.raw();
+    for (std::size_t i = 0; i < count; i++) dst[i] = toFixedAct(src[i]);
+}
+
+void fixedToFloat(const LayerData& in, LayerData& out) {
+    const std::size_t count = in.getParams().flat_count();
+    const FixedAct* src = (const FixedAct*)in.raw();
+    fp32* dst = (fp32*)out.raw();
+    for (std::size_t i = 0; i < count; i++) dst[i] = src[i].to_float();
+}
+
+}  // namespace ML
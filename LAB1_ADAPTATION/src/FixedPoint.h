@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+// Fixed.h is vendored as-is, silence its unused typedef under -Werror
+#ifdef __GNUC__
+#    pragma GCC diagnostic push
+#    pragma GCC diagnostic ignored "-Wunused-local-typedefs"
+#endif
+#include "Fixed.h"
+#ifdef __GNUC__
+#    pragma GCC diagnostic pop
+#endif
+
+#include "Types.h"
+#include "layers/Layer.h"
+
+namespace ML {
+
+// Activations passed between fixed-point layers: Q16.16 stored in the same 4 bytes an fp32 would use
+using FixedAct = numeric::fixed<16, 16>;
+
+// Wide accumulator for activation x weight products, Q(48-F).(16+F) for Q(16-F).F weights
+using FixedAcc = FixedAct::next_type;
+
+// Weights are stored as raw 16 bit Q(16-F).F values with F chosen per layer
+using FixedWeight = i16;
+constexpr unsigned FIXED_WEIGHT_BITS = 16;
+
+// Q-format of a layer's fixed-point weights (sign bit counted in intBits)
+struct QFormat {
+    unsigned intBits = 1;
+    unsigned fracBits = FIXED_WEIGHT_BITS - 1;
+
+    std::string str() const { return "Q" + std::to_string(intBits) + "." + std::to_string(fracBits); }
+};
+
+// Largest number of fractional bits that still represents +-maxAbs in totalBits
+QFormat chooseQFormat(float maxAbs, unsigned totalBits = FIXED_WEIGHT_BITS);
+
+// Round to nearest and saturate instead of wrapping
+inline FixedAct toFixedAct(fp32 value) {
+    const double raw = std::round(double(value) * FixedAct::one);
+    const double lo = std::numeric_limits<i32>::min(), hi = std::numeric_limits<i32>::max();
+    return FixedAct::from_base(i32(raw < lo ? lo : (raw > hi ? hi : raw)));
+}
+
+inline FixedWeight toFixedWeight(fp32 value, unsigned fracBits) {
+    const double raw = std::round(double(value) * double(1 << fracBits));
+    const double lo = std::numeric_limits<FixedWeight>::min(), hi = std::numeric_limits<FixedWeight>::max();
+    return FixedWeight(raw < lo ? lo : (raw > hi ? hi : raw));
+}
+
+// Drop the weight fractional bits of an accumulator (round half up) and saturate back to Q16.16
+inline FixedAct fromFixedAcc(FixedAcc acc, unsigned fracBits) {
+    if (fracBits) acc = (acc + (FixedAcc(1) << (fracBits - 1))) >> fracBits;
+    if (acc > std::numeric_limits<i32>::max()) acc = std::numeric_limits<i32>::max();
+    if (acc < std::numeric_limits<i32>::min()) acc = std::numeric_limits<i32>::min();
+    return FixedAct::from_base(i32(acc));
+}
+
+// Float weights and bias of a Conv/Dense layer converted once at load time
+// Weights keep their layout, bias is pre-scaled to the accumulator format so it seeds the sum directly
+struct FixedWeights {
+    QFormat format;
+    std::vector<FixedWeight> weights;
+    std::vector<FixedAcc> bias;
+
+    void load(const LayerData& weightData, const LayerData& biasData);
+    void clear();
+};
+
+// Convert whole buffers between fp32 and Q16.16 (same element count)
+void floatToFixed(const LayerData& in, LayerData& out);
+void fixedToFloat(const LayerData& in, LayerData& out);
+
+}  // namespace ML
@@ -0,0 +1,92 @@
+#include "Half.h"
+
+#include "CpuDispatch.h"
+
+#if ML_HAS_ISA_TARGETS
+#    include <immintrin.h>
+#endif
+
+namespace ML {
+
+#if ML_HAS_ISA_TARGETS
+namespace {
+ML_TARGET_AVX2 inline fp32 horizontalSum(__m256 v) {
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+    return _mm_cvtss_f32(sum);
+}
+
+// Eight bf16 values to fp32: zero-extend to 32 bits and move them into the upper half
+ML_TARGET_AVX2 inline __m256 widenBFloat16(const bf16* b) {
+    return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)b)), 16));
+}
+
+// Sums of the whole blocks of 16 elements (two accumulators hide the FMA latency), `i` set to the first one left
+ML_TARGET_AVX2 fp32 dotF32F16AVX2(const fp32* a, const fp16* b, std::size_t n, std::size_t& i) {
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(b + i))), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(b + i + 8))), acc1);
+    }
+    return horizontalSum(_mm256_add_ps(acc0, acc1));
+}
+
+ML_TARGET_AVX2 fp32 dotF32BF16AVX2(const fp32* a, const bf16* b, std::size_t n, std::size_t& i) {
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), widenBFloat16(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), widenBFloat16(b + i + 8), acc1);
+    }
+    return horizontalSum(_mm256_add_ps(acc0, acc1));
+}
+}  // namespace
+#endif
+
+fp32 dotF32F16(const fp32* a, const fp16* b, std::size_t n) {
+    std::size_t i = 0;
+    fp32 sum = 0;
+
+#if ML_HAS_ISA_TARGETS
+    if (getIsa() >= Isa::AVX2) sum = dotF32F16AVX2(a, b, n, i);
+#endif
+
+    for (; i < n; i++) sum += a[i] * halfToFloat(b[i]);
+    return sum;
+}
+
+fp32 dotF32BF16(const fp32* a, const bf16* b, std::size_t n) {
+    std::size_t i = 0;
+    fp32 sum = 0;
+
+#if ML_HAS_ISA_TARGETS
+    if (getIsa() >= Isa::AVX2) sum = dotF32BF16AVX2(a, b, n, i);
+#endif
+
+    for (; i < n; i++) sum += a[i] * bfloat16ToFloat(b[i]);
+    return sum;
+}
+
+const char* halfDotKernelName() { return getIsa() >= Isa::AVX2 ? "f16c+fma" : "scalar"; }
+
+void HalfWeights::load(const LayerData& weightData, std::size_t outputCount, Layer::Precision weightFormat) {
+    format = weightFormat;
+    outputs = outputCount;
+    length = weightData.getParams().flat_count() / outputs;
+    const fp32* w = (const fp32*)weightData.raw();
+
+    weights.resize(outputs * length);
+    for (std::size_t m = 0; m < outputs; m++) {
+        for (std::size_t k = 0; k < length; k++) {
+            const fp32 value = w[k * outputs + m];
+            weights[m * length + k] = format == Layer::Precision::BF16 ? floatToBFloat16(value) : floatToHalf(value);
+        }
+    }
+}
+
+void HalfWeights::clear() {
+    weights.clear();
+    weights.shrink_to_fit();
+}
+
+}  // namespace ML
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstring>
+#include <vector>
+
+#if defined(__F16C__)
+#    include <immintrin.h>
+#endif
+
+#include "Types.h"
+#include "layers/Layer.h"
+
+namespace ML {
+
+namespace detail {
+inline ui32 floatBits(fp32 value) {
+    ui32 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline fp32 bitsFloat(ui32 bits) {
+    fp32 value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+}  // namespace detail
+
+// Round to nearest even, overflow to infinity (F16C vcvtps2ph when available)
+inline fp16 floatToHalf(fp32 value) {
+#if defined(__F16C__)
+    return _cvtss_sh(value, 0);
+#else
+    const ui32 f32Infinity = 255u << 23;
+    const ui32 f16Max = (127u + 16) << 23;
+    const ui32 denormMagic = ((127u - 15) + (23 - 10) + 1) << 23;
+
+    ui32 x = detail::floatBits(value);
+    const ui32 sign = x & 0x80000000u;
+    x ^= sign;
+
+    ui32 half;
+    if (x >= f16Max) {
+        half = x > f32Infinity ? 0x7E00 : 0x7C00;  // NaN stays NaN, everything else overflows
+    } else if (x < (113u << 23)) {
+        // Subnormal or zero: let the FPU do the rounding by adding a magic denormal
+        half = detail::floatBits(detail::bitsFloat(x) + detail::bitsFloat(denormMagic)) - denormMagic;
+    } else {
+        const ui32 mantissaOdd = (x >> 13) & 1;
+        x += ((15u - 127) << 23) + 0xFFF;  // Rebias the exponent and round
+        x += mantissaOdd;
+        half = x >> 13;
+    }
+    return fp16(half | (sign >> 16));
+#endif
+}
+
+// Exact widening (F16C vcvtph2ps when available)
+inline fp32 halfToFloat(fp16 value) {
+#if defined(__F16C__)
+    return _cvtsh_ss(value);
+#else
+    const ui32 sign = ui32(value & 0x8000) << 16;
+    ui32 exponent = (value >> 10) & 0x1F;
+    ui32 mantissa = value & 0x3FF;
+
+    if (exponent == 0x1F) return detail::bitsFloat(sign | 0x7F800000 | (mantissa << 13));  // Inf/NaN
+    if (exponent != 0) return detail::bitsFloat(sign | ((exponent + 112) << 23) | (mantissa << 13));
+    if (mantissa == 0) return detail::bitsFloat(sign);
+
+    // Subnormal, normalize the mantissa
+    exponent = 113;
+    while (!(mantissa & 0x400)) {
+        mantissa <<= 1;
+        exponent--;
+    }
+    return detail::bitsFloat(sign | (exponent << 23) | ((mantissa & 0x3FF) << 13));
+#endif
+}
+
+// Upper 16 bits of an fp32, round to nearest even (NaN kept quiet)
+inline bf16 floatToBFloat16(fp32 value) {
+    const ui32 x = detail::floatBits(value);
+    if ((x & 0x7FFFFFFFu) > 0x7F800000u) return bf16((x >> 16) | 0x40);
+    return bf16((x + 0x7FFF + ((x >> 16) & 1)) >> 16);
+}
+
+// Exact widening, bf16 is a truncated fp32
+inline fp32 bfloat16ToFloat(bf16 value) { return detail::bitsFloat(ui32(value) << 16); }
+
+// Dot products of fp32 activations with fp16 / bf16 weights, widened in registers and accumulated in fp32
+// Uses F16C vcvtph2ps (fp16) and an AVX2 zero-extend + shift (bf16) with FMA when the AVX2 tier is active
+fp32 dotF32F16(const fp32* a, const fp16* b, std::size_t n);
+fp32 dotF32BF16(const fp32* a, const bf16* b, std::size_t n);
+
+// Name of the widening dot product kernel of the active instruction set
+const char* halfDotKernelName();
+
+// Float weights of a Conv/Dense layer stored as fp16 or bf16, converted once at load
+// The [K][M] float layout is transposed to [M][K] like QuantizedWeights, so each output reads its weights contiguously
+struct HalfWeights {
+    Layer::Precision format = Layer::Precision::FP16;
+    std::size_t outputs = 0;  // M
+    std::size_t length = 0;   // K
+    std::vector<ui16> weights;
+
+    void load(const LayerData& weightData, std::size_t outputs, Layer::Precision format);
+    void clear();
+
+    // Dot product of n activations with weights [k, k + n) of output m
+    inline fp32 dot(const fp32* in, std::size_t m, std::size_t k, std::size_t n) const {
+        const ui16* w = weights.data() + m * length + k;
+        return format == Layer::Precision::BF16 ? dotF32BF16(in, w, n) : dotF32F16(in, w, n);
+    }
+};
+
+}  // namespace ML
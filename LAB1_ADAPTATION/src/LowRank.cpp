@@ -0,0 +1,142 @@
+#include "LowRank.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+namespace ML {
+
+namespace {
+// Eigenvalues (returned) and column eigenvectors (in `vectors`, n x n row-major) of a symmetric n x n matrix
+// Cyclic Jacobi rotations until the off-diagonal mass is negligible
+std::vector<double> symmetricEigen(std::vector<double> a, std::size_t n, std::vector<double>& vectors) {
+    vectors.assign(n * n, 0.0);
+    for (std::size_t i = 0; i < n; i++) vectors[i * n + i] = 1.0;
+
+    double total = 0;
+    for (double x : a) total += x * x;
+
+    for (int sweep = 0; sweep < 100; sweep++) {
+        double off = 0;
+        for (std::size_t p = 0; p < n; p++) {
+            for (std::size_t q = p + 1; q < n; q++) off += a[p * n + q] * a[p * n + q];
+        }
+        if (off <= 1e-24 * total) break;
+
+        for (std::size_t p = 0; p < n; p++) {
+            for (std::size_t q = p + 1; q < n; q++) {
+                const double apq = a[p * n + q];
+                if (std::fabs(apq) < 1e-300) continue;
+
+                // Rotation angle zeroing a[p][q]
+                const double theta = (a[q * n + q] - a[p * n + p]) / (2 * apq);
+                const double t = (theta >= 0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1));
+                const double c = 1 / std::sqrt(t * t + 1), s = t * c;
+
+                for (std::size_t k = 0; k < n; k++) {
+                    const double akp = a[k * n + p], akq = a[k * n + q];
+                    a[k * n + p] = c * akp - s * akq;
+                    a[k * n + q] = s * akp + c * akq;
+                }
+                for (std::size_t k = 0; k < n; k++) {
+                    const double apk = a[p * n + k], aqk = a[q * n + k];
+                    a[p * n + k] = c * apk - s * aqk;
+                    a[q * n + k] = s * apk + c * aqk;
+                }
+                for (std::size_t k = 0; k < n; k++) {
+                    const double vkp = vectors[k * n + p], vkq = vectors[k * n + q];
+                    vectors[k * n + p] = c * vkp - s * vkq;
+                    vectors[k * n + q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+
+    std::vector<double> values(n);
+    for (std::size_t i = 0; i < n; i++) values[i] = a[i * n + i];
+    return values;
+}
+}  // namespace
+
+double LowRankFactors::energy() const {
+    double kept = 0, total = 0;
+    for (std::size_t i = 0; i < singularValues.size(); i++) {
+        const double s2 = singularValues[i] * singularValues[i];
+        total += s2;
+        if (i < rank) kept += s2;
+    }
+    return total > 0 ? kept / total : 1.0;
+}
+
+LowRankFactors factorLowRank(const fp32* weights, std::size_t rows, std::size_t cols, std::size_t rank) {
+    if (rank == 0 || rank > std::min(rows, cols)) {
+        throw std::runtime_error("Rank " + std::to_string(rank) + " is outside 1.." + std::to_string(std::min(rows, cols)));
+    }
+
+    // Gram matrix W^T W, upper triangle accumulated row by row then mirrored
+    std::vector<double> gram(cols * cols, 0.0);
+    std::vector<double> row(cols);
+    for (std::size_t k = 0; k < rows; k++) {
+        for (std::size_t j = 0; j < cols; j++) row[j] = weights[k * cols + j];
+        for (std::size_t i = 0; i < cols; i++) {
+            const double ri = row[i];
+            if (ri == 0) continue;
+            double* g = gram.data() + i * cols;
+            for (std::size_t j = i; j < cols; j++) g[j] += ri * row[j];
+        }
+    }
+    for (std::size_t i = 0; i < cols; i++) {
+        for (std::size_t j = 0; j < i; j++) gram[i * cols + j] = gram[j * cols + i];
+    }
+
+    std::vector<double> vectors;
+    const std::vector<double> eigenvalues = symmetricEigen(gram, cols, vectors);
+    std::vector<std::size_t> order(cols);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return eigenvalues[a] > eigenvalues[b]; });
+
+    LowRankFactors factors;
+    factors.rows = rows;
+    factors.cols = cols;
+    factors.rank = rank;
+    for (std::size_t i = 0; i < std::min(rows, cols); i++) factors.singularValues.push_back(std::sqrt(std::max(0.0, eigenvalues[order[i]])));
+
+    // V: top right singular vectors as rows
+    factors.v.resize(rank * cols);
+    for (std::size_t j = 0; j < rank; j++) {
+        for (std::size_t m = 0; m < cols; m++) factors.v[j * cols + m] = fp32(vectors[m * cols + order[j]]);
+    }
+
+    // U = W V^T, so U V is the projection of W onto the kept singular directions
+    factors.u.resize(rows * rank);
+    for (std::size_t k = 0; k < rows; k++) {
+        for (std::size_t j = 0; j < rank; j++) {
+            double sum = 0;
+            for (std::size_t m = 0; m < cols; m++) sum += double(weights[k * cols + m]) * vectors[m * cols + order[j]];
+            factors.u[k * rank + j] = fp32(sum);
+        }
+    }
+    return factors;
+}
+
+double reconstructionError(const fp32* weights, const LowRankFactors& factors) {
+    double error = 0, norm = 0;
+    std::vector<double> row(factors.cols);
+    for (std::size_t k = 0; k < factors.rows; k++) {
+        std::fill(row.begin(), row.end(), 0.0);
+        for (std::size_t j = 0; j < factors.rank; j++) {
+            const double ukj = factors.u[k * factors.rank + j];
+            for (std::size_t m = 0; m < factors.cols; m++) row[m] += ukj * factors.v[j * factors.cols + m];
+        }
+        for (std::size_t m = 0; m < factors.cols; m++) {
+            const double w = weights[k * factors.cols + m];
+            error += (w - row[m]) * (w - row[m]);
+            norm += w * w;
+        }
+    }
+    return norm > 0 ? std::sqrt(error / norm) : 0.0;
+}
+
+}  // namespace ML
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Types.h"
+
+namespace ML {
+
+// Rank-k factorization W ~= U V of a [rows][cols] weight matrix from its truncated SVD
+// V holds the top right singular vectors and U = W V^T, the closest rank-k matrix in Frobenius norm
+struct LowRankFactors {
+    std::size_t rows = 0, cols = 0, rank = 0;
+    std::vector<fp32> u;                 // [rows][rank]
+    std::vector<fp32> v;                 // [rank][cols]
+    std::vector<double> singularValues;  // All min(rows, cols) singular values of W, descending
+
+    // Fraction of the squared Frobenius norm of W the kept singular values carry
+    double energy() const;
+};
+
+// Factor a [rows][cols] matrix with rank <= min(rows, cols)
+// The SVD comes from a Jacobi eigendecomposition of the cols x cols Gram matrix W^T W, meant for cols in the hundreds
+LowRankFactors factorLowRank(const fp32* weights, std::size_t rows, std::size_t cols, std::size_t rank);
+
+// ||W - U V||_F / ||W||_F measured on the fp32 factors
+double reconstructionError(const fp32* weights, const LowRankFactors& factors);
+
+}  // namespace ML
@@ -1,12 +1,31 @@
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <fstream>
+#include <iomanip>
+#include <map>
 #include <iostream>
 #include <sstream>
 #include <vector>
 #include <algorithm>
 
 #include "Config.h"
+#include "Accelerator.h"
+#include "Benchmark.h"
+#include "Calibration.h"
+#include "CpuDispatch.h"
 #include "Model.h"
+#include "LowRank.h"
+#include "PerfCounters.h"
+#include "Server.h"
+#include "SharedRing.h"
+#include "StaticModel.h"
+#include "Sparse.h"
+#include "Trace.h"
 #include "Types.h"
 #include "Utils.h"
+#include "Validation.h"
+#include "layers/ClassifierHead.h"
 #include "layers/Convolutional.h"
 #include "layers/Dense.h"
 #include "layers/Flatten.h"
@@ -16,15 +35,108 @@
 
 #ifdef ZEDBOARD
 #include <file_transfer/file_transfer.h>
+#else
+#include <sys/stat.h>
+
+#include <csignal>
 #endif
 
 namespace ML {
 
+// Command line options for the host build
+struct RunOptions {
+    std::string command = "test";  // test | bench | validate | calibrate | sweep | prune | factor | shrink | serve | loadgen | shm-serve | shm-loadgen | packbench | dataflow | static | streamcheck
+    std::string modelPath = "data/model_weights";  // Weight directory, e.g. the output of `ml prune`
+    Layer::InfType infType = Layer::InfType::NAIVE;
+    std::string tracePath;  // Chrome trace of the full inference test, empty to disable
+    bool perfCounters = false;  // Per-layer hardware counters for the full inference test
+
+    std::vector<Layer::InfType> benchInfTypes;  // Inference types to benchmark (defaults to infType)
+    BenchmarkConfig bench;
+    bool itersGiven = false;  // --iters was passed (sweep otherwise keeps its latency runs short)
+
+    std::vector<PrecisionPlan> precisions;  // Precision plans to run (defaults to fp32), test only uses the first
+    std::string calibrationPath;            // Int8 activation ranges, measured on the bundled input when empty
+
+    std::vector<ValidationCase> validationCases;  // Defaults to the bundled test input and feature maps
+    std::size_t jobs = 1;                         // Validation cases run concurrently
+
+    std::vector<std::string> inputs;  // Sweep inputs, defaults to the bundled test input
+
+    float sparsity = 0.8f;                 // Fraction of weight blocks `ml prune` zeroes
+    BlockShape block;                      // Pruning block shape
+    std::size_t rank = 64;                 // Rank `ml factor` keeps
+    std::vector<std::string> layers;       // Layers `ml prune`/`ml factor` rewrite (defaults to fc1)
+    std::string outPath;                   // Rewritten weight directory (defaults to data/model_weights_pruned|rankN|shrunk)
+    float threshold = 0;                   // `ml shrink` removes channels whose activations never exceed it
+
+    ServerConfig server;  // `ml serve` socket and batching
+    LoadGenConfig loadGen;  // `ml loadgen` clients (socket shared with server)
+    std::string shmName = "/ml_ring";  // `ml shm-serve`/`ml shm-loadgen` shared-memory ring
+    std::size_t shmSlots = 16;
+};
+
+// Parse an inference type name (naive, threaded, tiled, simd)
+Layer::InfType parseInfType(const std::string& name) {
+    if (name == "naive") return Layer::InfType::NAIVE;
+    if (name == "threaded") return Layer::InfType::THREADED;
+    if (name == "tiled") return Layer::InfType::TILED;
+    if (name == "simd") return Layer::InfType::SIMD;
+    if (name == "accel") return Layer::InfType::ACCEL;
+    throw std::runtime_error("Unknown inference type: " + name);
+}
+
+// Fixed-point Conv/Dense layers have naive and threaded kernels only
+bool planRunsOn(const PrecisionPlan& plan, Layer::InfType infType) {
+    return !plan.uses(Layer::Precision::FIXED) || (infType != Layer::InfType::TILED && infType != Layer::InfType::SIMD);
+}
+
+void requirePlanRunsOn(const PrecisionPlan& plan, Layer::InfType infType) {
+    if (!planRunsOn(plan, infType)) {
+        throw std::runtime_error("Precision " + plan.str() + " runs fixed-point layers, which have naive and threaded kernels only, not " +
+                                 infTypeName(infType));
+    }
+}
+
+// Output channel count of each convolution: the trained counts, or those in the channels.txt ("name count" lines) of
+// a weight directory written by `ml shrink`
+struct ConvChannels {
+    std::map<std::string, std::size_t> counts = {{"conv1_1", 32}, {"conv1_2", 32}, {"conv2_1", 64},
+                                                 {"conv2_2", 64}, {"conv3_1", 64}, {"conv3_2", 128}};
+
+    std::size_t operator[](const std::string& name) const { return counts.at(name); }
+
+    static ConvChannels load(const Path& modelPath) {
+        ConvChannels channels;
+        std::ifstream file(modelPath / "channels.txt");
+        std::string name;
+        std::size_t count;
+        while (file >> name >> count) {
+            if (!channels.counts.count(name) || count == 0 || count > channels.counts[name]) {
+                throw std::runtime_error("Bad channel count for `" + name + "` in " + modelPath / "channels.txt");
+            }
+            channels.counts[name] = count;
+        }
+        return channels;
+    }
+
+    void save(const Path& modelPath) const {
+        std::ofstream file(modelPath / "channels.txt");
+        if (!file.is_open()) throw std::runtime_error("Failed to open " + modelPath / "channels.txt" + " for writing");
+        for (const auto& entry : counts) file << entry.first << " " << entry.second << "\n";
+    }
+};
+
 // Build AudioCNN_IRMAS model for musical instrument classification
 Model buildAudioCNN_IRMAS(const Path modelPath) {
     Model model;
     logInfo("--- Building AudioCNN_IRMAS Model ---");
 
+    // Output channels of each convolution, fewer than trained after `ml shrink`
+    const ConvChannels channels = ConvChannels::load(modelPath);
+    const std::size_t c1_1 = channels["conv1_1"], c1_2 = channels["conv1_2"], c2_1 = channels["conv2_1"], c2_2 = channels["conv2_2"],
+                      c3_1 = channels["conv3_1"], c3_2 = channels["conv3_2"];
+
     // === Convolutional Block 1 ===
     
     // Layer 0: conv1_1 (5x5x1x32)
@@ -32,29 +144,29 @@ Model buildAudioCNN_IRMAS(const Path modelPath) {
     // Output: 124x124x32 (valid padding: 128-5+1=124)
     model.addLayer<ConvolutionalLayer>(
         LayerParams{sizeof(fp32), {128, 128, 1}},                                        // Input Data
-        LayerParams{sizeof(fp32), {124, 124, 32}},                                       // Output Data
-        LayerParams{sizeof(fp32), {5, 5, 1, 32}, modelPath / "conv1_1_weights.bin"},   // Weights
-        LayerParams{sizeof(fp32), {32}, modelPath / "conv1_1_bias.bin"}                // Bias
-    );
+        LayerParams{sizeof(fp32), {124, 124, c1_1}},                                     // Output Data
+        LayerParams{sizeof(fp32), {5, 5, 1, c1_1}, modelPath / "conv1_1_weights.bin"}, // Weights
+        LayerParams{sizeof(fp32), {c1_1}, modelPath / "conv1_1_bias.bin"}              // Bias
+    ).setName("conv1_1");
 
     // Layer 1: conv1_2 (5x5x32x32)
     // Input: 124x124x32
     // Output: 120x120x32 (124-5+1=120)
     model.addLayer<ConvolutionalLayer>(
-        LayerParams{sizeof(fp32), {124, 124, 32}},
-        LayerParams{sizeof(fp32), {120, 120, 32}},
-        LayerParams{sizeof(fp32), {5, 5, 32, 32}, modelPath / "conv1_2_weights.bin"},
-        LayerParams{sizeof(fp32), {32}, modelPath / "conv1_2_bias.bin"}
-    );
+        LayerParams{sizeof(fp32), {124, 124, c1_1}},
+        LayerParams{sizeof(fp32), {120, 120, c1_2}},
+        LayerParams{sizeof(fp32), {5, 5, c1_1, c1_2}, modelPath / "conv1_2_weights.bin"},
+        LayerParams{sizeof(fp32), {c1_2}, modelPath / "conv1_2_bias.bin"}
+    ).setName("conv1_2");
 
     // Layer 2: pool1 (2x2 max pooling)
     // Input: 120x120x32
     // Output: 60x60x32
     model.addLayer<MaxPoolingLayer>(
-        LayerParams{sizeof(fp32), {120, 120, 32}},
-        LayerParams{sizeof(fp32), {60, 60, 32}},
+        LayerParams{sizeof(fp32), {120, 120, c1_2}},
+        LayerParams{sizeof(fp32), {60, 60, c1_2}},
         LayerParams{sizeof(fp32), {2, 2}}
-    );
+    ).setName("pool1");
 
     // === Convolutional Block 2 ===
     
@@ -62,30 +174,30 @@ Model buildAudioCNN_IRMAS(const Path modelPath) {
     // Input: 60x60x32
     // Output: 58x58x64 (60-3+1=58)
     model.addLayer<ConvolutionalLayer>(
-        LayerParams{sizeof(fp32), {60, 60, 32}},
-        LayerParams{sizeof(fp32), {58, 58, 64}},
-        LayerParams{sizeof(fp32), {3, 3, 32, 64}, modelPath / "conv2_1_weights.bin"},
-        LayerParams{sizeof(fp32), {64}, modelPath / "conv2_1_bias.bin"}
-    );
+        LayerParams{sizeof(fp32), {60, 60, c1_2}},
+        LayerParams{sizeof(fp32), {58, 58, c2_1}},
+        LayerParams{sizeof(fp32), {3, 3, c1_2, c2_1}, modelPath / "conv2_1_weights.bin"},
+        LayerParams{sizeof(fp32), {c2_1}, modelPath / "conv2_1_bias.bin"}
+    ).setName("conv2_1");
 
     // Layer 4: conv2_2 (3x3x64x64)
     // Input: 58x58x64
     // Output: 56x56x64 (58-3+1=56)
     model.addLayer<ConvolutionalLayer>(
-        LayerParams{sizeof(fp32), {58, 58, 64}},
-        LayerParams{sizeof(fp32), {56, 56, 64}},
-        LayerParams{sizeof(fp32), {3, 3, 64, 64}, modelPath / "conv2_2_weights.bin"},
-        LayerParams{sizeof(fp32), {64}, modelPath / "conv2_2_bias.bin"}
-    );
+        LayerParams{sizeof(fp32), {58, 58, c2_1}},
+        LayerParams{sizeof(fp32), {56, 56, c2_2}},
+        LayerParams{sizeof(fp32), {3, 3, c2_1, c2_2}, modelPath / "conv2_2_weights.bin"},
+        LayerParams{sizeof(fp32), {c2_2}, modelPath / "conv2_2_bias.bin"}
+    ).setName("conv2_2");
 
     // Layer 5: pool2 (2x2 max pooling)
     // Input: 56x56x64
     // Output: 28x28x64
     model.addLayer<MaxPoolingLayer>(
-        LayerParams{sizeof(fp32), {56, 56, 64}},
-        LayerParams{sizeof(fp32), {28, 28, 64}},
+        LayerParams{sizeof(fp32), {56, 56, c2_2}},
+        LayerParams{sizeof(fp32), {28, 28, c2_2}},
         LayerParams{sizeof(fp32), {2, 2}}
-    );
+    ).setName("pool2");
 
     // === Convolutional Block 3 ===
     
@@ -93,30 +205,30 @@ Model buildAudioCNN_IRMAS(const Path modelPath) {
     // Input: 28x28x64
     // Output: 26x26x64 (28-3+1=26)
     model.addLayer<ConvolutionalLayer>(
-        LayerParams{sizeof(fp32), {28, 28, 64}},
-        LayerParams{sizeof(fp32), {26, 26, 64}},
-        LayerParams{sizeof(fp32), {3, 3, 64, 64}, modelPath / "conv3_1_weights.bin"},
-        LayerParams{sizeof(fp32), {64}, modelPath / "conv3_1_bias.bin"}
-    );
+        LayerParams{sizeof(fp32), {28, 28, c2_2}},
+        LayerParams{sizeof(fp32), {26, 26, c3_1}},
+        LayerParams{sizeof(fp32), {3, 3, c2_2, c3_1}, modelPath / "conv3_1_weights.bin"},
+        LayerParams{sizeof(fp32), {c3_1}, modelPath / "conv3_1_bias.bin"}
+    ).setName("conv3_1");
 
     // Layer 7: conv3_2 (3x3x64x128)
     // Input: 26x26x64
     // Output: 24x24x128 (26-3+1=24)
     model.addLayer<ConvolutionalLayer>(
-        LayerParams{sizeof(fp32), {26, 26, 64}},
-        LayerParams{sizeof(fp32), {24, 24, 128}},
-        LayerParams{sizeof(fp32), {3, 3, 64, 128}, modelPath / "conv3_2_weights.bin"},
-        LayerParams{sizeof(fp32), {128}, modelPath / "conv3_2_bias.bin"}
-    );
+        LayerParams{sizeof(fp32), {26, 26, c3_1}},
+        LayerParams{sizeof(fp32), {24, 24, c3_2}},
+        LayerParams{sizeof(fp32), {3, 3, c3_1, c3_2}, modelPath / "conv3_2_weights.bin"},
+        LayerParams{sizeof(fp32), {c3_2}, modelPath / "conv3_2_bias.bin"}
+    ).setName("conv3_2");
 
     // Layer 8: pool3 (2x2 max pooling)
     // Input: 24x24x128
     // Output: 12x12x128
     model.addLayer<MaxPoolingLayer>(
-        LayerParams{sizeof(fp32), {24, 24, 128}},
-        LayerParams{sizeof(fp32), {12, 12, 128}},
+        LayerParams{sizeof(fp32), {24, 24, c3_2}},
+        LayerParams{sizeof(fp32), {12, 12, c3_2}},
         LayerParams{sizeof(fp32), {2, 2}}
-    );
+    ).setName("pool3");
 
     // === Fully Connected Layers ===
     
@@ -124,18 +236,18 @@ Model buildAudioCNN_IRMAS(const Path modelPath) {
     // Input: 12x12x128 = 18,432
     // Output: 18,432
     model.addLayer<FlattenLayer>(
-        LayerParams{sizeof(fp32), {12, 12, 128}},
-        LayerParams{sizeof(fp32), {18432}}
-    );
+        LayerParams{sizeof(fp32), {12, 12, c3_2}},
+        LayerParams{sizeof(fp32), {12 * 12 * c3_2}}
+    ).setName("flatten");
 
     // Layer 10: fc1 (Dense 18432 -> 256)
     // Note: ReLU activation is applied in Dense layer
     model.addLayer<DenseLayer>(
-        LayerParams{sizeof(fp32), {18432}},
+        LayerParams{sizeof(fp32), {12 * 12 * c3_2}},
         LayerParams{sizeof(fp32), {256}},
-        LayerParams{sizeof(fp32), {18432, 256}, modelPath / "fc1_weights.bin"},
+        LayerParams{sizeof(fp32), {12 * 12 * c3_2, 256}, modelPath / "fc1_weights.bin"},
         LayerParams{sizeof(fp32), {256}, modelPath / "fc1_bias.bin"}
-    );
+    ).setName("fc1");
 
     // Note: Dropout is skipped during inference
 
@@ -146,13 +258,24 @@ Model buildAudioCNN_IRMAS(const Path modelPath) {
         LayerParams{sizeof(fp32), {10}},
         LayerParams{sizeof(fp32), {256, 10}, modelPath / "fc2_weights.bin"},
         LayerParams{sizeof(fp32), {10}, modelPath / "fc2_bias.bin"}
-    );
+    ).setName("fc2");
 
     // Layer 12: softmax (for classification probabilities)
     model.addLayer<SoftmaxLayer>(
         LayerParams{sizeof(fp32), {10}},
         LayerParams{sizeof(fp32), {10}}
-    );
+    ).setName("softmax");
+
+    // Dense layers factored by `ml factor` run low-rank, the rank follows from the size of U
+    for (std::size_t i = 0; i < model.getNumLayers(); i++) {
+        if (model.getLayer(i).getLType() != Layer::LayerType::DENSE) continue;
+        DenseLayer& dense = static_cast<DenseLayer&>(model.getLayer(i));
+        const Path uPath = modelPath / (dense.getName() + "_u.bin");
+        const long long uBytes = fileSize(uPath);
+        if (uBytes <= 0) continue;
+        dense.setLowRank(uBytes / (dense.getWeightParams().dims[0] * sizeof(fp32)), uPath, modelPath / (dense.getName() + "_v.bin"));
+        logInfo(dense.getName() + ": low-rank weights, rank " + std::to_string(dense.getRank()));
+    }
 
     logInfo("AudioCNN_IRMAS Model built successfully!");
     logInfo("Total layers: 13 (8 Conv, 3 MaxPool, 1 Flatten, 2 Dense, 1 Softmax)");
@@ -160,98 +283,68 @@ Model buildAudioCNN_IRMAS(const Path modelPath) {
     return model;
 }
 
-void runLayerTest(const std::size_t layerNum, const Model& model, const Path& basePath, const LayerData& inputData) {
-    logInfo(std::string("--- Running Layer Test ") + std::to_string(layerNum) + " ---");
-    
-    try {
-        Timer timer("Layer Inference");
-
-        // Run inference on the model up to the specified layer
-        timer.start();
-        
-        // Start with layer 0
-        model.inferenceLayer(inputData, 0, Layer::InfType::NAIVE);
-        const LayerData* output = &model[0].getOutputData();
-        
-        // Run subsequent layers up to layerNum
-        for (std::size_t i = 1; i <= layerNum; i++) {
-            model.inferenceLayer(*output, i, Layer::InfType::NAIVE);
-            output = &model[i].getOutputData();
-        }
-        
-        timer.stop();
-        
-        // Debug: Print first few values for problematic layers
-        if (layerNum == 6 || layerNum == 7) {
-            std::cout << "First 10 output values: ";
-            for (size_t i = 0; i < std::min(size_t(10), output->getParams().flat_count()); i++) {
-                std::cout << output->get<fp32>(i) << " ";
-            }
-            std::cout << std::endl;
+// Build the model with each layer in the precision the plan gives it (int8 quantized with `calibration`) and the
+// classifier head fused as --head asks
+Model buildAudioCNN_IRMAS(const Path modelPath, const PrecisionPlan& plan, const Calibration* calibration = nullptr) {
+    Model model = buildAudioCNN_IRMAS(modelPath);
+    if (!plan.isFP32()) {
+        model.setPrecisionPlan(plan, calibration);
+        logInfo("Running in " + plan.str() + " precision (" + std::to_string(model.getNumLayers()) + " layers with conversions, " +
+                std::to_string(model.getActivationBytes() / 1024) + " KiB of activations)");
+        if (plan.uses(Layer::Precision::FP16) || plan.uses(Layer::Precision::BF16)) {
+            logInfo(std::string("Half weights widened by the ") + halfDotKernelName() + " kernel");
         }
+    }
+    if (getHeadMode() != HeadMode::NONE) {
+        model.fuseClassifierHead(getHeadMode());
+        if (model.getOutputLayer().getLType() == Layer::LayerType::CLASSIFIER_HEAD) logInfo(model.getOutputLayer().getName() + ": " + headModeName(getHeadMode()) + " classifier head");
+    }
+    return model;
+}
 
-        // Print the output dimensions
-        std::cout << "Layer " << layerNum << " output dimensions: ";
-        for (size_t dim : output->getParams().dims) {
-            std::cout << dim << " ";
-        }
-        std::cout << "(total: " << output->getParams().flat_count() << " elements)" << std::endl;
-
-        // Load the expected output for this specific layer
-        std::string expectedFileName = "layer_" + std::to_string(layerNum) + "_output.bin";
-        Path expectedPath = basePath / expectedFileName.c_str();
-        
-        // Check if expected file exists
-        std::ifstream file(expectedPath, std::ios::binary | std::ios::ate);
-        if (!file.is_open()) {
-            std::cout << "Expected output file not found: " << expectedPath << std::endl;
-            std::cout << "Skipping comparison for layer " << layerNum << std::endl;
-            return;
-        }
-        
-        std::streamsize size = file.tellg();
-        std::cout << "Expected file size: " << size << " bytes (" << size/4 << " elements)" << std::endl;
-        file.close();
-        
-        // Calculate expected elements
-        size_t expectedElements = size / 4;
-        size_t outputElements = output->getParams().flat_count();
-        
-        if (expectedElements != outputElements) {
-            std::cout << "DIMENSION MISMATCH: Output has " << outputElements 
-                      << " elements, expected " << expectedElements << std::endl;
-            return;
-        }
-        
-        // Create LayerData for comparison
-        LayerData expected(output->getParams(), expectedPath);
-        expected.loadData();
-        
-        // Debug: Print first few expected values for problematic layers
-        if (layerNum == 6 || layerNum == 7) {
-            std::cout << "First 10 expected values: ";
-            for (size_t i = 0; i < std::min(size_t(10), expected.getParams().flat_count()); i++) {
-                std::cout << expected.get<fp32>(i) << " ";
-            }
-            std::cout << std::endl;
-        }
-        
-        // Compare the outputs
-        output->compareWithinPrint<fp32>(expected);
-        
-    } catch (const std::exception& e) {
-        std::cout << "Layer " << layerNum << " test failed: " << e.what() << std::endl;
+// Measure activation ranges by running the fp32 model on each case (the bundled test input by default)
+Calibration runCalibration(const std::vector<ValidationCase>& calibrationCases) {
+    Path basePath("data");
+    std::vector<ValidationCase> cases = calibrationCases;
+    if (cases.empty()) cases.push_back({basePath / "test_input.bin", basePath / "feature_maps"});
+
+    Model model = buildAudioCNN_IRMAS(basePath / "model_weights");
+    model.allocLayers();
+    Calibration calibration = calibrate(model, cases);
+    model.freeLayers();
+    return calibration;
+}
+
+// Calibration for int8 and u8 activation storage runs: loaded from --calibration, otherwise measured on the fly
+Calibration loadCalibration(const RunOptions& options, const std::vector<PrecisionPlan>& plans) {
+    Calibration calibration;
+    if (std::none_of(plans.begin(), plans.end(), [](const PrecisionPlan& plan) {
+            return plan.uses(Layer::Precision::INT8) || plan.activations == Layer::Storage::U8;
+        })) {
+        return calibration;
+    }
+
+    if (!options.calibrationPath.empty()) {
+        calibration.load(options.calibrationPath.c_str());
+        logInfo("Loaded int8 calibration from " + options.calibrationPath);
+    } else {
+        // The bundled input is also what test/validate/bench evaluate by default, so its ranges fit it exactly
+        logWarn("No --calibration given, calibrating int8 ranges on the bundled test input: results on that input are "
+                "evaluated on the calibration data and overly optimistic. Calibrate on separate inputs with "
+                "`ml calibrate --case input.bin feature_map_dir` and pass the file with --calibration");
+        calibration = runCalibration({});
     }
+    return calibration;
 }
 
-void runInferenceTest(const Model& model, const LayerData& inputData) {
+void runInferenceTest(const Model& model, const LayerData& inputData, const Layer::InfType infType = Layer::InfType::NAIVE) {
     logInfo("--- Running Full Inference Test ---");
 
     Timer timer("Full Inference");
 
     // Run full inference on the model
     timer.start();
-    const LayerData& output = model.inference(inputData, Layer::InfType::NAIVE);
+    const LayerData& output = model.inference(inputData, infType);
     timer.stop();
 
     // Print output dimensions
@@ -267,32 +360,47 @@ void runInferenceTest(const Model& model, const LayerData& inputData) {
         "Organ", "Piano", "Saxophone", "Trumpet", "Violin"
     };
     
+    // A fused classifier head ranked the classes as it computed them, otherwise select from the probabilities
     const size_t numClasses = output.getParams().flat_count();
-    std::cout << "\nTop-5 predictions:" << std::endl;
-    std::vector<std::pair<fp32, size_t>> predictions;
-    for (size_t i = 0; i < numClasses; ++i) {
-        predictions.push_back({output.get<fp32>(i), i});
+    const Layer& outputLayer = model.getOutputLayer();
+    ClassScore selected[Config::HEAD_TOP_K];
+    const ClassScore* predictions = selected;
+    size_t count = 0;
+    if (outputLayer.getLType() == Layer::LayerType::CLASSIFIER_HEAD) {
+        const ClassifierHeadLayer& head = static_cast<const ClassifierHeadLayer&>(outputLayer);
+        predictions = head.getTopK();
+        count = head.getTopKCount();
+    } else {
+        count = selectTopK((const fp32*)output.raw(), numClasses, Config::HEAD_TOP_K, selected);
     }
-    std::sort(predictions.begin(), predictions.end(), std::greater<std::pair<fp32, size_t>>());
-    
-    for (size_t i = 0; i < std::min(size_t(5), numClasses); ++i) {
-        std::cout << "  " << (i+1) << ". " << instrumentNames[predictions[i].second]
-                  << " (class " << predictions[i].second << "): " 
-                  << (predictions[i].first * 100.0f) << "%" << std::endl;
+
+    if (count == 1) {
+        std::cout << "\nPrediction: " << instrumentNames[predictions[0].label] << " (class " << predictions[0].label
+                  << "), logit " << predictions[0].score << std::endl;
+        return;
+    }
+    std::cout << "\nTop-" << count << " predictions:" << std::endl;
+    for (size_t i = 0; i < count; ++i) {
+        std::cout << "  " << (i+1) << ". " << instrumentNames[predictions[i].label]
+                  << " (class " << predictions[i].label << "): " 
+                  << (predictions[i].score * 100.0f) << "%" << std::endl;
     }
 }
 
-void runAllLayerTests(const Model& model, const Path& basePath, const LayerData& inputData) {
+// Validate every layer against its reference feature map with a single forward pass
+bool runAllLayerTests(Model& model, const Path& basePath, const LayerData& inputData, const Layer::InfType infType = Layer::InfType::NAIVE) {
     logInfo("--- Running All Layer Tests ---");
-    
-    // Test all layers (0-12 for AudioCNN_IRMAS)
-    size_t numLayers = model.getNumLayers();
-    for (std::size_t layerNum = 0; layerNum < numLayers; ++layerNum) {
-        runLayerTest(layerNum, model, basePath, inputData);
-    }
+
+    LayerValidator validator(basePath);
+    model.addObserver(&validator);
+    model.inference(inputData, infType);
+    model.removeObserver(&validator);
+
+    printValidationResults({inputData.getParams().filePath, basePath}, validator.getResults());
+    return validator.allPassed();
 }
 
-void runTests() {
+void runTests(const RunOptions& options = RunOptions()) {
     logInfo("========================================");
     logInfo("  AudioCNN_IRMAS Model Testing");
     logInfo("  Musical Instrument Classification");
@@ -300,11 +408,14 @@ void runTests() {
     
     // Base paths for audio model
     Path basePath("data");
-    Path modelPath = basePath / "model_weights";
+    Path modelPath = options.modelPath.c_str();
     Path featureMapsPath = basePath / "feature_maps";
     
     // Build the AudioCNN_IRMAS model
-    Model model = buildAudioCNN_IRMAS(modelPath);
+    const PrecisionPlan plan = options.precisions.empty() ? PrecisionPlan() : options.precisions[0];
+    requirePlanRunsOn(plan, options.infType);
+    Calibration calibration = loadCalibration(options, options.precisions);
+    Model model = buildAudioCNN_IRMAS(modelPath, plan, &calibration);
     model.allocLayers();
     
     // Load a test mel-spectrogram (128x128x1)
@@ -314,10 +425,39 @@ void runTests() {
     logInfo("Test input loaded successfully!");
     
     // Run layer-by-layer tests
-    runAllLayerTests(model, featureMapsPath, melSpec);
+    runAllLayerTests(model, featureMapsPath, melSpec, options.infType);
     
-    // Run full inference test
-    runInferenceTest(model, melSpec);
+    // Run full inference test (traced/profiled when requested, accelerator traffic reported for ACCEL)
+    Tracer tracer;
+    std::unique_ptr<PerfCounters> counters;
+    AcceleratorProfiler accelProfiler;
+    if (!options.tracePath.empty()) model.addObserver(&tracer);
+    if (options.perfCounters) {
+        counters.reset(new PerfCounters());
+        model.addObserver(counters.get());
+    }
+    TileProfiler tileProfiler;
+    const bool tiled = options.infType == Layer::InfType::TILED || options.infType == Layer::InfType::ACCEL;
+    if (options.infType == Layer::InfType::ACCEL) model.addObserver(&accelProfiler);
+    if (tiled) model.addObserver(&tileProfiler);
+    runInferenceTest(model, melSpec, options.infType);
+    if (options.infType == Layer::InfType::ACCEL) {
+        model.removeObserver(&accelProfiler);
+        accelProfiler.report();
+    }
+    if (tiled) {
+        model.removeObserver(&tileProfiler);
+        tileProfiler.report();
+    }
+    if (counters) {
+        model.removeObserver(counters.get());
+        counters->report();
+    }
+    if (!options.tracePath.empty()) {
+        model.removeObserver(&tracer);
+        tracer.writeChromeTrace(options.tracePath.c_str());
+        logInfo("Wrote " + std::to_string(tracer.numEvents()) + " trace events to " + options.tracePath);
+    }
     
     // Clean up
     model.freeLayers();
@@ -325,6 +465,643 @@ void runTests() {
     std::cout << "\n\n----- ML::runTests() COMPLETE -----\n";
 }
 
+void runBenchmarks(const RunOptions& options) {
+    logInfo("--- Running Latency Benchmark ---");
+
+    Path basePath("data");
+    LayerData melSpec({sizeof(fp32), {128, 128, 1}, basePath / "test_input.bin"});
+    melSpec.loadData();
+
+    std::vector<Layer::InfType> infTypes = options.benchInfTypes;
+    if (infTypes.empty()) infTypes.push_back(options.infType);
+    std::vector<PrecisionPlan> precisions = options.precisions;
+    if (precisions.empty()) precisions.push_back(PrecisionPlan());
+
+    Calibration calibration = loadCalibration(options, precisions);
+    std::vector<BenchmarkResult> results;
+    for (const PrecisionPlan& precision : precisions) {
+        Model model = buildAudioCNN_IRMAS(options.modelPath.c_str(), precision, &calibration);
+        model.allocLayers();
+
+        for (Layer::InfType infType : infTypes) {
+            if (!planRunsOn(precision, infType)) {
+                logWarn(std::string("Skipping ") + infTypeName(infType) + " " + precision.str() + ": fixed-point layers run naive or threaded only");
+                continue;
+            }
+            logInfo(std::string("Benchmarking ") + infTypeName(infType) + " " + precision.str() + " inference...");
+            results.push_back(runLatencyBenchmark(model, melSpec, infType, options.bench));
+            results.back().precision = precision.str();
+        }
+
+        model.freeLayers();
+    }
+    printBenchmarkResults(results, options.bench);
+}
+
+// Single-pass validation of one or more inputs against their reference feature maps
+bool runValidation(const RunOptions& options) {
+    logInfo("--- Running Layer Validation ---");
+
+    Path basePath("data");
+    std::vector<ValidationCase> cases = options.validationCases;
+    if (cases.empty()) cases.push_back({basePath / "test_input.bin", basePath / "feature_maps"});
+
+    std::vector<PrecisionPlan> precisions = options.precisions;
+    if (precisions.empty()) precisions.push_back(PrecisionPlan());
+
+    for (const PrecisionPlan& precision : precisions) requirePlanRunsOn(precision, options.infType);
+    Calibration calibration = loadCalibration(options, precisions);
+    Path modelPath = options.modelPath.c_str();
+    bool passed = true;
+    for (const PrecisionPlan& precision : precisions) {
+        std::vector<std::vector<LayerValidator::Result>> results =
+            validateCases([&]() { return buildAudioCNN_IRMAS(modelPath, precision, &calibration); }, cases, options.infType, options.jobs);
+
+        for (std::size_t i = 0; i < cases.size(); i++) {
+            if (precisions.size() > 1) std::cout << "\n[" << precision.str() << "]";
+            printValidationResults(cases[i], results[i]);
+            for (const LayerValidator::Result& result : results[i]) passed &= !result.compared || result.passed;
+        }
+    }
+    return passed;
+}
+
+// Measure int8 activation ranges and save them for later --calibration runs
+void runCalibrationTool(const RunOptions& options) {
+    logInfo("--- Running Int8 Calibration ---");
+    if (options.validationCases.empty()) {
+        logWarn("No --case given, calibrating on the bundled test input, the same input test/validate/bench evaluate by default");
+    }
+
+    Calibration calibration = runCalibration(options.validationCases);
+    std::string outPath = options.calibrationPath.empty() ? "data/calibration.txt" : options.calibrationPath;
+    calibration.save(outPath.c_str());
+
+    std::cout << "\nActivation ranges (" << dotU8S8KernelName() << " int8 kernels):\n";
+    for (const auto& entry : calibration.getRanges()) {
+        const QuantParams quant = calibration.quantParams(entry.first);
+        std::cout << "  " << std::left << std::setw(10) << entry.first << std::right << " [" << std::setw(11) << entry.second.min << ", "
+                  << std::setw(11) << entry.second.max << "]  scale " << quant.scale << "  zero point " << quant.zeroPoint << "\n";
+    }
+    logInfo("Wrote calibration to " + outPath);
+}
+
+// Index of the largest output
+std::size_t argmax(const LayerData& output) {
+    std::size_t best = 0;
+    for (std::size_t i = 1; i < output.getParams().flat_count(); i++) {
+        if (output.get<fp32>(i) > output.get<fp32>(best)) best = i;
+    }
+    return best;
+}
+
+// Accuracy proxy and latency of each precision plan against the fp32 model
+struct SweepResult {
+    std::string plan;
+    std::size_t agree = 0;  // Inputs whose top-1 class matches fp32
+    float minCosine = 1;    // Worst output cosine similarity to fp32
+    float maxAbs = 0;       // Largest output probability difference to fp32
+    double p50Ms = 0;
+    bool pareto = false;    // No other plan agrees as often and is faster
+};
+
+// Run every precision plan on the sweep inputs and report how far each one drifts from fp32 and how fast it is
+void runPrecisionSweep(const RunOptions& options) {
+    logInfo("--- Running Precision Sweep ---");
+
+    Path modelPath = options.modelPath.c_str();
+    std::vector<std::string> inputPaths = options.inputs;
+    if (inputPaths.empty()) inputPaths.push_back("data/test_input.bin");
+
+    std::vector<PrecisionPlan> plans = options.precisions;
+    if (plans.empty()) {
+        for (const char* plan : {"fp32", "fp16", "bf16", "fixed", "int8", "int8,conv1_1=fp32", "fp32,fc1=int8", "fp32,fc1=fp16", "fp32,fc1=bf16",
+                                 "fixed,conv1_1=fp32", "fp32,activations=fp16", "fp32,activations=u8"}) {
+            plans.push_back(PrecisionPlan::parse(plan));
+        }
+    }
+
+    // Latency of the naive fp32 path is seconds per run, keep the sweep short unless asked otherwise
+    BenchmarkConfig bench = options.bench;
+    if (!options.itersGiven) {
+        bench.iterations = 5;
+        bench.warmup = 1;
+    }
+    bench.curveWindow = 1;
+
+    std::vector<std::unique_ptr<LayerData>> inputs;
+    for (const std::string& path : inputPaths) {
+        inputs.emplace_back(new LayerData({sizeof(fp32), {128, 128, 1}, path.c_str()}));
+        inputs.back()->loadData();
+    }
+
+    // fp32 reference outputs
+    std::vector<std::unique_ptr<LayerData>> references;
+    {
+        Model model = buildAudioCNN_IRMAS(modelPath);
+        model.allocLayers();
+        for (const auto& input : inputs) {
+            const LayerData& output = model.inference(*input, options.infType);
+            references.emplace_back(new LayerData(output.getParams()));
+            references.back()->allocData();
+            std::memcpy(references.back()->raw(), output.raw(), output.getParams().byte_size());
+        }
+        model.freeLayers();
+    }
+
+    Calibration calibration = loadCalibration(options, plans);
+    std::vector<SweepResult> results;
+    for (const PrecisionPlan& plan : plans) {
+        if (!planRunsOn(plan, options.infType)) {
+            logWarn("Skipping " + plan.str() + ": fixed-point layers run naive or threaded only, not " + infTypeName(options.infType));
+            continue;
+        }
+        Model model = buildAudioCNN_IRMAS(modelPath, plan, &calibration);
+        model.allocLayers();
+
+        SweepResult result;
+        result.plan = plan.str();
+        for (std::size_t i = 0; i < inputs.size(); i++) {
+            const LayerData& output = model.inference(*inputs[i], options.infType);
+            const CompareStats stats = output.compareStats<fp32>(*references[i]);
+            result.agree += argmax(output) == argmax(*references[i]);
+            result.minCosine = std::min(result.minCosine, stats.cosine);
+            result.maxAbs = std::max(result.maxAbs, stats.maxAbs);
+        }
+
+        logInfo("Timing " + result.plan + "...");
+        result.p50Ms = runLatencyBenchmark(model, *inputs[0], options.infType, bench).histogram.percentile(50) / 1e6;
+        model.freeLayers();
+        results.push_back(result);
+    }
+
+    for (SweepResult& result : results) {
+        result.pareto = std::none_of(results.begin(), results.end(), [&](const SweepResult& other) {
+            return other.agree >= result.agree && other.p50Ms <= result.p50Ms && (other.agree > result.agree || other.p50Ms < result.p50Ms);
+        });
+    }
+
+    std::size_t width = 10;
+    for (const SweepResult& result : results) width = std::max(width, result.plan.size() + 2);
+    std::cout << "\nPrecision sweep (" << inputs.size() << " inputs, " << infTypeName(options.infType) << ", p50 of " << bench.iterations
+              << " runs), * marks the Pareto front of top-1 agreement vs latency:\n";
+    std::cout << "  " << std::left << std::setw(width) << "Plan" << std::right << std::setw(10) << "top-1" << std::setw(12) << "min cosine"
+              << std::setw(12) << "max abs" << std::setw(12) << "p50 ms" << "\n";
+    std::cout << std::fixed;
+    for (const SweepResult& result : results) {
+        std::cout << (result.pareto ? "* " : "  ") << std::left << std::setw(width) << result.plan << std::right << std::setw(10)
+                  << (std::to_string(result.agree) + "/" + std::to_string(inputs.size())) << std::setprecision(6) << std::setw(12)
+                  << result.minCosine << std::setw(12) << result.maxAbs << std::setprecision(3) << std::setw(12) << result.p50Ms << "\n";
+    }
+    std::cout.unsetf(std::ios::fixed);
+    std::cout << std::setprecision(6);
+}
+
+// Layers named with --layer (fc1 by default), checked against the model
+std::vector<std::string> toolLayers(const RunOptions& options, const Model& model) {
+    std::vector<std::string> layerNames = options.layers;
+    if (layerNames.empty()) layerNames.push_back("fc1");
+    for (const std::string& name : layerNames) {
+        bool found = false;
+        for (std::size_t i = 0; i < model.getNumLayers(); i++) found |= model.getLayer(i).getName() == name;
+        if (!found) throw std::runtime_error("No layer named `" + name + "`");
+    }
+    return layerNames;
+}
+
+// The --out weight directory of a rewriting tool (created if missing), never the directory it reads from
+std::string toolOutputDir(const RunOptions& options, const std::string& defaultDir) {
+    std::string outDir = options.outPath.empty() ? defaultDir : options.outPath;
+    if (outDir == options.modelPath) throw std::runtime_error("Rewritten weights would overwrite " + outDir);
+#ifndef ZEDBOARD
+    mkdir(outDir.c_str(), 0755);
+#endif
+    return outDir;
+}
+
+// Copy every Conv/Dense weight and bias file of the model into outDir under the same name, letting `rewrite` change
+// each layer's fp32 weights and bias in place first
+void rewriteWeights(const Model& model, const Path& outDir, const std::function<void(const Layer&, LayerData&, LayerData&)>& rewrite) {
+    for (std::size_t i = 0; i < model.getNumLayers(); i++) {
+        const Layer& layer = model.getLayer(i);
+        LayerParams weightParams = layer.getInputParams(), biasParams = layer.getInputParams();
+        if (layer.getLType() == Layer::LayerType::CONVOLUTIONAL) {
+            weightParams = static_cast<const ConvolutionalLayer&>(layer).getWeightParams();
+            biasParams = static_cast<const ConvolutionalLayer&>(layer).getBiasParams();
+        } else if (layer.getLType() == Layer::LayerType::DENSE) {
+            weightParams = static_cast<const DenseLayer&>(layer).getWeightParams();
+            biasParams = static_cast<const DenseLayer&>(layer).getBiasParams();
+        } else {
+            continue;
+        }
+
+        LayerData weights(weightParams), bias(biasParams);
+        weights.loadData();
+        bias.loadData();
+        rewrite(layer, weights, bias);
+
+        for (LayerData* data : {&weights, &bias}) {
+            const Path& path = data->getParams().filePath;
+            data->saveData(outDir / path.substr(path.find_last_of('/') + 1));
+        }
+    }
+}
+
+// Per-layer validation of a rewritten model and its top-1 agreement with the model it came from
+void compareWithOriginal(const RunOptions& options, const Path& rewrittenPath) {
+    std::vector<ValidationCase> cases = options.validationCases;
+    if (cases.empty()) cases.push_back({"data/test_input.bin", "data/feature_maps"});
+    std::vector<std::vector<LayerValidator::Result>> results =
+        validateCases([&]() { return buildAudioCNN_IRMAS(rewrittenPath); }, cases, options.infType, options.jobs);
+    for (std::size_t i = 0; i < cases.size(); i++) printValidationResults(cases[i], results[i]);
+
+    Model original = buildAudioCNN_IRMAS(options.modelPath.c_str());
+    Model rewritten = buildAudioCNN_IRMAS(rewrittenPath);
+    original.allocLayers();
+    rewritten.allocLayers();
+    std::size_t agree = 0;
+    float minCosine = 1;
+    for (const ValidationCase& validationCase : cases) {
+        LayerData input({sizeof(fp32), {128, 128, 1}, validationCase.inputPath});
+        input.loadData();
+        const LayerData& reference = original.inference(input, options.infType);
+        const LayerData& output = rewritten.inference(input, options.infType);
+        agree += argmax(output) == argmax(reference);
+        minCosine = std::min(minCosine, output.compareStats<fp32>(reference).cosine);
+    }
+    original.freeLayers();
+    rewritten.freeLayers();
+    std::cout << "\nTop-1 agreement with " << options.modelPath << ": " << agree << "/" << cases.size() << " (min output cosine "
+              << minCosine << ")\n";
+}
+
+// Zero the lowest-norm weight blocks of the chosen layers, write the whole model to a new weight directory and check
+// how far the pruned model drifts from the original. Conv/Dense layers load pruned weights block-sparse
+void runPruneTool(const RunOptions& options) {
+    logInfo("--- Running Block Pruning ---");
+
+    struct Pruned {
+        std::string name;
+        float before, after;
+        std::size_t denseBytes, sparseBytes;
+    };
+    std::vector<Pruned> pruned;
+
+    Model model = buildAudioCNN_IRMAS(options.modelPath.c_str());
+    const std::vector<std::string> layerNames = toolLayers(options, model);
+    const std::string outDir = toolOutputDir(options, "data/model_weights_pruned");
+    Path prunedPath = outDir.c_str();
+
+    rewriteWeights(model, prunedPath, [&](const Layer& layer, LayerData& weights, LayerData& bias) {
+        if (std::find(layerNames.begin(), layerNames.end(), layer.getName()) == layerNames.end()) return;
+        fp32* w = (fp32*)weights.raw();
+        const std::size_t cols = bias.getParams().flat_count();
+        const std::size_t rows = weights.getParams().flat_count() / cols;
+        Pruned result{layer.getName(), blockDensity(w, rows, cols, options.block), 0, weights.getParams().byte_size(), 0};
+        result.after = pruneBlocks(w, rows, cols, options.block, options.sparsity);
+        BlockSparseWeights sparse;
+        sparse.load(w, rows, cols, options.block);
+        result.sparseBytes = sparse.bytes();
+        pruned.push_back(result);
+    });
+
+    std::cout << "\nBlock pruning (" << options.block.str() << " blocks, " << options.sparsity * 100 << "% sparsity) into " << outDir << ":\n";
+    std::cout << "  " << std::left << std::setw(10) << "Layer" << std::right << std::setw(14) << "blocks before" << std::setw(14)
+              << "blocks after" << std::setw(14) << "dense KiB" << std::setw(14) << "sparse KiB" << "\n";
+    std::cout << std::fixed << std::setprecision(1);
+    for (const Pruned& result : pruned) {
+        std::cout << "  " << std::left << std::setw(10) << result.name << std::right << std::setw(13) << result.before * 100 << "%"
+                  << std::setw(13) << result.after * 100 << "%" << std::setw(14) << result.denseBytes / 1024.0 << std::setw(14)
+                  << result.sparseBytes / 1024.0 << "\n";
+    }
+    std::cout.unsetf(std::ios::fixed);
+    std::cout << std::setprecision(6);
+    if (options.block.cols != Config::SPARSE_BLOCK_COLS || options.block.rows != Config::SPARSE_BLOCK_ROWS) {
+        logWarn("Layers load block-sparse in " + BlockShape().str() + " blocks, pruned " + options.block.str() + " blocks may not qualify");
+    }
+
+    compareWithOriginal(options, prunedPath);
+}
+
+// Factor the chosen Dense layers into rank-k U [K][k] and V [k][M] (written next to a copy of the model as
+// <layer>_u.bin / <layer>_v.bin), report the reconstruction error and check the factored model against the original
+void runFactorTool(const RunOptions& options) {
+    logInfo("--- Running Low-Rank Factorization ---");
+
+    struct Factored {
+        std::string name;
+        std::size_t rank;
+        double energy, error;
+        std::size_t denseBytes, factorBytes;
+    };
+    std::vector<Factored> factored;
+
+    Model model = buildAudioCNN_IRMAS(options.modelPath.c_str());
+    const std::vector<std::string> layerNames = toolLayers(options, model);
+    const std::string outDir = toolOutputDir(options, "data/model_weights_rank" + std::to_string(options.rank));
+    Path factoredPath = outDir.c_str();
+
+    rewriteWeights(model, factoredPath, [&](const Layer& layer, LayerData& weights, LayerData& bias) {
+        if (std::find(layerNames.begin(), layerNames.end(), layer.getName()) == layerNames.end()) return;
+        if (layer.getLType() != Layer::LayerType::DENSE) throw std::runtime_error("Only Dense layers can be factored, not `" + layer.getName() + "`");
+
+        const fp32* w = (const fp32*)weights.raw();
+        const std::size_t cols = bias.getParams().flat_count();
+        const std::size_t rows = weights.getParams().flat_count() / cols;
+        logInfo("Factoring " + layer.getName() + " (" + std::to_string(rows) + "x" + std::to_string(cols) + ") to rank " +
+                std::to_string(options.rank) + "...");
+        LowRankFactors factors = factorLowRank(w, rows, cols, options.rank);
+
+        LayerData u({sizeof(fp32), {rows, factors.rank}}), v({sizeof(fp32), {factors.rank, cols}});
+        u.allocData();
+        v.allocData();
+        std::memcpy(u.raw(), factors.u.data(), u.getParams().byte_size());
+        std::memcpy(v.raw(), factors.v.data(), v.getParams().byte_size());
+        u.saveData(factoredPath / (layer.getName() + "_u.bin"));
+        v.saveData(factoredPath / (layer.getName() + "_v.bin"));
+
+        factored.push_back({layer.getName(), factors.rank, factors.energy(), reconstructionError(w, factors),
+                            weights.getParams().byte_size(), u.getParams().byte_size() + v.getParams().byte_size()});
+    });
+
+    std::cout << "\nLow-rank factorization into " << outDir << ":\n";
+    std::cout << "  " << std::left << std::setw(10) << "Layer" << std::right << std::setw(8) << "rank" << std::setw(10) << "energy"
+              << std::setw(14) << "rel. error" << std::setw(14) << "dense KiB" << std::setw(14) << "factor KiB" << std::setw(10) << "MACs"
+              << "\n";
+    std::cout << std::fixed;
+    for (const Factored& result : factored) {
+        std::cout << "  " << std::left << std::setw(10) << result.name << std::right << std::setw(8) << result.rank << std::setprecision(2)
+                  << std::setw(9) << result.energy * 100 << "%" << std::setprecision(6) << std::setw(14) << result.error << std::setprecision(1)
+                  << std::setw(14) << result.denseBytes / 1024.0 << std::setw(14) << result.factorBytes / 1024.0 << std::setw(9)
+                  << 100.0 * result.factorBytes / result.denseBytes << "%\n";
+    }
+    std::cout.unsetf(std::ios::fixed);
+    std::cout << std::setprecision(6);
+
+    compareWithOriginal(options, factoredPath);
+}
+
+// Find the convolution channels that stay at zero after ReLU on the sample inputs and write a model without them:
+// their filters and biases, the matching input channels of the next convolution and, through pooling and flatten,
+// the matching fc1 rows. The smaller model is then checked against the original
+void runShrinkTool(const RunOptions& options) {
+    logInfo("--- Running Dead Channel Elimination ---");
+
+    std::vector<std::string> inputPaths = options.inputs;
+    for (const ValidationCase& validationCase : options.validationCases) inputPaths.push_back(validationCase.inputPath);
+    if (inputPaths.empty()) inputPaths.push_back("data/test_input.bin");
+
+    // Largest activation of every channel over the sample set
+    Model model = buildAudioCNN_IRMAS(options.modelPath.c_str());
+    ChannelActivity activity;
+    model.allocLayers();
+    model.addObserver(&activity);
+    for (const std::string& path : inputPaths) {
+        LayerData input({sizeof(fp32), model[0].getInputParams().dims, path.c_str()});
+        input.loadData();
+        model.inference(input, options.infType);
+    }
+    model.removeObserver(&activity);
+    model.freeLayers();  // Also drops the layers, rebuilt below for their shapes
+    model = buildAudioCNN_IRMAS(options.modelPath.c_str());
+
+    const std::string outDir = toolOutputDir(options, "data/model_weights_shrunk");
+    Path shrunkPath = outDir.c_str();
+    ConvChannels channels = ConvChannels::load(options.modelPath.c_str());
+
+    std::cout << "\nDead channel elimination (" << inputPaths.size() << " inputs, threshold " << options.threshold << ") into " << outDir
+              << ":\n";
+    std::cout << "  " << std::left << std::setw(10) << "Layer" << std::right << std::setw(10) << "channels" << std::setw(8) << "dead"
+              << std::setw(14) << "KiB before" << std::setw(14) << "KiB after" << "\n";
+
+    // Live channels of the activation flowing into the current layer, as indices into the stored tensor
+    std::vector<std::size_t> live = {0};
+    std::vector<std::size_t> flattenDims;
+    for (std::size_t i = 0; i < model.getNumLayers(); i++) {
+        const Layer& layer = model.getLayer(i);
+        if (layer.getLType() == Layer::LayerType::FLATTEN) {
+            flattenDims = layer.getInputParams().dims;  // [H, W, C]
+            continue;
+        }
+        if (layer.getLType() != Layer::LayerType::CONVOLUTIONAL && layer.getLType() != Layer::LayerType::DENSE) continue;
+
+        const bool conv = layer.getLType() == Layer::LayerType::CONVOLUTIONAL;
+        const LayerParams& weightParams = conv ? static_cast<const ConvolutionalLayer&>(layer).getWeightParams()
+                                               : static_cast<const DenseLayer&>(layer).getWeightParams();
+        const LayerParams& biasParams = conv ? static_cast<const ConvolutionalLayer&>(layer).getBiasParams()
+                                             : static_cast<const DenseLayer&>(layer).getBiasParams();
+        LayerData weights(weightParams), bias(biasParams);
+        weights.loadData();
+        bias.loadData();
+        const fp32* w = (const fp32*)weights.raw();
+        const fp32* b = (const fp32*)bias.raw();
+
+        std::vector<fp32> newWeights, newBias;
+        std::vector<std::size_t> newWeightDims;
+        if (conv) {
+            // [R][S][C][M] keeping live input channels C and live output channels M
+            const std::size_t R = weightParams.dims[0], S = weightParams.dims[1], C = weightParams.dims[2], M = weightParams.dims[3];
+            const std::vector<std::size_t> liveOut = activity.liveChannels(layer.getName(), options.threshold);
+            for (std::size_t r = 0; r < R; r++) {
+                for (std::size_t s = 0; s < S; s++) {
+                    for (std::size_t c : live) {
+                        for (std::size_t m : liveOut) newWeights.push_back(w[((r * S + s) * C + c) * M + m]);
+                    }
+                }
+            }
+            for (std::size_t m : liveOut) newBias.push_back(b[m]);
+            newWeightDims = {R, S, live.size(), liveOut.size()};
+
+            channels.counts[layer.getName()] = liveOut.size();
+            std::cout << "  " << std::left << std::setw(10) << layer.getName() << std::right << std::setw(10) << M << std::setw(8)
+                      << M - liveOut.size();
+            live = liveOut;
+        } else {
+            // [K][M], rows of the flattened [H][W][C] input keeping live channels on the first Dense layer after flatten
+            const std::size_t K = weightParams.dims[0], M = weightParams.dims[1];
+            std::vector<std::size_t> rows;
+            if (!flattenDims.empty()) {
+                const std::size_t C = flattenDims[2];
+                for (std::size_t hw = 0; hw < flattenDims[0] * flattenDims[1]; hw++) {
+                    for (std::size_t c : live) rows.push_back(hw * C + c);
+                }
+                flattenDims.clear();
+            } else {
+                for (std::size_t k = 0; k < K; k++) rows.push_back(k);
+            }
+            for (std::size_t k : rows) newWeights.insert(newWeights.end(), w + k * M, w + (k + 1) * M);
+            newBias.assign(b, b + M);
+            newWeightDims = {rows.size(), M};
+            std::cout << "  " << std::left << std::setw(10) << layer.getName() << std::right << std::setw(10) << "" << std::setw(8) << "";
+        }
+        std::cout << std::fixed << std::setprecision(1) << std::setw(14) << weightParams.byte_size() / 1024.0 << std::setw(14)
+                  << newWeights.size() * sizeof(fp32) / 1024.0 << "\n";
+        std::cout.unsetf(std::ios::fixed);
+        std::cout << std::setprecision(6);
+
+        // Same file names in the new directory
+        LayerData shrunkWeights({sizeof(fp32), newWeightDims}), shrunkBias({sizeof(fp32), {newBias.size()}});
+        shrunkWeights.allocData();
+        shrunkBias.allocData();
+        std::memcpy(shrunkWeights.raw(), newWeights.data(), newWeights.size() * sizeof(fp32));
+        std::memcpy(shrunkBias.raw(), newBias.data(), newBias.size() * sizeof(fp32));
+        shrunkWeights.saveData(shrunkPath / weightParams.filePath.substr(weightParams.filePath.find_last_of('/') + 1));
+        shrunkBias.saveData(shrunkPath / biasParams.filePath.substr(biasParams.filePath.find_last_of('/') + 1));
+    }
+    channels.save(shrunkPath);
+
+    compareWithOriginal(options, shrunkPath);
+}
+
+#ifndef ZEDBOARD
+// Server running in this process, stopped by SIGINT/SIGTERM
+std::atomic<InferenceServer*> activeServer{nullptr};
+std::atomic<RingServer*> activeRingServer{nullptr};
+
+void stopActiveServer(int) {
+    InferenceServer* server = activeServer.load();
+    if (server) server->stop();
+    RingServer* ringServer = activeRingServer.load();
+    if (ringServer) ringServer->stop();
+}
+
+// Load the model once and serve batched inference on a Unix domain socket until interrupted
+void runServer(const RunOptions& options) {
+    logInfo("--- Running Inference Server ---");
+
+    PrecisionPlan plan = options.precisions.empty() ? PrecisionPlan() : options.precisions[0];
+    requirePlanRunsOn(plan, options.server.infType);
+    Calibration calibration = loadCalibration(options, {plan});
+    Model model = buildAudioCNN_IRMAS(options.modelPath.c_str(), plan, &calibration);
+    model.allocLayers();
+
+    InferenceServer server(model, options.server);
+    activeServer = &server;
+    std::signal(SIGINT, stopActiveServer);
+    std::signal(SIGTERM, stopActiveServer);
+    server.run();
+    activeServer = nullptr;
+
+    std::cout << "\nServer statistics:\n" << server.statsReport();
+    model.freeLayers();
+}
+
+// Time each conv dataflow per layer on the bundled input (fp32)
+void runDataflowBenchmark(const RunOptions& options) {
+    logInfo("--- Running Dataflow Benchmark ---");
+
+    Path basePath("data");
+    LayerData melSpec({sizeof(fp32), {128, 128, 1}, basePath / "test_input.bin"});
+    melSpec.loadData();
+
+    Model model = buildAudioCNN_IRMAS(options.modelPath.c_str());
+    model.allocLayers();
+    for (std::size_t i = 0; i < model.getNumLayers(); i++) {
+        if (model[i].getLType() != Layer::LayerType::CONVOLUTIONAL) continue;
+        const ConvolutionalLayer& conv = static_cast<const ConvolutionalLayer&>(model[i]);
+        logInfo(conv.getName() + ": " + dataflowName(conv.getRequestedDataflow()));
+    }
+    runDataflowBenchmark(model, melSpec, options.itersGiven ? options.bench.iterations : 3);
+    model.freeLayers();
+}
+
+// Time the compile-time specialized model against the dynamic one on the bundled input (fp32)
+void runStaticModelBenchmark(const RunOptions& options) {
+    logInfo("--- Running Static Model Benchmark ---");
+
+    Path basePath("data");
+    LayerData melSpec({sizeof(fp32), {128, 128, 1}, basePath / "test_input.bin"});
+    melSpec.loadData();
+
+    Model model = buildAudioCNN_IRMAS(options.modelPath.c_str());
+    model.allocLayers();
+    StaticAudioCNN staticModel;
+    staticModel.load(options.modelPath.c_str());
+
+    std::vector<Layer::InfType> infTypes = options.benchInfTypes;
+    if (infTypes.empty()) infTypes.push_back(options.infType);
+    runStaticModelBenchmark(model, staticModel, melSpec, infTypes, options.itersGiven ? options.bench.iterations : 10);
+    staticModel.free();
+    model.freeLayers();
+}
+
+// Run the bundled input with Dense weights resident and streamed (--weight-memory, 4000000 bytes by default) in every
+// instruction set the CPU supports, the streamed outputs must be bit-identical to the resident ones (fp32)
+bool runStreamCheck(const RunOptions& options) {
+    logInfo("--- Running Streamed Weight Check ---");
+
+    Path basePath("data");
+    LayerData melSpec({sizeof(fp32), {128, 128, 1}, basePath / "test_input.bin"});
+    melSpec.loadData();
+
+    const std::size_t limit = getWeightMemoryLimit() ? getWeightMemoryLimit() : 4000000;
+    setWeightMemoryLimit(0);
+    Model resident = buildAudioCNN_IRMAS(options.modelPath.c_str());
+    resident.allocLayers();
+    setWeightMemoryLimit(limit);
+    Model streamed = buildAudioCNN_IRMAS(options.modelPath.c_str());
+    streamed.allocLayers();
+
+    const Isa active = getIsa();
+    bool passed = true, anyStreamed = false;
+    std::cout << "\n" << std::left << std::setw(10) << "isa" << std::setw(10) << "layer" << std::right << std::setw(14) << "max abs"
+              << std::setw(10) << "result" << "\n";
+    for (Isa isa : {Isa::BASELINE, Isa::SSE42, Isa::AVX2, Isa::AVX512}) {
+        if (!isaSupported(isa)) continue;
+        setIsa(isa);
+        resident.inference(melSpec, options.infType);
+        streamed.inference(melSpec, options.infType);
+        for (std::size_t i = 0; i < streamed.getNumLayers(); i++) {
+            if (streamed[i].getLType() != Layer::LayerType::DENSE || !static_cast<const DenseLayer&>(streamed[i]).isStreamed()) continue;
+            anyStreamed = true;
+            const LayerData& expected = resident[i].getOutputData();
+            const LayerData& actual = streamed[i].getOutputData();
+            const bool same = std::memcmp(expected.raw(), actual.raw(), expected.getParams().byte_size()) == 0;
+            fp32 maxAbs = 0;
+            for (std::size_t j = 0; j < expected.getParams().flat_count(); j++) {
+                maxAbs = std::max(maxAbs, std::fabs(expected.get<fp32>(j) - actual.get<fp32>(j)));
+            }
+            std::cout << std::left << std::setw(10) << isaName(isa) << std::setw(10) << streamed[i].getName() << std::right << std::setw(14)
+                      << maxAbs << std::setw(10) << (same ? "PASS" : "FAIL") << "\n";
+            passed &= same;
+        }
+    }
+    setIsa(active);
+    setWeightMemoryLimit(0);
+
+    streamed.freeLayers();
+    resident.freeLayers();
+    if (!anyStreamed) {
+        logWarn("No Dense layer exceeds " + std::to_string(limit) + " bytes, nothing was streamed");
+        return false;
+    }
+    return passed;
+}
+
+// Load the model once and serve requests written straight into a POSIX shared-memory ring until interrupted
+void runRingServer(const RunOptions& options) {
+    logInfo("--- Running Shared Ring Server ---");
+
+    PrecisionPlan plan = options.precisions.empty() ? PrecisionPlan() : options.precisions[0];
+    requirePlanRunsOn(plan, options.server.infType);
+    Calibration calibration = loadCalibration(options, {plan});
+    Model model = buildAudioCNN_IRMAS(options.modelPath.c_str(), plan, &calibration);
+    model.allocLayers();
+
+    std::unique_ptr<SharedRing> ring = SharedRing::create(options.shmName, options.shmSlots, model[0].getInputParams().flat_count(),
+                                                          model.getOutputLayer().getOutputParams().flat_count());
+    RingServer server(model, *ring, options.server.maxBatch, options.server.infType);
+    activeRingServer = &server;
+    std::signal(SIGINT, stopActiveServer);
+    std::signal(SIGTERM, stopActiveServer);
+    server.run();
+    activeRingServer = nullptr;
+
+    std::cout << "\nShared ring statistics:\n" << server.statsReport();
+    model.freeLayers();
+}
+#endif
+
 } // namespace ML
 
 #ifdef ZEDBOARD
@@ -343,7 +1120,181 @@ int main() {
     FileServer::start_file_transfer_server();
 }
 #else
-int main() {
-    ML::runTests();
+static const char* USAGE =
+    "Usage: ml [test] [--inf naive|threaded|tiled|simd|accel] [--precision PLAN] [--trace trace.json] [--perf] [--tile-budget BYTES]\n"
+    "       ml bench [--inf naive|threaded|tiled|simd|accel|all] [--precision PLAN|all]... [--iters N] [--warmup N] [--cold]\n"
+    "       ml validate [--inf naive|threaded|tiled|simd|accel] [--precision PLAN|all]... [--case input.bin feature_map_dir]... [--jobs N]\n"
+    "       ml calibrate [--case input.bin feature_map_dir]... [--calibration out.txt]\n"
+    "       ml sweep [--inf naive|threaded|tiled|simd|accel] [--precision PLAN]... [--input input.bin]... [--iters N]\n"
+    "       ml prune [--layer NAME]... [--sparsity 0.8] [--block 4x16] [--out dir] [--case input.bin feature_map_dir]...\n"
+    "       ml factor [--layer NAME]... [--rank 64] [--out dir] [--case input.bin feature_map_dir]...\n"
+    "       ml shrink [--threshold 0] [--input input.bin]... [--case input.bin feature_map_dir]... [--out dir]\n"
+    "       ml serve [--socket /tmp/ml.sock] [--max-batch 8] [--max-wait-ms 2] [--inf threaded] [--precision PLAN]\n"
+    "       ml loadgen [--socket /tmp/ml.sock] [--clients 4] [--requests 50] [--input input.bin]\n"
+    "       ml packbench [--accel lanes=N] [--iters N]\n"
+    "       ml dataflow [--dataflow PLAN] [--iters N]\n"
+    "       ml static [--inf naive|threaded|tiled|simd|all] [--iters N]\n"
+    "       ml streamcheck [--weight-memory BYTES]\n"
+    "       ml shm-serve [--shm /ml_ring] [--slots 16] [--max-batch 8] [--inf threaded] [--precision PLAN]\n"
+    "       ml shm-loadgen [--shm /ml_ring] [--clients 4] [--requests 50] [--input input.bin]\n"
+    "Every command also takes --model dir to read the weights from somewhere other than data/model_weights, and\n"
+    "--weight-memory BYTES to stream fp32 Dense weights larger than that from their file through two BYTES/2 buffers\n"
+    "--inf accel runs int8 Conv/Dense layers on the MAC accelerator emulator, configured with --accel CONFIG, e.g.\n"
+    "bus=8,fifo=16,lanes=4,wbuf=65536,mac=staged|pipelined,stages=3,result=1,mhz=100\n"
+    "--inf tiled (fp32) and --inf accel (int8) run Conv/Dense layers through a tile plan fitting --tile-budget bytes of\n"
+    "scratchpad (default 262144), `ml test` reports each layer's plan with its predicted and measured traffic\n"
+    "Conv layers pick their fp32 loop order per inference with a cache model fed the input density unless --dataflow\n"
+    "gives it, e.g.\n"
+    "auto,conv1_1=input,conv3_2=weight (auto|output|weight|input); `ml dataflow` times every order per layer\n"
+    "`ml static` times the fp32 model against StaticAudioCNN, the same layers with every shape a template parameter\n"
+    "PLAN is a precision (fp32|fp16|bf16|fixed|int8) optionally followed by per-layer overrides, e.g. int8,conv1_1=fp32\n"
+    "and activations=fp16|u8 to store the fp32 activations between layers in a smaller format, layout=nchw8c|nchw16c\n"
+    "to run fp32 Conv/MaxPool layers channel-blocked (reordered back to nhwc only where a blocked run ends)\n"
+    "Fixed-point layers have naive and threaded kernels only, plans using them are rejected with --inf tiled|simd\n"
+    "--head softmax|argmax fuses the final fp32 Dense and Softmax into one classifier head ranking the top-5 in\n"
+    "registers, argmax skips the exp and leaves the logits as the output (validated against fc2 instead of softmax)\n"
+    "Int8 runs read their activation ranges from --calibration file.txt, or calibrate on the bundled input with a\n"
+    "warning, since that is the input they then evaluate\n"
+    "Kernels run in the widest instruction set the CPU supports (baseline|sse4.2|avx2|avx512, chosen with cpuid at\n"
+    "startup); --isa NAME forces a lower one\n";
+
+int main(int argc, char** argv) {
+    ML::RunOptions options;
+    try {
+        int i = 1;
+        if (i < argc && argv[i][0] != '-') options.command = argv[i++];
+
+        for (; i < argc; i++) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--trace" && hasValue) {
+                options.tracePath = argv[++i];
+            } else if (arg == "--perf") {
+                options.perfCounters = true;
+            } else if (arg == "--inf" && hasValue) {
+                std::string name = argv[++i];
+                if (name == "all") {
+                    options.benchInfTypes = {ML::Layer::InfType::NAIVE, ML::Layer::InfType::THREADED, ML::Layer::InfType::TILED,
+                                             ML::Layer::InfType::SIMD};
+                } else {
+                    options.infType = options.server.infType = ML::parseInfType(name);
+                }
+            } else if (arg == "--precision" && hasValue) {
+                std::string name = argv[++i];
+                if (name == "all") {
+                    for (ML::Layer::Precision precision : {ML::Layer::Precision::FP32, ML::Layer::Precision::FP16, ML::Layer::Precision::BF16,
+                                                           ML::Layer::Precision::FIXED, ML::Layer::Precision::INT8}) {
+                        options.precisions.push_back(precision);
+                    }
+                } else {
+                    options.precisions.push_back(ML::PrecisionPlan::parse(name));
+                }
+            } else if (arg == "--accel" && hasValue) {
+                ML::MacAccelerator::shared().configure(ML::AcceleratorConfig::parse(argv[++i]));
+            } else if (arg == "--dataflow" && hasValue) {
+                ML::setDataflowPlan(ML::DataflowPlan::parse(argv[++i]));
+            } else if (arg == "--isa" && hasValue) {
+                ML::setIsa(ML::parseIsa(argv[++i]));
+            } else if (arg == "--head" && hasValue) {
+                ML::setHeadMode(ML::parseHeadMode(argv[++i]));
+            } else if (arg == "--weight-memory" && hasValue) {
+                ML::setWeightMemoryLimit(std::stoul(argv[++i]));
+            } else if (arg == "--tile-budget" && hasValue) {
+                ML::setTileBudget(std::stoul(argv[++i]));
+            } else if (arg == "--calibration" && hasValue) {
+                options.calibrationPath = argv[++i];
+            } else if (arg == "--iters" && hasValue) {
+                options.bench.iterations = std::stoul(argv[++i]);
+                options.itersGiven = true;
+            } else if (arg == "--warmup" && hasValue) {
+                options.bench.warmup = std::stoul(argv[++i]);
+            } else if (arg == "--cold") {
+                options.bench.cold = true;
+            } else if (arg == "--case" && i + 2 < argc) {
+                std::string inputPath = argv[++i];
+                std::string featureMapDir = argv[++i];
+                options.validationCases.push_back({inputPath.c_str(), featureMapDir.c_str()});
+            } else if (arg == "--jobs" && hasValue) {
+                options.jobs = std::stoul(argv[++i]);
+            } else if (arg == "--input" && hasValue) {
+                options.inputs.push_back(argv[++i]);
+            } else if (arg == "--model" && hasValue) {
+                options.modelPath = argv[++i];
+            } else if (arg == "--layer" && hasValue) {
+                options.layers.push_back(argv[++i]);
+            } else if (arg == "--socket" && hasValue) {
+                options.server.socketPath = options.loadGen.socketPath = argv[++i];
+            } else if (arg == "--shm" && hasValue) {
+                options.shmName = argv[++i];
+            } else if (arg == "--slots" && hasValue) {
+                options.shmSlots = std::stoul(argv[++i]);
+            } else if (arg == "--max-batch" && hasValue) {
+                options.server.maxBatch = std::stoul(argv[++i]);
+            } else if (arg == "--max-wait-ms" && hasValue) {
+                options.server.maxWaitMs = std::stod(argv[++i]);
+            } else if (arg == "--clients" && hasValue) {
+                options.loadGen.clients = std::stoul(argv[++i]);
+            } else if (arg == "--requests" && hasValue) {
+                options.loadGen.requests = std::stoul(argv[++i]);
+            } else if (arg == "--threshold" && hasValue) {
+                options.threshold = std::stof(argv[++i]);
+            } else if (arg == "--rank" && hasValue) {
+                options.rank = std::stoul(argv[++i]);
+            } else if (arg == "--sparsity" && hasValue) {
+                options.sparsity = std::stof(argv[++i]);
+            } else if (arg == "--block" && hasValue) {
+                options.block = ML::BlockShape::parse(argv[++i]);
+            } else if (arg == "--out" && hasValue) {
+                options.outPath = argv[++i];
+            } else {
+                std::cerr << USAGE;
+                return 1;
+            }
+        }
+
+        ML::logInfo(std::string("Kernels: ") + ML::isaName(ML::getIsa()) + " (CPU supports up to " + ML::isaName(ML::detectIsa()) + ")");
+
+        if (options.command == "test") {
+            ML::runTests(options);
+        } else if (options.command == "bench") {
+            ML::runBenchmarks(options);
+        } else if (options.command == "validate") {
+            return ML::runValidation(options) ? 0 : 1;
+        } else if (options.command == "calibrate") {
+            ML::runCalibrationTool(options);
+        } else if (options.command == "sweep") {
+            ML::runPrecisionSweep(options);
+        } else if (options.command == "prune") {
+            ML::runPruneTool(options);
+        } else if (options.command == "factor") {
+            ML::runFactorTool(options);
+        } else if (options.command == "shrink") {
+            ML::runShrinkTool(options);
+        } else if (options.command == "serve") {
+            ML::runServer(options);
+        } else if (options.command == "loadgen") {
+            if (!options.inputs.empty()) options.loadGen.inputPath = options.inputs[0];
+            ML::runLoadGenerator(options.loadGen);
+        } else if (options.command == "dataflow") {
+            ML::runDataflowBenchmark(options);
+        } else if (options.command == "static") {
+            ML::runStaticModelBenchmark(options);
+        } else if (options.command == "streamcheck") {
+            return ML::runStreamCheck(options) ? 0 : 1;
+        } else if (options.command == "packbench") {
+            ML::runPackingBenchmark(ML::MacAccelerator::shared().getConfig().lanes, options.bench.iterations);
+        } else if (options.command == "shm-serve") {
+            ML::runRingServer(options);
+        } else if (options.command == "shm-loadgen") {
+            ML::runRingLoadGenerator(options.shmName, options.loadGen.clients, options.loadGen.requests,
+                                     options.inputs.empty() ? options.loadGen.inputPath : options.inputs[0]);
+        } else {
+            std::cerr << USAGE;
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "\n\n----- EXCEPTION THROWN -----\n" << e.what() << '\n';
+        return 1;
+    }
 }
 #endif
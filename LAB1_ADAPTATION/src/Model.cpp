@@ -1,6 +1,11 @@
 #include "Model.h"
 
 #include <cassert>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include "Calibration.h"
 
 namespace ML {
 
@@ -17,6 +22,43 @@ const LayerData& Model::inference(const LayerData& inData, const Layer::InfType
     return layers.back()->getOutputData();
 }
 
+std::vector<const LayerData*> Model::inferenceBatch(const std::vector<const LayerData*>& inData, const Layer::InfType infType) const {
+    assert(layers.size() > 0 && "There must be at least 1 layer to perform inference");
+    reserveBatch(inData.size());
+
+    for (std::size_t i = 0; i < layers.size(); i++) {
+        for (std::size_t b = 0; b < inData.size(); b++) {
+            BatchSlot& slot = batchSlots[b];
+            const LayerData& output = inferenceLayer(i == 0 ? *inData[b] : *slot.views[(i - 1) % 2], i, infType);
+            LayerData& activation = *slot.views[i % 2];
+            activation.setParams(output.getParams());
+            activation.setView(slot.buffers[i % 2].get());
+            std::memcpy(activation.raw(), output.raw(), output.getParams().byte_size());
+        }
+    }
+
+    std::vector<const LayerData*> outputs(inData.size());
+    for (std::size_t b = 0; b < inData.size(); b++) outputs[b] = batchSlots[b].views[(layers.size() - 1) % 2].get();
+    return outputs;
+}
+
+void Model::reserveBatch(std::size_t batchSize) const {
+    std::size_t bytes = 0;
+    for (const auto& layer : layers) bytes = std::max(bytes, layer->getOutputData().getParams().byte_size());
+    if (bytes != batchBufferBytes) {
+        batchSlots.clear();
+        batchBufferBytes = bytes;
+    }
+    while (batchSlots.size() < batchSize) {
+        BatchSlot slot;
+        for (int i = 0; i < 2; i++) {
+            slot.buffers[i].reset(new ui64[(bytes + 7) / 8]);
+            slot.views[i].reset(new LayerData(layers.back()->getOutputData().getParams()));
+        }
+        batchSlots.push_back(std::move(slot));
+    }
+}
+
 // Run inference on a single layer of the model using the inData and outputting the outData
 // infType can be used to determine the inference function to call
 const LayerData& Model::inferenceLayer(const LayerData& inData, const int layerNum, const Layer::InfType infType) const {
@@ -25,24 +67,188 @@ const LayerData& Model::inferenceLayer(const LayerData& inData, const int layerN
     assert(layer.getInputParams().isCompatible(inData.getParams()) && "Input data is not compatible with layer");
     assert(layer.isOutputBufferAlloced() && "Output buffer must be allocated prior to inference");
 
-    switch (infType) {
-    case Layer::InfType::NAIVE:
-        layer.computeNaive(inData);
-        break;
-    case Layer::InfType::THREADED:
-        layer.computeThreaded(inData);
-        break;
-    case Layer::InfType::TILED:
-        layer.computeTiled(inData);
-        break;
-    case Layer::InfType::SIMD:
-        layer.computeSIMD(inData);
-        break;
-    default:
-        assert(false && "Inference Type not implemented");
+    if (!observers.empty()) {
+        for (InferenceObserver* observer : observers) observer->beginLayer(layerNum, layer, inData);
+    }
+
+    if (layer.getPrecision() == Layer::Precision::FP16 || layer.getPrecision() == Layer::Precision::BF16) {
+        layer.computeHalf(inData, infType);
+    } else if (layer.getPrecision() == Layer::Precision::FIXED) {
+        layer.computeFixed(inData, infType);
+    } else if (layer.getPrecision() == Layer::Precision::INT8) {
+        layer.computeInt8(inData, infType);
+    } else {
+        switch (infType) {
+        case Layer::InfType::NAIVE:
+        case Layer::InfType::ACCEL:  // The accelerator only takes int8 layers
+            layer.computeNaive(inData);
+            break;
+        case Layer::InfType::THREADED:
+            layer.computeThreaded(inData);
+            break;
+        case Layer::InfType::TILED:
+            layer.computeTiled(inData);
+            break;
+        case Layer::InfType::SIMD:
+            layer.computeSIMD(inData);
+            break;
+        default:
+            assert(false && "Inference Type not implemented");
+        }
+    }
+
+    if (!observers.empty()) {
+        for (auto it = observers.rbegin(); it != observers.rend(); ++it) (*it)->endLayer(layerNum, layer, layer.getOutputData());
     }
 
     return layer.getOutputData();
 }
 
+bool PrecisionPlan::uses(Layer::Precision precision) const {
+    if (defaultPrecision == precision) return true;
+    for (const auto& entry : layers) {
+        if (entry.second == precision) return true;
+    }
+    return false;
+}
+
+PrecisionPlan PrecisionPlan::parse(const std::string& text) {
+    PrecisionPlan plan;
+    std::istringstream iss(text);
+    std::string item;
+    for (bool first = true; std::getline(iss, item, ','); first = false) {
+        const std::size_t eq = item.find('=');
+        if (eq == std::string::npos) {
+            if (!first) throw std::runtime_error("Precision plan `" + text + "`: only the first entry may omit the layer name");
+            plan.defaultPrecision = Layer::parsePrecision(item);
+        } else if (item.substr(0, eq) == "activations") {
+            plan.activations = Layer::parseStorage(item.substr(eq + 1));
+        } else if (item.substr(0, eq) == "layout") {
+            plan.layout = parseLayout(item.substr(eq + 1));
+        } else {
+            plan.layers[item.substr(0, eq)] = Layer::parsePrecision(item.substr(eq + 1));
+        }
+    }
+    return plan;
+}
+
+std::string PrecisionPlan::str() const {
+    std::string text = Layer::precisionName(defaultPrecision);
+    for (const auto& entry : layers) text += "," + entry.first + "=" + Layer::precisionName(entry.second);
+    if (activations != Layer::Storage::FP32) text += std::string(",activations=") + Layer::storageName(activations);
+    if (layout != Layout::NHWC) text += std::string(",layout=") + layoutName(layout);
+    return text;
+}
+
+void Model::applyLayout(Layout layout) {
+    if (layout == Layout::NHWC) return;
+    for (std::size_t i = 0; i < layers.size(); i++) {
+        if (!layers[i]->supportsLayout(layout, layout)) continue;
+        std::size_t end = i + 1;
+        while (end < layers.size() && layers[end]->supportsLayout(layout, layout)) end++;
+
+        // Run [i, end): into the blocked layout at its start, back to NHWC after it
+        Layer& first = *layers[i];
+        if (first.supportsLayout(Layout::NHWC, layout)) {
+            first.setLayout(Layout::NHWC, layout);
+        } else {
+            insertLayer(new ConvertLayer(first.getInputParams(), layout), i++);
+            end++;
+            first.setLayout(layout, layout);
+        }
+        for (std::size_t j = i + 1; j < end; j++) layers[j]->setLayout(layout, layout);
+        insertLayer(new ConvertLayer(layers[end - 1]->getOutputParams(), Layout::NHWC), end);
+        i = end;
+    }
+}
+
+void Model::fuseClassifierHead(HeadMode mode) {
+    if (mode == HeadMode::NONE) return;
+    const std::size_t n = layers.size();
+    if (n < 2 || layers[n - 1]->getLType() != Layer::LayerType::SOFTMAX || layers[n - 2]->getLType() != Layer::LayerType::DENSE) {
+        logWarn("No Dense + Softmax tail to fuse into a classifier head");
+        return;
+    }
+    const DenseLayer& dense = static_cast<const DenseLayer&>(*layers[n - 2]);
+    const Layer& softmax = *layers[n - 1];
+    assert(!dense.isOutputBufferAlloced() && "The classifier head must be fused before allocating the layers");
+
+    // The head keeps the logits in registers: fp32 weights read resident, at most HEAD_MAX_CLASSES outputs
+    if (dense.getPrecision() != Layer::Precision::FP32 || softmax.getPrecision() != Layer::Precision::FP32 ||
+        dense.getInputStorage() != Layer::Storage::FP32 || dense.getRank() ||
+        dense.getOutputParams().flat_count() > Config::HEAD_MAX_CLASSES) {
+        logWarn(dense.getName() + " + " + softmax.getName() + " left unfused: the classifier head needs fp32 full-rank weights, " +
+                "fp32 input and at most " + std::to_string(Config::HEAD_MAX_CLASSES) + " classes");
+        return;
+    }
+
+    std::unique_ptr<Layer> head(
+        new ClassifierHeadLayer(dense.getInputParams(), softmax.getOutputParams(), dense.getWeightParams(), dense.getBiasParams(), mode));
+    head->setName(dense.getName() + "+" + headModeName(mode));  // fc2+softmax, or fc2+argmax which computes no softmax
+    layers.pop_back();
+    layers.back() = std::move(head);
+}
+
+// Set each layer's precision and insert conversions at every change of activation format
+void Model::setPrecisionPlan(const PrecisionPlan& plan, const Calibration* calibration) {
+    if (plan.uses(Layer::Precision::INT8) && !calibration) throw std::runtime_error("Int8 precision needs a calibration");
+    if (plan.activations == Layer::Storage::U8 && !calibration) throw std::runtime_error("U8 activation storage needs a calibration");
+
+    // Drop the conversions of a previous call
+    layers.erase(std::remove_if(layers.begin(), layers.end(),
+                                [](const std::unique_ptr<Layer>& layer) { return layer->getLType() == Layer::LayerType::CONVERT; }),
+                 layers.end());
+
+    std::size_t planned = 0;
+    Layer::Precision current = Layer::Precision::FP32;  // Model input
+    for (std::size_t i = 0; i < layers.size(); i++) {
+        assert(!layers[i]->isOutputBufferAlloced() && "Precision must be set before allocating the layers");
+        Layer& layer = *layers[i];
+
+        auto named = plan.layers.find(layer.getName());
+        if (named != plan.layers.end()) {
+            layer.setPrecision(named->second);  // Throws if the layer cannot run in it
+            planned++;
+        } else {
+            layer.setPrecision(layer.supportsPrecision(plan.defaultPrecision) ? plan.defaultPrecision : Layer::Precision::FP32);
+        }
+
+        const Layer::Precision format = Layer::activationFormat(layer.getPrecision());
+        if (format != current) insertLayer(new ConvertLayer(layer.getInputParams(), current, format), i++);
+        current = format;
+    }
+    if (planned != plan.layers.size()) throw std::runtime_error("Precision plan `" + plan.str() + "` names a layer that is not in the model");
+
+    // Model output
+    if (current != Layer::Precision::FP32) {
+        layers.emplace_back(new ConvertLayer(layers.back()->getOutputParams(), current, Layer::Precision::FP32));
+    }
+    // Stored activations on every edge whose producer and consumer both handle the format
+    if (plan.activations != Layer::Storage::FP32) {
+        for (std::size_t i = 0; i + 1 < layers.size(); i++) {
+            Layer& producer = *layers[i];
+            Layer& consumer = *layers[i + 1];
+            if (producer.supportsStorage(plan.activations) && consumer.supportsStorage(plan.activations)) {
+                producer.setStorage(producer.getInputStorage(), plan.activations);
+                consumer.setStorage(plan.activations, consumer.getOutputStorage());
+            }
+        }
+    }
+    applyLayout(plan.layout);
+    precisionPlan = plan;
+
+    // Quantization of every activation: Conv/Dense/Softmax outputs get their calibrated range, pooling, flattening and
+    // conversions keep the quantization of their input. Only int8 layers and u8 storage use it
+    if (!calibration || !(plan.uses(Layer::Precision::INT8) || plan.activations == Layer::Storage::U8)) return;
+    QuantParams quant = calibration->quantParams("input");
+    for (std::size_t i = 0; i < layers.size(); i++) {
+        Layer& layer = *layers[i];
+        const Layer::LayerType lType = layer.getLType();
+        const bool newRange = lType == Layer::LayerType::CONVOLUTIONAL || lType == Layer::LayerType::DENSE || lType == Layer::LayerType::SOFTMAX;
+        QuantParams outQuant = newRange ? calibration->quantParams(layer.getName()) : quant;
+        layer.setQuant(quant, outQuant);
+        quant = outQuant;
+    }
+}
+
 }  // namespace ML
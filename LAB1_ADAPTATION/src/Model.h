@@ -1,7 +1,12 @@
 #pragma once
+#include <algorithm>
+#include <map>
+#include <string>
 #include <vector>
 #include <memory>
 
+#include "layers/ClassifierHead.h"
+#include "layers/Convert.h"
 #include "layers/Convolutional.h"
 #include "layers/Dense.h"
 #include "layers/Layer.h"
@@ -9,6 +14,45 @@
 #include "layers/Softmax.h"
 
 namespace ML {
+
+class Calibration;
+
+// Hooks called by Model around every layer it runs (profilers, tracers, validators)
+// Observers are not owned by the model and must outlive any inference they are attached to
+class InferenceObserver {
+   public:
+    virtual ~InferenceObserver() {}
+
+    virtual void beginLayer(std::size_t layerNum, const Layer& layer, const LayerData& dataIn) {}
+    virtual void endLayer(std::size_t layerNum, const Layer& layer, const LayerData& dataOut) {}
+};
+
+// Precision of each layer by name, layers not named run in defaultPrecision if they support it and in fp32 otherwise
+// fp32 activations passed between two layers that can both store them are kept in the `activations` format, and
+// runs of consecutive layers that support it exchange activations in the blocked `layout`
+struct PrecisionPlan {
+    Layer::Precision defaultPrecision = Layer::Precision::FP32;
+    std::map<std::string, Layer::Precision> layers;
+    Layer::Storage activations = Layer::Storage::FP32;
+    Layout layout = Layout::NHWC;
+
+    PrecisionPlan() {}
+    PrecisionPlan(Layer::Precision precision) : defaultPrecision(precision) {}
+
+    // Whether any layer may run in `precision`
+    bool uses(Layer::Precision precision) const;
+
+    // Whether the plan changes anything from an all fp32 model
+    bool isFP32() const {
+        return defaultPrecision == Layer::Precision::FP32 && layers.empty() && activations == Layer::Storage::FP32 && layout == Layout::NHWC;
+    }
+
+    // "int8,conv1_1=fp32,fc2=fixed,activations=u8,layout=nchw8c": the default precision first, then per-layer
+    // overrides, the activation storage and layout
+    static PrecisionPlan parse(const std::string& text);
+    std::string str() const;
+};
+
 class Model {
    public:
     // Constructors
@@ -18,6 +62,17 @@ class Model {
     const LayerData& inference(const LayerData& inData, const Layer::InfType infType = Layer::InfType::NAIVE) const;
     const LayerData& inferenceLayer(const LayerData& inData, const int layerNum, const Layer::InfType infType = Layer::InfType::NAIVE) const;
 
+    // Run several inputs layer by layer, so each layer's weights are brought into cache once per batch instead of once
+    // per input. Layers own a single output buffer, so every input's activation is copied out after each layer into
+    // its slot's ping-pong pair of batch buffers. The outputs point into those buffers and stay valid until the next
+    // inferenceBatch() or reserveBatch()
+    std::vector<const LayerData*> inferenceBatch(const std::vector<const LayerData*>& inData,
+                                                 const Layer::InfType infType = Layer::InfType::NAIVE) const;
+
+    // Allocate the batch buffers of up to batchSize inputs, each pair sized for the largest layer output, so that
+    // inferenceBatch() does not allocate (it grows them for a larger batch). Call after allocLayers()
+    void reserveBatch(std::size_t batchSize) const;
+
     // Internal memory management
     // Allocate the internal output buffers for each layer in the model
     inline void allocLayers();
@@ -28,11 +83,37 @@ class Model {
     // Getter Functions
     inline const std::size_t getNumLayers() const { return layers.size(); }
 
+    // Bytes of all layer outputs, i.e. the activation memory one inference writes
+    std::size_t getActivationBytes() const {
+        std::size_t bytes = 0;
+        for (const auto& layer : layers) bytes += layer->getOutputParams().byte_size();
+        return bytes;
+    }
+
     // Add a layer to the model
-    template<typename T, typename... Args> void addLayer(Args&&... args) { layers.emplace_back(new T(std::forward<Args>(args)...)); }
+    template<typename T, typename... Args> T& addLayer(Args&&... args) {
+        T* layer = new T(std::forward<Args>(args)...);
+        layers.emplace_back(layer);
+        return *layer;
+    }
 
     // Insert a layer into the model
-    // void insertLayer(Layer* l, std::size_t idx) { layers.insert(layers.begin() + idx, l); }
+    void insertLayer(Layer* l, std::size_t idx) { layers.emplace(layers.begin() + idx, l); }
+
+    // Run each layer in the precision the plan gives it
+    // ConvertLayers are (re)inserted wherever the activation format changes, including the model input and output
+    // which stay fp32 NHWC. Int8 needs a calibration to quantize activations with. Must be called before allocLayers()
+    void setPrecisionPlan(const PrecisionPlan& plan, const Calibration* calibration = nullptr);
+    const PrecisionPlan& getPrecisionPlan() const { return precisionPlan; }
+
+    // Run every layer that supports `precision` in it and every other layer in fp32
+    void setPrecision(Layer::Precision precision, const Calibration* calibration = nullptr) {
+        setPrecisionPlan(PrecisionPlan(precision), calibration);
+    }
+
+    // Replace a final fp32 Dense + Softmax pair with one ClassifierHeadLayer computing `mode` (nothing for NONE, a
+    // warning when the tail does not qualify). Call after setPrecisionPlan() and before allocLayers()
+    void fuseClassifierHead(HeadMode mode);
 
     // Remove a layer from the model
     inline void removeLayer(const std::size_t idx) { layers.erase(layers.begin() + idx); }
@@ -57,8 +138,28 @@ class Model {
         return inferenceLayer(inData, layerNum, infType);
     }
 
+    // Attach/detach an observer notified around each layer (no observers means no overhead beyond one branch)
+    inline void addObserver(InferenceObserver* observer) { observers.push_back(observer); }
+    inline void removeObserver(InferenceObserver* observer) {
+        observers.erase(std::remove(observers.begin(), observers.end(), observer), observers.end());
+    }
+
    private:
+    // Block every maximal run of layers that supports `layout`, reordering only before and after each run (the first
+    // layer of a run reads NHWC directly when it can)
+    void applyLayout(Layout layout);
+
+    // Activations of one input of a batch, alternating between two buffers from layer to layer
+    struct BatchSlot {
+        std::unique_ptr<ui64[]> buffers[2];
+        std::unique_ptr<LayerData> views[2];  // The buffers with the params of the layer output they hold
+    };
+
     std::vector<std::unique_ptr<Layer>> layers;
+    std::vector<InferenceObserver*> observers;
+    mutable std::vector<BatchSlot> batchSlots;
+    mutable std::size_t batchBufferBytes = 0;
+    PrecisionPlan precisionPlan;
 };
 
 // Allocate the internal output buffers for each layer in the model
@@ -0,0 +1,231 @@
+#include "Packing.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#if ML_HAS_ISA_TARGETS
+#    include <tmmintrin.h>
+#endif
+
+namespace ML {
+
+// Byte b of element e sits at e * stride + b. In a group of 16 elements (stride 16-byte words) byte b of the elements
+// landing in word w comes from one 16-byte load of that byte's source, placed by a shuffle (expand); the 16 bytes b of
+// the group are collected from every word by a shuffle each (gather)
+StreamPacker::StreamPacker(std::size_t lanes) : lanes(lanes) {
+    if (lanes == 0 || lanes > MAX_LANES) throw std::runtime_error("Stream packing supports 1 to " + std::to_string(MAX_LANES) + " lanes");
+    const std::size_t s = stride();
+    expandMasks.assign(s * s * 16, 0x80);
+    expandBase.assign(s * s, 0);
+    gatherMasks.assign(s * s * 16, 0x80);
+    for (std::size_t b = 0; b < s; b++) {
+        for (std::size_t w = 0; w < s; w++) {
+            const std::size_t first = 16 * w > b ? (16 * w - b + s - 1) / s : 0;
+            expandBase[b * s + w] = first;
+            for (std::size_t t = 0; t < 16; t++) {
+                const std::size_t position = 16 * w + t;
+                if (position % s == b) expandMasks[(b * s + w) * 16 + t] = ui8(position / s - first);
+            }
+            for (std::size_t j = 0; j < 16; j++) {
+                const std::size_t position = j * s + b;
+                if (position / 16 == w) gatherMasks[(b * s + w) * 16 + j] = ui8(position % 16);
+            }
+        }
+    }
+}
+
+#if ML_HAS_ISA_TARGETS
+namespace {
+constexpr std::size_t MAX_MASKS = (StreamPacker::MAX_LANES + 1) * (StreamPacker::MAX_LANES + 1);
+
+// Copy the masks of bytes [firstByte, stride) into registers/stack, out of reach of the aliasing byte stores
+ML_TARGET_SSE42 void loadMasks(const std::vector<ui8>& masks, std::size_t firstByte, std::size_t s, __m128i* out) {
+    for (std::size_t i = firstByte * s; i < s * s; i++) out[i] = _mm_loadu_si128((const __m128i*)(masks.data() + 16 * i));
+}
+}  // namespace
+#endif
+
+void StreamPacker::pack(const ui8* activations, const i8* weights, std::size_t rowStride, std::size_t n, ui8* out) const {
+    packWeights(weights, rowStride, n, out);
+    insertActivations(activations, n, out);
+}
+
+void StreamPacker::packWeights(const i8* weights, std::size_t rowStride, std::size_t n, ui8* out) const {
+    const std::size_t s = stride();
+    std::size_t e = 0;
+#if ML_HAS_ISA_TARGETS
+    if (getIsa() >= Isa::SSE42) e = packWeightsSSSE3(weights, rowStride, n, out);
+#endif
+    for (; e < n; e++) {
+        out[e * s] = 0;
+        for (std::size_t l = 0; l < lanes; l++) out[e * s + 1 + l] = ui8(weights[l * rowStride + e]);
+    }
+}
+
+void StreamPacker::insertActivations(const ui8* activations, std::size_t n, ui8* out) const {
+    const std::size_t s = stride();
+    std::size_t e = 0;
+#if ML_HAS_ISA_TARGETS
+    if (getIsa() >= Isa::SSE42) e = insertActivationsSSSE3(activations, n, out);
+#endif
+    for (; e < n; e++) out[e * s] = activations[e];
+}
+
+void StreamPacker::unpack(const ui8* in, std::size_t n, ui8* activations, i8* weights, std::size_t rowStride) const {
+    const std::size_t s = stride();
+    std::size_t e = 0;
+#if ML_HAS_ISA_TARGETS
+    if (getIsa() >= Isa::SSE42) e = unpackSSSE3(in, n, activations, weights, rowStride);
+#endif
+    for (; e < n; e++) {
+        if (activations) activations[e] = in[e * s];
+        if (weights) {
+            for (std::size_t l = 0; l < lanes; l++) weights[l * rowStride + e] = i8(in[e * s + 1 + l]);
+        }
+    }
+}
+
+#if ML_HAS_ISA_TARGETS
+std::size_t StreamPacker::packWeightsSSSE3(const i8* weights, std::size_t rowStride, std::size_t n, ui8* out) const {
+    const std::size_t s = stride();
+    std::size_t e = 0;
+    __m128i masks[MAX_MASKS];
+    std::size_t base[MAX_MASKS];
+    loadMasks(expandMasks, 1, s, masks);
+    std::copy(expandBase.begin(), expandBase.end(), base);
+    // Groups whose loads (up to 31 bytes past the group start) stay inside the rows
+    for (; e + 32 <= n; e += 16) {
+        for (std::size_t w = 0; w < s; w++) {
+            __m128i word = _mm_setzero_si128();
+            for (std::size_t b = 1; b < s; b++) {
+                const __m128i source = _mm_loadu_si128((const __m128i*)(weights + (b - 1) * rowStride + e + base[b * s + w]));
+                word = _mm_or_si128(word, _mm_shuffle_epi8(source, masks[b * s + w]));
+            }
+            _mm_storeu_si128((__m128i*)(out + e * s + 16 * w), word);
+        }
+    }
+    return e;
+}
+
+std::size_t StreamPacker::insertActivationsSSSE3(const ui8* activations, std::size_t n, ui8* out) const {
+    const std::size_t s = stride();
+    std::size_t e = 0;
+    __m128i masks[MAX_LANES + 1], keep[MAX_LANES + 1];
+    std::size_t base[MAX_LANES + 1];
+    const __m128i zeroed = _mm_set1_epi8(char(0x80));
+    for (std::size_t w = 0; w < s; w++) {
+        masks[w] = _mm_loadu_si128((const __m128i*)(expandMasks.data() + 16 * w));
+        keep[w] = _mm_cmpeq_epi8(_mm_and_si128(masks[w], zeroed), zeroed);  // The weight bytes of the word
+        base[w] = expandBase[w];
+    }
+    for (; e + 32 <= n; e += 16) {
+        for (std::size_t w = 0; w < s; w++) {
+            const __m128i source = _mm_loadu_si128((const __m128i*)(activations + e + base[w]));
+            __m128i* word = (__m128i*)(out + e * s + 16 * w);
+            _mm_storeu_si128(word, _mm_or_si128(_mm_and_si128(_mm_loadu_si128(word), keep[w]), _mm_shuffle_epi8(source, masks[w])));
+        }
+    }
+    return e;
+}
+
+std::size_t StreamPacker::unpackSSSE3(const ui8* in, std::size_t n, ui8* activations, i8* weights, std::size_t rowStride) const {
+    const std::size_t s = stride();
+    std::size_t e = 0;
+    __m128i masks[MAX_MASKS];
+    loadMasks(gatherMasks, 0, s, masks);
+    for (; e + 16 <= n; e += 16) {
+        __m128i words[MAX_LANES + 1];
+        for (std::size_t w = 0; w < s; w++) words[w] = _mm_loadu_si128((const __m128i*)(in + e * s + 16 * w));
+        for (std::size_t b = 0; b < s; b++) {
+            ui8* destination = b == 0 ? activations : (weights ? (ui8*)weights + (b - 1) * rowStride : nullptr);
+            if (!destination) continue;
+            __m128i bytes = _mm_setzero_si128();
+            for (std::size_t w = 0; w < s; w++) bytes = _mm_or_si128(bytes, _mm_shuffle_epi8(words[w], masks[b * s + w]));
+            _mm_storeu_si128((__m128i*)(destination + e), bytes);
+        }
+    }
+    return e;
+}
+#endif
+
+void StreamPacker::packScalar(const ui8* activations, const i8* weights, std::size_t rowStride, std::size_t n, ui8* out) const {
+    const std::size_t s = stride();
+    for (std::size_t e = 0; e < n; e++) {
+        out[e * s] = activations[e];
+        for (std::size_t l = 0; l < lanes; l++) out[e * s + 1 + l] = ui8(weights[l * rowStride + e]);
+    }
+}
+
+void StreamPacker::unpackScalar(const ui8* in, std::size_t n, ui8* activations, i8* weights, std::size_t rowStride) const {
+    const std::size_t s = stride();
+    for (std::size_t e = 0; e < n; e++) {
+        if (activations) activations[e] = in[e * s];
+        if (weights) {
+            for (std::size_t l = 0; l < lanes; l++) weights[l * rowStride + e] = i8(in[e * s + 1 + l]);
+        }
+    }
+}
+
+const char* packKernelName() { return getIsa() >= Isa::SSE42 ? "ssse3 pshufb" : "scalar"; }
+
+DoubleBuffer::~DoubleBuffer() {
+    if (!helper.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    helper.join();
+}
+
+void DoubleBuffer::fillBack(const std::function<void(ui8*)>& fill) {
+    wait();
+    ui8* back = buffers[frontIndex ^ 1].data();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = [fill, back]() { fill(back); };
+    }
+    if (!helper.joinable()) {
+        helper = std::thread(&DoubleBuffer::helperLoop, this);
+    } else {
+        changed.notify_all();
+    }
+}
+
+void DoubleBuffer::swap() {
+    wait();
+    frontIndex ^= 1;
+}
+
+void DoubleBuffer::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this] { return !pending; });
+    if (error) {
+        std::exception_ptr thrown = error;
+        error = nullptr;
+        std::rethrow_exception(thrown);
+    }
+}
+
+// Runs each fill handed over by fillBack(); the destructor stops it once the last fill has finished
+void DoubleBuffer::helperLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        changed.wait(lock, [this] { return stopping || pending; });
+        if (!pending) return;
+        lock.unlock();
+        std::exception_ptr thrown;
+        try {
+            pending();
+        } catch (...) {
+            thrown = std::current_exception();
+        }
+        lock.lock();
+        pending = nullptr;
+        error = thrown;
+        changed.notify_all();
+    }
+}
+
+}  // namespace ML
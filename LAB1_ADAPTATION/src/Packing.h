@@ -0,0 +1,96 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "CpuDispatch.h"
+#include "Types.h"
+
+namespace ML {
+
+// Stream word format of the MAC accelerator: element k of a transaction takes 1 + lanes bytes, the uint8 activation
+// followed by the int8 weight of each lane, so one lane gives the 16-bit activation/weight packets
+// Packing is pshufb based (SSSE3, from the SSE42 tier on) with 16 elements per group of `stride` 16-byte words,
+// the masks for a stride being computed once; scalar otherwise and for the tails
+class StreamPacker {
+   public:
+    static constexpr std::size_t MAX_LANES = 15;  // Element fits one 16-byte shuffle
+
+    explicit StreamPacker(std::size_t lanes);
+
+    inline std::size_t getLanes() const { return lanes; }
+    inline std::size_t stride() const { return lanes + 1; }
+
+    // Interleave n activations with `lanes` weight rows (row l at weights + l * rowStride) into n * stride() bytes
+    void pack(const ui8* activations, const i8* weights, std::size_t rowStride, std::size_t n, ui8* out) const;
+
+    // The weight part of pack() with zero activation bytes, computed once at load
+    void packWeights(const i8* weights, std::size_t rowStride, std::size_t n, ui8* out) const;
+
+    // Fill the activation bytes of a packWeights() image, completing the stream without touching the weights
+    void insertActivations(const ui8* activations, std::size_t n, ui8* out) const;
+
+    // Split n packed elements back into activations and weight rows (either may be null to skip it)
+    void unpack(const ui8* in, std::size_t n, ui8* activations, i8* weights, std::size_t rowStride) const;
+
+    // Element-by-element reference of pack()/unpack()
+    void packScalar(const ui8* activations, const i8* weights, std::size_t rowStride, std::size_t n, ui8* out) const;
+    void unpackScalar(const ui8* in, std::size_t n, ui8* activations, i8* weights, std::size_t rowStride) const;
+
+   private:
+    // The pshufb groups of packWeights/insertActivations/unpack, each returning the first element left to the scalar tail
+    ML_TARGET_SSE42 std::size_t packWeightsSSSE3(const i8* weights, std::size_t rowStride, std::size_t n, ui8* out) const;
+    ML_TARGET_SSE42 std::size_t insertActivationsSSSE3(const ui8* activations, std::size_t n, ui8* out) const;
+    ML_TARGET_SSE42 std::size_t unpackSSSE3(const ui8* in, std::size_t n, ui8* activations, i8* weights, std::size_t rowStride) const;
+
+    std::size_t lanes;
+    // pshufb indices (0x80 zeroes the byte), 16 per [byte within element][word of a 16-element group]
+    std::vector<ui8> expandMasks;         // Place byte b of the elements in word w, loaded 16 at a time from expandBase
+    std::vector<std::size_t> expandBase;  // First element with byte b in word w
+    std::vector<ui8> gatherMasks;         // Collect byte b of the 16 elements from word w
+};
+
+// Name of the packing kernel of the active instruction set
+const char* packKernelName();
+
+// Two staging buffers of a stream: while the accelerator drains front(), a helper thread packs the next transaction
+// into the back buffer. swap() waits for that fill and exchanges the buffers
+// The helper thread is started by the first fill and reused by every later one until the buffer is destroyed
+class DoubleBuffer {
+   public:
+    explicit DoubleBuffer(std::size_t bytes) : buffers{std::vector<ui8>(bytes), std::vector<ui8>(bytes)} {}
+    ~DoubleBuffer();
+
+    DoubleBuffer(const DoubleBuffer&) = delete;
+    DoubleBuffer& operator=(const DoubleBuffer&) = delete;
+
+    inline ui8* front() { return buffers[frontIndex].data(); }
+    inline std::size_t size() const { return buffers[0].size(); }
+
+    // Start fill(back buffer) on the helper thread, at most one fill is in flight
+    void fillBack(const std::function<void(ui8*)>& fill);
+
+    // Wait for the fill (rethrowing what it threw) and exchange the buffers
+    void swap();
+
+   private:
+    void wait();
+    void helperLoop();
+
+    std::vector<ui8> buffers[2];
+    std::size_t frontIndex = 0;
+
+    std::thread helper;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::function<void()> pending;  // Fill handed to the helper, empty once it has run
+    std::exception_ptr error;
+    bool stopping = false;
+};
+
+}  // namespace ML
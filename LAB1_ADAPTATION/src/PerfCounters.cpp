@@ -0,0 +1,289 @@
+#include "PerfCounters.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#if defined(__linux__) && !defined(ZEDBOARD)
+#    include <linux/perf_event.h>
+#    include <sys/syscall.h>
+#    include <unistd.h>
+#    define HAVE_PERF_EVENT
+#endif
+
+#include "Config.h"
+#include "ThreadPool.h"
+
+namespace ML {
+
+namespace {
+#ifdef HAVE_PERF_EVENT
+// perf_event_attr type/config for each Counter
+void counterConfig(PerfCounters::Counter counter, perf_event_attr& attr) {
+    __u32& type = attr.type;
+    __u64& config = attr.config;
+    const __u64 cacheMissRead = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    switch (counter) {
+    case PerfCounters::CYCLES:
+        type = PERF_TYPE_HARDWARE;
+        config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+    case PerfCounters::INSTRUCTIONS:
+        type = PERF_TYPE_HARDWARE;
+        config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case PerfCounters::L1D_MISSES:
+        type = PERF_TYPE_HW_CACHE;
+        config = PERF_COUNT_HW_CACHE_L1D | cacheMissRead;
+        break;
+    case PerfCounters::LLC_MISSES:
+        type = PERF_TYPE_HARDWARE;
+        config = PERF_COUNT_HW_CACHE_MISSES;
+        break;
+    case PerfCounters::BRANCH_MISSES:
+        type = PERF_TYPE_HARDWARE;
+        config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+    default:
+        type = PERF_TYPE_SOFTWARE;
+        config = PERF_COUNT_SW_PAGE_FAULTS;
+        break;
+    }
+}
+#endif
+
+// Fixed width cell, or n/a when the value could not be measured
+std::string cell(bool valid, double value, int precision) {
+    if (!valid) return "n/a";
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(precision) << value;
+    return oss.str();
+}
+}  // namespace
+
+PerfCounters::PerfCounters() {
+    // The calling thread (tid 0) and the pool workers that run THREADED tiles
+    std::vector<long> tids(1, 0);
+    const std::vector<long>& workerIds = ThreadPool::shared().workerThreadIds();
+    tids.insert(tids.end(), workerIds.begin(), workerIds.end());
+    threads = tids.size();
+
+    std::string unavailable;
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        beginValues[i] = 0;
+#ifdef HAVE_PERF_EVENT
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        counterConfig(Counter(i), attr);
+        attr.exclude_kernel = 1;  // Allowed at perf_event_paranoid <= 2
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        for (long tid : tids) {
+            const int fd = syscall(SYS_perf_event_open, &attr, tid, -1, -1, 0);
+            if (fd < 0) {
+                // Partial sums would undercount, the counter is unavailable unless every thread has it
+                unavailable += std::string(unavailable.empty() ? "" : ", ") + counterName(Counter(i)) + " (" + std::strerror(errno) + ")";
+                for (int open : fds[i]) close(open);
+                fds[i].clear();
+                break;
+            }
+            fds[i].push_back(fd);
+        }
+#else
+        unavailable += std::string(unavailable.empty() ? "" : ", ") + counterName(Counter(i));
+#endif
+    }
+
+    if (!unavailable.empty()) logWarn("Performance counters unavailable, reporting n/a: " + unavailable);
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef HAVE_PERF_EVENT
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        for (int fd : fds[i]) close(fd);
+    }
+#endif
+}
+
+const char* PerfCounters::counterName(Counter counter) {
+    switch (counter) {
+    case CYCLES:
+        return "cycles";
+    case INSTRUCTIONS:
+        return "instructions";
+    case L1D_MISSES:
+        return "L1D-read-misses";
+    case LLC_MISSES:
+        return "LLC-misses";
+    case BRANCH_MISSES:
+        return "branch-misses";
+    case PAGE_FAULTS:
+        return "page-faults";
+    default:
+        return "unknown";
+    }
+}
+
+bool PerfCounters::anyHardwareAvailable() const {
+    for (int i = 0; i < PAGE_FAULTS; i++) {
+        if (isAvailable(Counter(i))) return true;
+    }
+    return false;
+}
+
+ui64 PerfCounters::readCounter(Counter counter) const {
+    ui64 total = 0;
+#ifdef HAVE_PERF_EVENT
+    for (int fd : fds[counter]) {
+        ui64 buf[3] = {0, 0, 0};  // value, time enabled, time running
+        if (read(fd, buf, sizeof(buf)) != sizeof(buf) || buf[2] == 0) continue;
+        if (buf[2] < buf[1]) {
+            total += ui64(double(buf[0]) * double(buf[1]) / double(buf[2]));  // Multiplexed
+        } else {
+            total += buf[0];
+        }
+    }
+#endif
+    return total;
+}
+
+void PerfCounters::beginLayer(std::size_t, const Layer&, const LayerData&) {
+    for (int i = 0; i < NUM_COUNTERS; i++) beginValues[i] = readCounter(Counter(i));
+    beginTime = std::chrono::steady_clock::now();
+}
+
+void PerfCounters::endLayer(std::size_t layerNum, const Layer& layer, const LayerData&) {
+    std::chrono::steady_clock::time_point endTime = std::chrono::steady_clock::now();
+    ui64 endValues[NUM_COUNTERS];
+    for (int i = 0; i < NUM_COUNTERS; i++) endValues[i] = readCounter(Counter(i));
+
+    if (stats.size() <= layerNum) stats.resize(layerNum + 1);
+    LayerStats& layerStats = stats[layerNum];
+    layerStats.name = layer.getName();
+    layerStats.type = Layer::typeName(layer.getLType());
+    layerStats.calls++;
+    layerStats.elapsedNs += std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - beginTime).count();
+    layerStats.macs += layer.getMACs();
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        if (endValues[i] > beginValues[i]) layerStats.values[i] += endValues[i] - beginValues[i];
+    }
+}
+
+void PerfCounters::reset() { stats.clear(); }
+
+// Print IPC, misses-per-MAC and estimated DRAM bandwidth per layer
+void PerfCounters::report() const {
+    const bool haveCycles = isAvailable(CYCLES) && isAvailable(INSTRUCTIONS);
+    const bool haveL1 = isAvailable(L1D_MISSES);
+    const bool haveLLC = isAvailable(LLC_MISSES);
+    const bool haveBranch = isAvailable(BRANCH_MISSES);
+    const bool haveFaults = isAvailable(PAGE_FAULTS);
+
+    std::cout << "\nPer-layer performance counters (" << (anyHardwareAvailable() ? "hardware" : "hardware counters unavailable")
+              << ", summed over the calling thread and " << threads - 1 << " pool workers):\n";
+    std::cout << std::left << std::setw(10) << "Layer" << std::setw(15) << "Type" << std::right << std::setw(6) << "Calls"
+              << std::setw(11) << "Time(ms)" << std::setw(10) << "MMACs" << std::setw(7) << "IPC" << std::setw(13) << "L1D miss/MAC"
+              << std::setw(13) << "LLC miss/MAC" << std::setw(12) << "Branch miss" << std::setw(8) << "Faults" << std::setw(10) << "DRAM GB/s"
+              << "\n";
+
+    for (const LayerStats& s : stats) {
+        if (s.calls == 0) continue;
+        const double macs = double(s.macs);
+        const double seconds = s.elapsedNs / 1e9;
+        const double llcBytes = double(s.values[LLC_MISSES]) * Config::CACHE_LINE_SIZE;
+
+        std::cout << std::left << std::setw(10) << s.name << std::setw(15) << s.type << std::right << std::setw(6) << s.calls
+                  << std::setw(11) << cell(true, s.elapsedNs / 1e6, 3) << std::setw(10) << cell(true, macs / 1e6, 2)
+                  << std::setw(7) << cell(haveCycles && s.values[CYCLES], double(s.values[INSTRUCTIONS]) / s.values[CYCLES], 2)
+                  << std::setw(13) << cell(haveL1 && macs > 0, s.values[L1D_MISSES] / macs, 5)
+                  << std::setw(13) << cell(haveLLC && macs > 0, s.values[LLC_MISSES] / macs, 5)
+                  << std::setw(12) << cell(haveBranch, double(s.values[BRANCH_MISSES]), 0)
+                  << std::setw(8) << cell(haveFaults, double(s.values[PAGE_FAULTS]), 0)
+                  << std::setw(10) << cell(haveLLC && seconds > 0, llcBytes / seconds / 1e9, 3) << "\n";
+    }
+}
+
+void AcceleratorProfiler::beginLayer(std::size_t, const Layer&, const LayerData&) { begin = device.getStats(); }
+
+void AcceleratorProfiler::endLayer(std::size_t layerNum, const Layer& layer, const LayerData&) {
+    if (layers.size() <= layerNum) layers.resize(layerNum + 1);
+    LayerStats& layerStats = layers[layerNum];
+    layerStats.name = layer.getName();
+    layerStats.type = Layer::typeName(layer.getLType());
+    layerStats.calls++;
+    layerStats.stats += device.getStats() - begin;
+}
+
+void AcceleratorProfiler::report() const {
+    const AcceleratorConfig& config = device.getConfig();
+    std::cout << "\nAccelerator emulation (" << config.str() << "):\n";
+    std::cout << std::left << std::setw(10) << "Layer" << std::setw(15) << "Type" << std::right << std::setw(6) << "Calls" << std::setw(10)
+              << "MMACs" << std::setw(12) << "Mcycles" << std::setw(12) << "Fabric ms" << std::setw(9) << "MAC util" << std::setw(12)
+              << "FIFO stalls" << std::setw(12) << "MAC idle" << std::setw(10) << "MB in" << std::setw(10) << "MB out" << "\n";
+
+    // Utilization against every lane taking a full beat of activations each cycle
+    const double peakPerCycle = double(config.lanes) * config.busBytes;
+    AcceleratorStats total;
+    ui64 inferences = 0;
+    const auto row = [&](const std::string& name, const char* type, ui64 calls, const AcceleratorStats& s) {
+        std::cout << std::left << std::setw(10) << name << std::setw(15) << type << std::right << std::fixed << std::setw(6) << calls
+                  << std::setprecision(2) << std::setw(10) << s.macs / 1e6 << std::setprecision(3) << std::setw(12) << s.cycles / 1e6
+                  << std::setw(12) << s.cycles / (config.clockMHz * 1e3) << std::setprecision(1) << std::setw(8)
+                  << (s.cycles ? 100.0 * s.macs / (s.cycles * peakPerCycle) : 0.0) << "%" << std::setw(12) << s.fifoStalls << std::setw(12)
+                  << s.macIdle << std::setprecision(3) << std::setw(10) << s.bytesIn / 1e6 << std::setw(10) << s.bytesOut / 1e6 << "\n";
+    };
+    for (const LayerStats& layer : layers) {
+        if (layer.calls == 0 || layer.stats.transactions == 0) continue;
+        row(layer.name, layer.type, layer.calls, layer.stats);
+        total += layer.stats;
+        inferences = std::max(inferences, layer.calls);
+    }
+    row("Total", "", inferences, total);
+    std::cout.unsetf(std::ios::fixed);
+    std::cout << std::setprecision(6);
+}
+
+void TileProfiler::beginLayer(std::size_t, const Layer&, const LayerData&) { start = std::chrono::steady_clock::now(); }
+
+void TileProfiler::endLayer(std::size_t layerNum, const Layer& layer, const LayerData&) {
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const TilePlan* plan = layer.getTilePlan();
+    if (!plan) return;
+    if (layers.size() <= layerNum) layers.resize(layerNum + 1);
+    LayerStats& layerStats = layers[layerNum];
+    layerStats.name = layer.getName();
+    layerStats.type = Layer::typeName(layer.getLType());
+    layerStats.plan = std::to_string(plan->rows) + "x" + std::to_string(plan->channels) + "x" + std::to_string(plan->inChannels);
+    layerStats.tiles = plan->tiles.size();
+    layerStats.footprint = plan->footprint();
+    layerStats.calls++;
+    layerStats.predicted += plan->predicted;
+    layerStats.measured += layer.getTileTraffic();
+    layerStats.seconds += seconds;
+}
+
+void TileProfiler::report() const {
+    std::cout << "\nTile plans (budget " << getTileBudget() << " B, tile rows x out channels x in channels):\n";
+    std::cout << std::left << std::setw(10) << "Layer" << std::setw(15) << "Type" << std::setw(13) << "Tile" << std::right << std::setw(7)
+              << "Tiles" << std::setw(11) << "Scratch KB" << std::setw(10) << "Pred MB" << std::setw(10) << "Meas MB" << std::setw(8)
+              << "Meas/P" << std::setw(9) << "In MB" << std::setw(9) << "W MB" << std::setw(9) << "Out MB" << std::setw(10) << "ms" << "\n";
+    for (const LayerStats& layer : layers) {
+        if (layer.calls == 0) continue;
+        const TileTraffic& m = layer.measured;
+        std::cout << std::left << std::setw(10) << layer.name << std::setw(15) << layer.type << std::setw(13) << layer.plan << std::right
+                  << std::setw(7) << layer.tiles << std::fixed << std::setprecision(1) << std::setw(11) << layer.footprint / 1024.0
+                  << std::setprecision(3) << std::setw(10) << layer.predicted.total() / 1e6 << std::setw(10) << m.total() / 1e6
+                  << std::setprecision(2) << std::setw(8) << (layer.predicted.total() ? double(m.total()) / layer.predicted.total() : 0.0)
+                  << std::setprecision(3) << std::setw(9) << m.input / 1e6 << std::setw(9) << m.weights / 1e6 << std::setw(9) << m.output / 1e6
+                  << std::setw(10) << layer.seconds * 1e3 / layer.calls << "\n";
+    }
+    std::cout.unsetf(std::ios::fixed);
+    std::cout << std::setprecision(6);
+}
+
+}  // namespace ML
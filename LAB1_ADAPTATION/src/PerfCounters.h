@@ -0,0 +1,115 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "Accelerator.h"
+#include "Model.h"
+#include "Types.h"
+#include "Utils.h"
+
+namespace ML {
+
+// Per-layer hardware performance counters read through perf_event_open (Linux only)
+// Each counter is opened on the calling thread and on every ThreadPool::shared() worker and summed, so attach it to
+// the thread running inference; THREADED tiles are counted wherever they run. Other threads (validation jobs, the
+// weight stream reader) are not counted.
+// Counters the kernel or container refuses to open on any of those threads are reported as n/a, timing and MAC
+// counts still work.
+class PerfCounters : public InferenceObserver {
+   public:
+    enum Counter { CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, BRANCH_MISSES, PAGE_FAULTS, NUM_COUNTERS };
+
+    // Accumulated over every call of one layer
+    struct LayerStats {
+        std::string name;
+        const char* type = "None";
+        ui64 calls = 0;
+        ui64 elapsedNs = 0;
+        ui64 macs = 0;
+        ui64 values[NUM_COUNTERS] = {};
+    };
+
+   public:
+    PerfCounters();
+    virtual ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // InferenceObserver hooks
+    virtual void beginLayer(std::size_t layerNum, const Layer& layer, const LayerData& dataIn) override;
+    virtual void endLayer(std::size_t layerNum, const Layer& layer, const LayerData& dataOut) override;
+
+    inline bool isAvailable(Counter counter) const { return !fds[counter].empty(); }
+    bool anyHardwareAvailable() const;
+    static const char* counterName(Counter counter);
+
+    inline const std::vector<LayerStats>& getStats() const { return stats; }
+    void reset();
+
+    // Print IPC, misses-per-MAC and estimated DRAM bandwidth per layer
+    void report() const;
+
+   private:
+    // Current scaled value of a counter summed over the threads (corrects for multiplexing)
+    ui64 readCounter(Counter counter) const;
+
+    std::vector<int> fds[NUM_COUNTERS];  // One per counted thread, empty when unavailable
+    std::size_t threads = 1;
+    ui64 beginValues[NUM_COUNTERS];
+    std::chrono::steady_clock::time_point beginTime;
+
+    std::vector<LayerStats> stats;
+};
+
+// Per-layer accelerator traffic and timing of inferences run with InfType::ACCEL
+class AcceleratorProfiler : public InferenceObserver {
+   public:
+    explicit AcceleratorProfiler(MacAccelerator& device = MacAccelerator::shared()) : device(device) {}
+
+    virtual void beginLayer(std::size_t layerNum, const Layer& layer, const LayerData& dataIn) override;
+    virtual void endLayer(std::size_t layerNum, const Layer& layer, const LayerData& dataOut) override;
+
+    // Print cycles, estimated fabric time, MAC utilization, FIFO stalls and bytes moved per offloaded layer
+    void report() const;
+
+   private:
+    struct LayerStats {
+        std::string name;
+        const char* type = "None";
+        ui64 calls = 0;
+        AcceleratorStats stats;
+    };
+
+    MacAccelerator& device;
+    AcceleratorStats begin;
+    std::vector<LayerStats> layers;
+};
+
+// Per-layer tile plans of the TILED and ACCEL paths: the planner's predicted scratchpad traffic against what the
+// executed schedule moved, and the time the layer took
+class TileProfiler : public InferenceObserver {
+   public:
+    virtual void beginLayer(std::size_t layerNum, const Layer& layer, const LayerData& dataIn) override;
+    virtual void endLayer(std::size_t layerNum, const Layer& layer, const LayerData& dataOut) override;
+
+    void report() const;
+
+   private:
+    struct LayerStats {
+        std::string name;
+        const char* type = "None";
+        std::string plan;
+        std::size_t tiles = 0, footprint = 0;
+        ui64 calls = 0;
+        TileTraffic predicted, measured;
+        double seconds = 0;
+    };
+
+    std::chrono::steady_clock::time_point start;
+    std::vector<LayerStats> layers;
+};
+
+}  // namespace ML
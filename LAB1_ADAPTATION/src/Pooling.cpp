@@ -0,0 +1,130 @@
+#include "Pooling.h"
+
+#include <algorithm>
+
+#include "CpuDispatch.h"
+
+#if ML_HAS_ISA_TARGETS
+#    include <immintrin.h>
+#endif
+
+namespace ML {
+
+namespace {
+// One row of output windows: `x` the top left input of the first window, `y` its output pixel
+struct PoolRow {
+    const fp32* x;
+    fp32* y;
+    std::size_t outWidth, channels, rowStride, poolH, poolW;
+};
+
+// Each maxLanes reduces channels [c, ...) of window `wo` a whole vector at a time and returns the first channel left
+#if ML_HAS_ISA_TARGETS
+// Merge-masked with every lane set: the plain intrinsic passes an undefined source GCC warns about
+ML_TARGET_AVX512 ML_ISA_INLINE std::size_t maxLanes16(const PoolRow& r, std::size_t wo, std::size_t c) {
+    const fp32* x = r.x + wo * r.poolW * r.channels;
+    for (; c + 16 <= r.channels; c += 16) {
+        __m512 m = _mm512_loadu_ps(x + c);
+        for (std::size_t i = 0; i < r.poolH; i++) {
+            for (std::size_t j = 0; j < r.poolW; j++) {
+                m = _mm512_mask_max_ps(m, __mmask16(0xFFFF), m, _mm512_loadu_ps(x + i * r.rowStride + j * r.channels + c));
+            }
+        }
+        _mm512_storeu_ps(r.y + wo * r.channels + c, m);
+    }
+    return c;
+}
+
+ML_TARGET_AVX2 ML_ISA_INLINE std::size_t maxLanes8(const PoolRow& r, std::size_t wo, std::size_t c) {
+    const fp32* x = r.x + wo * r.poolW * r.channels;
+    for (; c + 8 <= r.channels; c += 8) {
+        __m256 m = _mm256_loadu_ps(x + c);
+        for (std::size_t i = 0; i < r.poolH; i++) {
+            for (std::size_t j = 0; j < r.poolW; j++) m = _mm256_max_ps(m, _mm256_loadu_ps(x + i * r.rowStride + j * r.channels + c));
+        }
+        _mm256_storeu_ps(r.y + wo * r.channels + c, m);
+    }
+    return c;
+}
+
+// SSE is part of every x86 tier
+ML_ISA_INLINE std::size_t maxLanes4(const PoolRow& r, std::size_t wo, std::size_t c) {
+    const fp32* x = r.x + wo * r.poolW * r.channels;
+    for (; c + 4 <= r.channels; c += 4) {
+        __m128 m = _mm_loadu_ps(x + c);
+        for (std::size_t i = 0; i < r.poolH; i++) {
+            for (std::size_t j = 0; j < r.poolW; j++) m = _mm_max_ps(m, _mm_loadu_ps(x + i * r.rowStride + j * r.channels + c));
+        }
+        _mm_storeu_ps(r.y + wo * r.channels + c, m);
+    }
+    return c;
+}
+#endif
+
+ML_ISA_INLINE void maxScalar(const PoolRow& r, std::size_t wo, std::size_t c) {
+    const fp32* x = r.x + wo * r.poolW * r.channels;
+    for (; c < r.channels; c++) {
+        fp32 m = x[c];
+        for (std::size_t i = 0; i < r.poolH; i++) {
+            for (std::size_t j = 0; j < r.poolW; j++) m = std::max(m, x[i * r.rowStride + j * r.channels + c]);
+        }
+        r.y[wo * r.channels + c] = m;
+    }
+}
+
+// Row kernels of the instruction set tiers, widest vectors first
+#if ML_HAS_ISA_TARGETS
+ML_TARGET_AVX512 void maxPoolRowAVX512(const PoolRow& r) {
+    for (std::size_t wo = 0; wo < r.outWidth; wo++) maxScalar(r, wo, maxLanes4(r, wo, maxLanes8(r, wo, maxLanes16(r, wo, 0))));
+}
+
+ML_TARGET_AVX2 void maxPoolRowAVX(const PoolRow& r) {
+    for (std::size_t wo = 0; wo < r.outWidth; wo++) maxScalar(r, wo, maxLanes4(r, wo, maxLanes8(r, wo, 0)));
+}
+
+void maxPoolRowSSE(const PoolRow& r) {
+    for (std::size_t wo = 0; wo < r.outWidth; wo++) maxScalar(r, wo, maxLanes4(r, wo, 0));
+}
+#else
+void maxPoolRowScalar(const PoolRow& r) {
+    for (std::size_t wo = 0; wo < r.outWidth; wo++) maxScalar(r, wo, 0);
+}
+#endif
+
+// The row kernel of the active instruction set (SSE4.2 adds nothing to vmaxps, so it shares the SSE one)
+void (*maxPoolRow())(const PoolRow&) {
+#if ML_HAS_ISA_TARGETS
+    switch (getIsa()) {
+    case Isa::AVX512: return maxPoolRowAVX512;
+    case Isa::AVX2: return maxPoolRowAVX;
+    default: return maxPoolRowSSE;
+    }
+#else
+    return maxPoolRowScalar;
+#endif
+}
+}  // namespace
+
+void maxPoolTile(const fp32* in, std::size_t rows, std::size_t width, std::size_t channels, std::size_t poolH, std::size_t poolW,
+                 fp32* out) {
+    const std::size_t outRows = rows / poolH, outWidth = width / poolW;
+    const std::size_t rowStride = width * channels;
+    void (*const poolRow)(const PoolRow&) = maxPoolRow();
+    for (std::size_t ho = 0; ho < outRows; ho++) {
+        poolRow(PoolRow{in + ho * poolH * rowStride, out + ho * outWidth * channels, outWidth, channels, rowStride, poolH, poolW});
+    }
+}
+
+const char* maxPoolKernelName() {
+#if ML_HAS_ISA_TARGETS
+    switch (getIsa()) {
+    case Isa::AVX512: return "avx512";
+    case Isa::AVX2: return "avx";
+    default: return "sse";
+    }
+#else
+    return "scalar";
+#endif
+}
+
+}  // namespace ML
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+
+#include "Types.h"
+
+namespace ML {
+
+// Max pooling of an fp32 [rows][width][channels] tile (channels contiguous per pixel, e.g. NHWC rows or one plane of
+// a blocked layout) with a poolH x poolW window of the same stride into [rows/poolH][width/poolW][channels]. Each
+// window is reduced a vector of channels at a time (vmaxps on the widest vectors of the active instruction set)
+// `out` may be `in`: an output pixel is stored after the last read of its window and never above the input of any
+// window still to come, so a producer can pool its own output tile in place (when one thread walks the tile)
+void maxPoolTile(const fp32* in, std::size_t rows, std::size_t width, std::size_t channels, std::size_t poolH, std::size_t poolW,
+                 fp32* out);
+
+// Name of the pooling kernel of the active instruction set
+const char* maxPoolKernelName();
+
+}  // namespace ML
@@ -0,0 +1,150 @@
+#include "Quantization.h"
+
+#include <algorithm>
+
+#include "CpuDispatch.h"
+
+#if ML_HAS_ISA_TARGETS
+#    include <immintrin.h>
+#endif
+
+namespace ML {
+
+QuantParams chooseQuantParams(float min, float max) {
+    min = std::min(min, 0.0f);
+    max = std::max(max, 0.0f);
+
+    QuantParams params;
+    params.scale = max > min ? (max - min) / QUANT_ACT_MAX : 1.0f;
+    params.zeroPoint = i32(std::round(-min / params.scale));
+    return params;
+}
+
+void quantizeData(const LayerData& in, LayerData& out, const QuantParams& params) {
+    const std::size_t count = in.getParams().flat_count();
+    const fp32* src = (const fp32*)in.raw();
+    ui8* dst = (ui8*)out.raw();
+    for (std::size_t i = 0; i < count; i++) dst[i] = quantize(src[i], params);
+}
+
+void dequantizeData(const LayerData& in, LayerData& out, const QuantParams& params) {
+    const std::size_t count = in.getParams().flat_count();
+    const ui8* src = (const ui8*)in.raw();
+    fp32* dst = (fp32*)out.raw();
+    for (std::size_t i = 0; i < count; i++) dst[i] = dequantize(src[i], params);
+}
+
+Requantizer Requantizer::fromScale(double factor) {
+    Requantizer r;
+    if (factor <= 0) return r;
+
+    int exponent;
+    const double fraction = std::frexp(factor, &exponent);  // factor = fraction * 2^exponent, fraction in [0.5, 1)
+    i64 multiplier = i64(std::round(fraction * (i64(1) << 31)));
+    if (multiplier == (i64(1) << 31)) {
+        multiplier /= 2;
+        exponent++;
+    }
+
+    // Factors too small to matter round to 0, the total shift must stay within [1, 62]
+    if (exponent < -31) return r;
+    r.multiplier = i32(multiplier);
+    r.shift = -std::min(exponent, 30);
+    return r;
+}
+
+#if ML_HAS_ISA_TARGETS
+namespace {
+ML_TARGET_AVX2 inline i32 horizontalSum(__m256i v) {
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+}
+
+// Sums of the whole blocks of 32 elements, `i` set to the first one left
+ML_TARGET_AVX512VNNI i32 dotU8S8VNNI(const ui8* a, const i8* b, std::size_t n, std::size_t& i) {
+    __m256i acc = _mm256_setzero_si256();
+    for (; i + 32 <= n; i += 32) {
+        acc = _mm256_dpbusd_epi32(acc, _mm256_loadu_si256((const __m256i*)(a + i)), _mm256_loadu_si256((const __m256i*)(b + i)));
+    }
+    return horizontalSum(acc);
+}
+
+ML_TARGET_AVX2 i32 dotU8S8AVX2(const ui8* a, const i8* b, std::size_t n, std::size_t& i) {
+    __m256i acc = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16(1);
+    for (; i + 32 <= n; i += 32) {
+        const __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+        const __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+        // u8 x s8 pairs summed to int16 (exact for 7 bit activations), then widened pairwise to int32
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_maddubs_epi16(va, vb), ones));
+    }
+    return horizontalSum(acc);
+}
+}  // namespace
+#endif
+
+i32 dotU8S8(const ui8* a, const i8* b, std::size_t n) {
+    std::size_t i = 0;
+    i32 sum = 0;
+
+#if ML_HAS_ISA_TARGETS
+    const Isa isa = getIsa();
+    if (isa == Isa::AVX512 && cpuHasAvx512Vnni()) {
+        sum = dotU8S8VNNI(a, b, n, i);
+    } else if (isa >= Isa::AVX2) {
+        sum = dotU8S8AVX2(a, b, n, i);
+    }
+#endif
+
+    for (; i < n; i++) sum += i32(a[i]) * i32(b[i]);
+    return sum;
+}
+
+const char* dotU8S8KernelName() {
+    const Isa isa = getIsa();
+    if (isa == Isa::AVX512 && cpuHasAvx512Vnni()) return "avx512-vnni";
+    return isa >= Isa::AVX2 ? "avx2" : "scalar";
+}
+
+void QuantizedWeights::load(const LayerData& weightData, const LayerData& biasData, const QuantParams& in, const QuantParams& out) {
+    outputs = biasData.getParams().flat_count();
+    length = weightData.getParams().flat_count() / outputs;
+    outZeroPoint = out.zeroPoint;
+    const fp32* w = (const fp32*)weightData.raw();
+    const fp32* b = (const fp32*)biasData.raw();
+
+    weights.resize(outputs * length);
+    scales.resize(outputs);
+    bias.resize(outputs);
+    requant.resize(outputs);
+
+    for (std::size_t m = 0; m < outputs; m++) {
+        float maxAbs = 0;
+        for (std::size_t k = 0; k < length; k++) maxAbs = std::max(maxAbs, std::fabs(w[k * outputs + m]));
+        scales[m] = maxAbs > 0 ? maxAbs / QUANT_WEIGHT_MAX : 1.0f;
+
+        // sum_k (a_k - zp) * w_k = dot(a, w) - zp * sum_k w_k, so the zero point term joins the bias
+        i32 weightSum = 0;
+        for (std::size_t k = 0; k < length; k++) {
+            const i8 q = i8(std::round(w[k * outputs + m] / scales[m]));
+            weights[m * length + k] = q;
+            weightSum += q;
+        }
+
+        const double accScale = double(in.scale) * scales[m];
+        bias[m] = i32(std::round(b[m] / accScale)) - in.zeroPoint * weightSum;
+        requant[m] = Requantizer::fromScale(accScale / out.scale);
+    }
+}
+
+void QuantizedWeights::clear() {
+    weights.clear();
+    weights.shrink_to_fit();
+    scales.clear();
+    bias.clear();
+    requant.clear();
+}
+
+}  // namespace ML
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+#include "Types.h"
+#include "layers/Layer.h"
+
+namespace ML {
+
+// Activations are uint8 restricted to [0, QUANT_ACT_MAX]: 7 bits keep the AVX2 maddubs pair sums (2 * 127 * 127)
+// below the int16 saturation limit, so the scalar, AVX2 and VNNI kernels produce bit-identical results
+constexpr i32 QUANT_ACT_MAX = 127;
+
+// Weights are symmetric int8 in [-QUANT_WEIGHT_MAX, QUANT_WEIGHT_MAX] with one scale per output channel
+constexpr i32 QUANT_WEIGHT_MAX = 127;
+
+// Scale and zero point mapping [min, max] (widened to include 0) onto [0, QUANT_ACT_MAX]
+QuantParams chooseQuantParams(float min, float max);
+
+inline ui8 quantize(fp32 value, const QuantParams& params) {
+    const float q = std::round(value / params.scale) + params.zeroPoint;
+    return ui8(q < 0 ? 0 : (q > QUANT_ACT_MAX ? QUANT_ACT_MAX : q));
+}
+
+inline fp32 dequantize(ui8 value, const QuantParams& params) { return params.scale * (i32(value) - params.zeroPoint); }
+
+// Convert whole buffers between fp32 and quantized uint8 (same element count)
+void quantizeData(const LayerData& in, LayerData& out, const QuantParams& params);
+void dequantizeData(const LayerData& in, LayerData& out, const QuantParams& params);
+
+// Integer approximation of a positive real factor: factor ~= multiplier * 2^-(31 + shift), multiplier in [2^30, 2^31)
+struct Requantizer {
+    i32 multiplier = 0;
+    int shift = 0;
+
+    static Requantizer fromScale(double factor);
+
+    // Round half up
+    inline i32 apply(i32 acc) const {
+        const int total = 31 + shift;
+        return i32((i64(acc) * multiplier + (i64(1) << (total - 1))) >> total);
+    }
+};
+
+// Dot product of uint8 activations and int8 weights accumulated in int32
+// Uses AVX-512 VNNI vpdpbusd (AVX512 tier on a CPU with VNNI) or AVX2 vpmaddubsw (AVX2 tier and up), scalar otherwise
+i32 dotU8S8(const ui8* a, const i8* b, std::size_t n);
+
+// Name of the dot product kernel of the active instruction set
+const char* dotU8S8KernelName();
+
+// Float weights and bias of a Conv/Dense layer quantized once at load
+// The [K][M] float layout (K = reduction length, M = output channels) is transposed to [M][K] so every output is one
+// contiguous dot product
+struct QuantizedWeights {
+    std::size_t outputs = 0;  // M
+    std::size_t length = 0;   // K
+    std::vector<i8> weights;
+    std::vector<float> scales;         // Per output channel
+    std::vector<i32> bias;             // Quantized bias with the input zero point term folded in
+    std::vector<Requantizer> requant;  // Per output channel, input scale * weight scale / output scale
+    i32 outZeroPoint = 0;
+
+    void load(const LayerData& weightData, const LayerData& biasData, const QuantParams& in, const QuantParams& out);
+    void clear();
+
+    // Fused epilogue: requantize the int32 sum of output m, optionally apply ReLU, saturate to the activation range
+    inline ui8 output(i32 acc, std::size_t m, bool relu) const {
+        const i32 q = outZeroPoint + requant[m].apply(acc);
+        const i32 lo = relu ? outZeroPoint : 0;
+        return ui8(q < lo ? lo : (q > QUANT_ACT_MAX ? QUANT_ACT_MAX : q));
+    }
+};
+
+}  // namespace ML
@@ -0,0 +1,326 @@
+#include "Server.h"
+
+#ifndef ZEDBOARD
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace ML {
+
+namespace {
+// Send/receive exactly `bytes`, false once the peer has gone away
+bool writeAll(int fd, const void* data, std::size_t bytes) {
+    const char* p = (const char*)data;
+    while (bytes) {
+        const ssize_t n = ::send(fd, p, bytes, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+bool readAll(int fd, void* data, std::size_t bytes) {
+    char* p = (char*)data;
+    while (bytes) {
+        const ssize_t n = ::recv(fd, p, bytes, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+sockaddr_un socketAddress(const std::string& path) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) throw std::runtime_error("Socket path too long: " + path);
+    std::strcpy(address.sun_path, path.c_str());
+    return address;
+}
+
+inline double toMs(ui64 ns) { return ns / 1e6; }
+}  // namespace
+
+// A client socket shared by its reader thread and the batcher answering its requests
+struct InferenceServer::Connection {
+    int fd;
+    std::mutex writeMutex;
+    std::atomic<bool> finished{false};  // Reader thread has exited
+
+    explicit Connection(int fd) : fd(fd) {}
+    ~Connection() { ::close(fd); }
+
+    // Whole messages only, responses to pipelined requests may be written from different batches
+    bool send(ui32 magic, const void* payload, std::size_t bytes) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        const MessageHeader header{magic, ui32(bytes)};
+        return writeAll(fd, &header, sizeof(header)) && writeAll(fd, payload, bytes);
+    }
+};
+
+InferenceServer::InferenceServer(const Model& model, const ServerConfig& config)
+    : model(model), config(config), batchSizes(config.maxBatch + 1, 0) {
+    if (config.maxBatch == 0) throw std::runtime_error("The server needs a max batch of at least 1");
+    model.reserveBatch(config.maxBatch);
+}
+
+InferenceServer::~InferenceServer() { stop(); }
+
+void InferenceServer::stop() { stopping = true; }
+
+void InferenceServer::run() {
+    listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) throw std::runtime_error(std::string("Failed to create socket: ") + std::strerror(errno));
+
+    const sockaddr_un address = socketAddress(config.socketPath);
+    ::unlink(config.socketPath.c_str());
+    if (::bind(listenFd, (const sockaddr*)&address, sizeof(address)) < 0 || ::listen(listenFd, 64) < 0) {
+        const std::string error = std::strerror(errno);
+        ::close(listenFd);
+        throw std::runtime_error("Failed to listen on " + config.socketPath + ": " + error);
+    }
+    std::ostringstream message;
+    message << "Serving on " << config.socketPath << " (max batch " << config.maxBatch << ", max wait " << config.maxWaitMs << " ms, "
+            << infTypeName(config.infType) << ")";
+    logInfo(message.str());
+
+    std::thread batcher(&InferenceServer::batchLoop, this);
+
+    // Poll so stop() is noticed without a connection arriving
+    while (!stopping) {
+        pollfd pfd{listenFd, POLLIN, 0};
+        if (::poll(&pfd, 1, 100) <= 0) continue;
+        const int fd = ::accept(listenFd, nullptr, nullptr);
+        if (fd < 0) continue;
+
+        for (auto it = readers.begin(); it != readers.end();) {
+            if (!it->connection->finished) {
+                ++it;
+                continue;
+            }
+            it->thread.join();
+            it = readers.erase(it);
+        }
+
+        std::shared_ptr<Connection> connection(new Connection(fd));
+        readers.push_back({connection, std::thread(&InferenceServer::readLoop, this, connection)});
+    }
+
+    // Unblock the readers, let the batcher drain what is queued, then tear down
+    for (Reader& reader : readers) {
+        ::shutdown(reader.connection->fd, SHUT_RD);
+        reader.thread.join();
+    }
+    readers.clear();
+    queueReady.notify_all();
+    batcher.join();
+    ::close(listenFd);
+    ::unlink(config.socketPath.c_str());
+}
+
+void InferenceServer::readLoop(std::shared_ptr<Connection> connection) {
+    const LayerParams& inputParams = model[0].getInputParams();
+    const std::size_t inputBytes = inputParams.flat_count() * sizeof(fp32);
+
+    MessageHeader header;
+    while (!stopping && readAll(connection->fd, &header, sizeof(header))) {
+        if (header.magic == SERVER_MAGIC_STATS && header.bytes == 0) {
+            const std::string report = statsReport();
+            if (!connection->send(SERVER_MAGIC_STATS, report.data(), report.size())) break;
+            continue;
+        }
+        if (header.magic != SERVER_MAGIC_INFER || header.bytes != inputBytes) {
+            const std::string error = "Expected an INFER message of " + std::to_string(inputBytes) + " bytes";
+            connection->send(SERVER_MAGIC_ERROR, error.data(), error.size());
+            break;  // The stream can no longer be framed
+        }
+
+        Request request;
+        request.connection = connection;
+        request.input.reset(new LayerData({sizeof(fp32), inputParams.dims}));
+        request.input->allocData();
+        if (!readAll(connection->fd, request.input->raw(), inputBytes)) break;
+        request.arrival = std::chrono::steady_clock::now();
+
+        std::lock_guard<std::mutex> lock(queueMutex);
+        queue.push_back(std::move(request));
+        queueReady.notify_one();
+    }
+    connection->finished = true;
+}
+
+void InferenceServer::batchLoop() {
+    const auto maxWait = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(config.maxWaitMs));
+
+    std::unique_lock<std::mutex> lock(queueMutex);
+    while (true) {
+        queueReady.wait_for(lock, std::chrono::milliseconds(100), [&]() { return stopping || !queue.empty(); });
+        if (queue.empty()) {
+            if (stopping) return;
+            continue;
+        }
+
+        // Wait for the batch to fill until the oldest request's deadline
+        const auto deadline = queue.front().arrival + maxWait;
+        queueReady.wait_until(lock, deadline, [&]() { return stopping || queue.size() >= config.maxBatch; });
+
+        const std::size_t depth = queue.size();
+        const std::size_t size = std::min(depth, config.maxBatch);
+        std::vector<Request> batch;
+        for (std::size_t i = 0; i < size; i++) {
+            batch.push_back(std::move(queue.front()));
+            queue.pop_front();
+        }
+        lock.unlock();
+
+        std::vector<const LayerData*> inputs;
+        for (const Request& request : batch) inputs.push_back(request.input.get());
+        std::vector<const LayerData*> outputs;
+        std::string error;
+        try {
+            outputs = model.inferenceBatch(inputs, config.infType);
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+
+        const auto done = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < batch.size(); i++) {
+            if (error.empty()) {
+                batch[i].connection->send(SERVER_MAGIC_INFER, outputs[i]->raw(), outputs[i]->getParams().byte_size());
+            } else {
+                batch[i].connection->send(SERVER_MAGIC_ERROR, error.data(), error.size());
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> statsLock(statsMutex);
+            requests += batch.size();
+            batches++;
+            batchSizes[size]++;
+            queueDepths.record(depth);
+            for (const Request& request : batch) {
+                latencies.record(std::chrono::duration_cast<std::chrono::nanoseconds>(done - request.arrival).count());
+            }
+        }
+        lock.lock();
+    }
+}
+
+std::string InferenceServer::statsReport() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2);
+    out << "Requests " << requests << " in " << batches << " batches (mean batch " << (batches ? double(requests) / batches : 0.0) << ")\n";
+    out << "Request latency ms: p50 " << toMs(latencies.percentile(50)) << "  p90 " << toMs(latencies.percentile(90)) << "  p99 "
+        << toMs(latencies.percentile(99)) << "  max " << toMs(latencies.max()) << "\n";
+    out << "Queue depth at dispatch: p50 " << queueDepths.percentile(50) << "  p90 " << queueDepths.percentile(90) << "  p99 "
+        << queueDepths.percentile(99) << "  max " << queueDepths.max() << "\n";
+    out << "Batch size histogram:\n";
+    for (std::size_t size = 1; size < batchSizes.size(); size++) {
+        const double share = batches ? 100.0 * batchSizes[size] / batches : 0.0;
+        out << "  " << std::setw(3) << size << std::setw(8) << batchSizes[size] << std::setw(8) << share << "%  "
+            << std::string(std::size_t(share / 2 + 0.5), '#') << "\n";
+    }
+    return out.str();
+}
+
+void runLoadGenerator(const LoadGenConfig& config) {
+    LayerData input({sizeof(fp32), {128, 128, 1}, config.inputPath.c_str()});
+    input.loadData();
+    const std::size_t inputBytes = input.getParams().byte_size();
+    const sockaddr_un address = socketAddress(config.socketPath);
+
+    auto connectToServer = [&]() {
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || ::connect(fd, (const sockaddr*)&address, sizeof(address)) < 0) {
+            if (fd >= 0) ::close(fd);
+            throw std::runtime_error("Failed to connect to " + config.socketPath + ": " + std::strerror(errno));
+        }
+        return fd;
+    };
+
+    // Reads one response, the payload of ERROR responses is thrown
+    auto receive = [](int fd, ui32 expected, std::vector<char>& payload) {
+        MessageHeader header;
+        if (!readAll(fd, &header, sizeof(header))) throw std::runtime_error("Server closed the connection");
+        payload.resize(header.bytes);
+        if (!readAll(fd, payload.data(), payload.size())) throw std::runtime_error("Server closed the connection");
+        if (header.magic == SERVER_MAGIC_ERROR) throw std::runtime_error("Server error: " + std::string(payload.begin(), payload.end()));
+        if (header.magic != expected) throw std::runtime_error("Unexpected response from the server");
+    };
+
+    std::mutex mutex;
+    LatencyHistogram latencies;
+    std::vector<float> firstOutput;
+    std::string failure;
+
+    logInfo("Sending " + std::to_string(config.requests) + " requests from each of " + std::to_string(config.clients) + " clients to " +
+            config.socketPath);
+    const auto begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> clients;
+    for (std::size_t c = 0; c < config.clients; c++) {
+        clients.emplace_back([&]() {
+            try {
+                const int fd = connectToServer();
+                std::vector<char> payload;
+                for (std::size_t r = 0; r < config.requests; r++) {
+                    const auto sent = std::chrono::steady_clock::now();
+                    const MessageHeader header{SERVER_MAGIC_INFER, ui32(inputBytes)};
+                    if (!writeAll(fd, &header, sizeof(header)) || !writeAll(fd, input.raw(), inputBytes)) {
+                        throw std::runtime_error("Server closed the connection");
+                    }
+                    receive(fd, SERVER_MAGIC_INFER, payload);
+                    const ui64 ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - sent).count();
+
+                    std::lock_guard<std::mutex> lock(mutex);
+                    latencies.record(ns);
+                    if (firstOutput.empty()) firstOutput.assign((const float*)payload.data(), (const float*)(payload.data() + payload.size()));
+                }
+                ::close(fd);
+            } catch (const std::exception& e) {
+                std::lock_guard<std::mutex> lock(mutex);
+                failure = e.what();
+            }
+        });
+    }
+    for (std::thread& client : clients) client.join();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    if (!failure.empty()) throw std::runtime_error(failure);
+
+    std::cout << "\nLoad generator: " << latencies.count() << " requests in " << std::fixed << std::setprecision(3) << seconds << " s ("
+              << latencies.count() / seconds << " req/s) from " << config.clients << " clients\n";
+    std::cout << "Client latency ms: p50 " << toMs(latencies.percentile(50)) << "  p90 " << toMs(latencies.percentile(90)) << "  p99 "
+              << toMs(latencies.percentile(99)) << "  max " << toMs(latencies.max()) << "\n";
+    if (!firstOutput.empty()) {
+        const std::size_t best = std::max_element(firstOutput.begin(), firstOutput.end()) - firstOutput.begin();
+        std::cout << "Top-1 class " << best << " (" << std::setprecision(2) << firstOutput[best] * 100 << "%)\n";
+    }
+    std::cout.unsetf(std::ios::fixed);
+    std::cout << std::setprecision(6);
+
+    const int fd = connectToServer();
+    const MessageHeader header{SERVER_MAGIC_STATS, 0};
+    std::vector<char> payload;
+    if (!writeAll(fd, &header, sizeof(header))) throw std::runtime_error("Server closed the connection");
+    receive(fd, SERVER_MAGIC_STATS, payload);
+    ::close(fd);
+    std::cout << "\nServer statistics:\n" << std::string(payload.begin(), payload.end());
+}
+
+}  // namespace ML
+
+#endif
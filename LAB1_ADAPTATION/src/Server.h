@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Benchmark.h"
+#include "Model.h"
+#include "Types.h"
+
+namespace ML {
+
+// Wire format of the inference server (host byte order): every message is a header followed by `bytes` of payload
+// INFER requests carry the model input as fp32 and are answered with the fp32 model output, STATS requests have no
+// payload and are answered with the text of InferenceServer::statsReport(), failures are answered with ERROR text
+constexpr ui32 SERVER_MAGIC_INFER = 0x46494c4d;  // "MLIF"
+constexpr ui32 SERVER_MAGIC_STATS = 0x54534c4d;  // "MLST"
+constexpr ui32 SERVER_MAGIC_ERROR = 0x52454c4d;  // "MLER"
+
+struct MessageHeader {
+    ui32 magic;
+    ui32 bytes;
+};
+
+struct ServerConfig {
+    std::string socketPath = "/tmp/ml.sock";
+    std::size_t maxBatch = 8;   // Requests run together at most
+    double maxWaitMs = 2.0;     // How long the oldest queued request waits for the batch to fill
+    Layer::InfType infType = Layer::InfType::THREADED;
+};
+
+// Long-running server on a Unix domain socket for an allocated model
+// One reader thread per connection queues requests; a single batcher thread owns the model, waits until maxBatch
+// requests are queued or the oldest one has waited maxWaitMs and runs them through Model::inferenceBatch
+class InferenceServer {
+   public:
+    InferenceServer(const Model& model, const ServerConfig& config);
+    ~InferenceServer();
+
+    InferenceServer(const InferenceServer&) = delete;
+    InferenceServer& operator=(const InferenceServer&) = delete;
+
+    // Accept connections until stop() (safe to call from a signal-watching thread)
+    void run();
+    void stop();
+
+    // Request count, batch-size distribution, queue depth at dispatch and request latency percentiles
+    std::string statsReport() const;
+
+   private:
+    struct Connection;
+    struct Request {
+        std::shared_ptr<Connection> connection;
+        std::unique_ptr<LayerData> input;
+        std::chrono::steady_clock::time_point arrival;
+    };
+
+    void readLoop(std::shared_ptr<Connection> connection);
+    void batchLoop();
+
+    const Model& model;
+    ServerConfig config;
+    int listenFd = -1;
+    std::atomic<bool> stopping{false};
+
+    std::mutex queueMutex;
+    std::condition_variable queueReady;
+    std::deque<Request> queue;
+
+    struct Reader {
+        std::shared_ptr<Connection> connection;
+        std::thread thread;
+    };
+    std::vector<Reader> readers;  // Finished ones are joined as new connections arrive
+
+    mutable std::mutex statsMutex;
+    ui64 requests = 0, batches = 0;
+    std::vector<ui64> batchSizes;  // Batches of each size, index 0 unused
+    LatencyHistogram queueDepths;  // Queued requests when a batch is taken (exact below 256)
+    LatencyHistogram latencies;    // Arrival to response, ns
+};
+
+// Closed-loop load generator: `clients` connections each send `requests` inputs one after the other
+struct LoadGenConfig {
+    std::string socketPath = "/tmp/ml.sock";
+    std::size_t clients = 4;
+    std::size_t requests = 50;
+    std::string inputPath = "data/test_input.bin";
+};
+
+// Print throughput, client-side latency percentiles and the server's statistics
+void runLoadGenerator(const LoadGenConfig& config);
+
+}  // namespace ML
@@ -0,0 +1,362 @@
+#include "SharedRing.h"
+
+#ifndef ZEDBOARD
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace ML {
+
+namespace {
+constexpr ui32 SHM_RING_MAGIC = 0x474e524d;  // "MRNG"
+
+// Shared (not FUTEX_PRIVATE) operations, the word lives in memory mapped by several processes
+long futex(std::atomic<ui32>* word, int op, ui32 value, const timespec* timeout) {
+    return syscall(SYS_futex, (ui32*)word, op, value, timeout, nullptr, 0);
+}
+
+ui64 monotonicNs() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ui64(now.tv_sec) * 1000000000ull + now.tv_nsec;
+}
+
+inline double toMs(ui64 ns) { return ns / 1e6; }
+}  // namespace
+
+void FutexEvent::notify() {
+    sequence.fetch_add(1);
+    if (waiters.load()) futex(&sequence, FUTEX_WAKE, INT_MAX, nullptr);
+}
+
+void FutexEvent::wait(ui32 seen, int timeoutMs) {
+    const timespec timeout{timeoutMs / 1000, (timeoutMs % 1000) * 1000000L};
+    waiters.fetch_add(1);
+    futex(&sequence, FUTEX_WAIT, seen, &timeout);  // Returns at once if the sequence already moved
+    waiters.fetch_sub(1);
+}
+
+void MpmcQueue::init() {
+    for (ui32 i = 0; i < SHM_RING_MAX_SLOTS; i++) cells[i].sequence.store(i, std::memory_order_relaxed);
+    enqueuePos.store(0, std::memory_order_relaxed);
+    dequeuePos.store(0, std::memory_order_relaxed);
+}
+
+// A cell is free for position pos when its sequence equals pos and holds a value when it equals pos + 1
+bool MpmcQueue::push(ui32 value) {
+    ui64 pos = enqueuePos.load(std::memory_order_relaxed);
+    while (true) {
+        Cell& cell = cells[pos & (SHM_RING_MAX_SLOTS - 1)];
+        const ui64 sequence = cell.sequence.load(std::memory_order_acquire);
+        if (sequence == pos) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                cell.value = value;
+                cell.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (sequence < pos) {
+            return false;  // Full
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool MpmcQueue::pop(ui32& value) {
+    ui64 pos = dequeuePos.load(std::memory_order_relaxed);
+    while (true) {
+        Cell& cell = cells[pos & (SHM_RING_MAX_SLOTS - 1)];
+        const ui64 sequence = cell.sequence.load(std::memory_order_acquire);
+        if (sequence == pos + 1) {
+            if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                value = cell.value;
+                cell.sequence.store(pos + SHM_RING_MAX_SLOTS, std::memory_order_release);
+                return true;
+            }
+        } else if (sequence < pos + 1) {
+            return false;  // Empty
+        } else {
+            pos = dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool SpscQueue::push(ui32 value) {
+    const ui64 t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) == SHM_RING_MAX_SLOTS) return false;
+    values[t & (SHM_RING_MAX_SLOTS - 1)] = value;
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+}
+
+bool SpscQueue::pop(ui32& value) {
+    const ui64 h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire)) return false;
+    value = values[h & (SHM_RING_MAX_SLOTS - 1)];
+    head.store(h + 1, std::memory_order_release);
+    return true;
+}
+
+std::unique_ptr<SharedRing> SharedRing::create(const std::string& name, ui32 slots, ui32 inputFloats, ui32 outputFloats) {
+    if (slots == 0 || slots > SHM_RING_MAX_SLOTS) {
+        throw std::runtime_error("A shared ring holds 1 to " + std::to_string(SHM_RING_MAX_SLOTS) + " slots");
+    }
+    const std::size_t slotBytes = (INPUT_OFFSET + (inputFloats + outputFloats) * sizeof(fp32) + 63) / 64 * 64;
+    const std::size_t bytes = sizeof(ShmRingHeader) + slots * slotBytes;
+
+    shm_unlink(name.c_str());
+    const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) throw std::runtime_error("Failed to create shared memory " + name + ": " + std::strerror(errno));
+    if (ftruncate(fd, bytes) < 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        throw std::runtime_error("Failed to size shared memory " + name + ": " + std::strerror(errno));
+    }
+    void* base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        throw std::runtime_error("Failed to map shared memory " + name + ": " + std::strerror(errno));
+    }
+
+    // The new object is zero filled, which is already the empty state of every counter and flag
+    std::unique_ptr<SharedRing> ring(new SharedRing(name, base, bytes, true));
+    ShmRingHeader& header = ring->header();
+    header.slotCount = slots;
+    header.inputFloats = inputFloats;
+    header.outputFloats = outputFloats;
+    header.slotBytes = slotBytes;
+    header.freeSlots.init();
+    header.submitted.init();
+    for (ui32 i = 0; i < slots; i++) header.freeSlots.push(i);
+    std::atomic_thread_fence(std::memory_order_release);
+    header.magic = SHM_RING_MAGIC;
+    return ring;
+}
+
+std::unique_ptr<SharedRing> SharedRing::attach(const std::string& name) {
+    const int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) throw std::runtime_error("Failed to open shared memory " + name + " (is `ml shm-serve` running?): " + std::strerror(errno));
+    struct stat info;
+    if (fstat(fd, &info) < 0 || std::size_t(info.st_size) < sizeof(ShmRingHeader)) {
+        close(fd);
+        throw std::runtime_error("Shared memory " + name + " is not a request ring");
+    }
+    void* base = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) throw std::runtime_error("Failed to map shared memory " + name + ": " + std::strerror(errno));
+
+    std::unique_ptr<SharedRing> ring(new SharedRing(name, base, info.st_size, false));
+    if (ring->header().magic != SHM_RING_MAGIC) throw std::runtime_error("Shared memory " + name + " is not a request ring");
+    return ring;
+}
+
+SharedRing::~SharedRing() {
+    munmap(base, bytes);
+    if (owner) shm_unlink(name.c_str());
+}
+
+RingProducer::RingProducer(SharedRing& ring) : ring(ring) {
+    ShmRingHeader& header = ring.header();
+    for (id = 0; id < SHM_RING_MAX_PRODUCERS; id++) {
+        ui32 expected = 0;
+        if (header.producers[id].claimed.compare_exchange_strong(expected, 1)) return;
+    }
+    throw std::runtime_error("All " + std::to_string(SHM_RING_MAX_PRODUCERS) + " producer ids of the shared ring are taken");
+}
+
+RingProducer::~RingProducer() { ring.header().producers[id].claimed = 0; }
+
+ui32 RingProducer::acquire() {
+    ShmRingHeader& header = ring.header();
+    while (true) {
+        const ui32 seen = header.freeEvent.sequence.load();
+        ui32 slot;
+        if (header.freeSlots.pop(slot)) return slot;
+        header.freeEvent.wait(seen, 100);
+    }
+}
+
+void RingProducer::submit(ui32 slot) {
+    ShmRingHeader& header = ring.header();
+    ShmSlotHeader& slotHeader = ring.slot(slot);
+    slotHeader.producer = id;
+    slotHeader.status = 0;
+    slotHeader.submitNs = monotonicNs();
+    header.submitted.push(slot);  // Never full, there are no more slots than cells
+    header.submitEvent.notify();
+}
+
+ui32 RingProducer::waitCompleted() {
+    ShmRingHeader& header = ring.header();
+    ShmRingHeader::Producer& producer = header.producers[id];
+    while (true) {
+        const ui32 seen = producer.completedEvent.sequence.load();
+        ui32 slot;
+        if (producer.completed.pop(slot)) return slot;
+        if (!header.serving) throw std::runtime_error("The shared ring server is not running");
+        producer.completedEvent.wait(seen, 100);
+    }
+}
+
+void RingProducer::release(ui32 slot) {
+    ShmRingHeader& header = ring.header();
+    header.freeSlots.push(slot);
+    header.freeEvent.notify();
+}
+
+RingServer::RingServer(const Model& model, SharedRing& ring, std::size_t maxBatch, Layer::InfType infType)
+    : model(model), ring(ring), maxBatch(std::max<std::size_t>(maxBatch, 1)), infType(infType), batchSizes(this->maxBatch + 1, 0) {
+    const ShmRingHeader& header = ring.header();
+    const LayerParams& inputParams = model[0].getInputParams();
+    if (header.inputFloats != inputParams.flat_count() || header.outputFloats != model.getOutputLayer().getOutputParams().flat_count()) {
+        throw std::runtime_error("Shared ring slots do not match the model input/output size");
+    }
+    for (ui32 i = 0; i < header.slotCount; i++) {
+        inputs.emplace_back(new LayerData({sizeof(fp32), inputParams.dims}));
+        inputs.back()->setView(ring.input(i));
+    }
+    model.reserveBatch(this->maxBatch);
+}
+
+void RingServer::run() {
+    ShmRingHeader& header = ring.header();
+    header.serving = 1;
+    logInfo("Serving shared ring (" + std::to_string(header.slotCount) + " slots, max batch " + std::to_string(maxBatch) + ", " +
+            infTypeName(infType) + ")");
+
+    std::vector<ui32> slots;
+    std::vector<const LayerData*> batch;
+    while (!stopping) {
+        const ui32 seen = header.submitEvent.sequence.load();
+        slots.clear();
+        ui32 slot;
+        while (slots.size() < maxBatch && header.submitted.pop(slot)) slots.push_back(slot);
+        if (slots.empty()) {
+            header.submitEvent.wait(seen, 100);
+            continue;
+        }
+
+        batch.clear();
+        for (ui32 index : slots) batch.push_back(inputs[index].get());
+        std::vector<const LayerData*> outputs;
+        bool failed = false;
+        try {
+            outputs = model.inferenceBatch(batch, infType);
+        } catch (const std::exception& e) {
+            logWarn(std::string("Shared ring batch failed: ") + e.what());
+            failed = true;
+        }
+
+        const ui64 done = monotonicNs();
+        for (std::size_t i = 0; i < slots.size(); i++) {
+            ShmSlotHeader& slotHeader = ring.slot(slots[i]);
+            if (!failed) std::memcpy(ring.output(slots[i]), outputs[i]->raw(), header.outputFloats * sizeof(fp32));
+            slotHeader.status = failed ? 1 : 0;
+            latencies.record(done - slotHeader.submitNs);
+
+            ShmRingHeader::Producer& producer = header.producers[slotHeader.producer % SHM_RING_MAX_PRODUCERS];
+            producer.completed.push(slots[i]);
+            producer.completedEvent.notify();
+        }
+        requests += slots.size();
+        batches++;
+        batchSizes[slots.size()]++;
+    }
+    header.serving = 0;
+}
+
+std::string RingServer::statsReport() const {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2);
+    out << "Requests " << requests << " in " << batches << " batches (mean batch " << (batches ? double(requests) / batches : 0.0) << ")\n";
+    out << "Submit to completion ms: p50 " << toMs(latencies.percentile(50)) << "  p90 " << toMs(latencies.percentile(90)) << "  p99 "
+        << toMs(latencies.percentile(99)) << "  max " << toMs(latencies.max()) << "\n";
+    out << "Batch size histogram:\n";
+    for (std::size_t size = 1; size < batchSizes.size(); size++) {
+        const double share = batches ? 100.0 * batchSizes[size] / batches : 0.0;
+        out << "  " << std::setw(3) << size << std::setw(8) << batchSizes[size] << std::setw(8) << share << "%  "
+            << std::string(std::size_t(share / 2 + 0.5), '#') << "\n";
+    }
+    return out.str();
+}
+
+void runRingLoadGenerator(const std::string& name, std::size_t clients, std::size_t requests, const std::string& inputPath) {
+    LayerData input({sizeof(fp32), {128, 128, 1}, inputPath.c_str()});
+    input.loadData();
+
+    std::unique_ptr<SharedRing> ring = SharedRing::attach(name);
+    if (ring->header().inputFloats != input.getParams().flat_count()) throw std::runtime_error("Input does not fit the ring's slots");
+    const ui32 outputFloats = ring->header().outputFloats;
+
+    std::mutex mutex;
+    LatencyHistogram latencies;
+    std::vector<float> firstOutput;
+    std::string failure;
+
+    logInfo("Submitting " + std::to_string(requests) + " requests from each of " + std::to_string(clients) + " producers to " + name);
+    const auto begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (std::size_t c = 0; c < clients; c++) {
+        threads.emplace_back([&]() {
+            try {
+                RingProducer producer(*ring);
+                for (std::size_t r = 0; r < requests; r++) {
+                    const auto start = std::chrono::steady_clock::now();
+                    // A capture daemon would compute its spectrogram straight into the slot
+                    const ui32 slot = producer.acquire();
+                    std::memcpy(producer.input(slot), input.raw(), input.getParams().byte_size());
+                    producer.submit(slot);
+
+                    const ui32 completed = producer.waitCompleted();
+                    if (producer.failed(completed)) throw std::runtime_error("The server failed a request");
+                    const ui64 ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        latencies.record(ns);
+                        if (firstOutput.empty()) firstOutput.assign(producer.output(completed), producer.output(completed) + outputFloats);
+                    }
+                    producer.release(completed);
+                }
+            } catch (const std::exception& e) {
+                std::lock_guard<std::mutex> lock(mutex);
+                failure = e.what();
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    if (!failure.empty()) throw std::runtime_error(failure);
+
+    std::cout << "\nShared ring load generator: " << latencies.count() << " requests in " << std::fixed << std::setprecision(3) << seconds
+              << " s (" << latencies.count() / seconds << " req/s) from " << clients << " producers\n";
+    std::cout << "Producer latency ms: p50 " << toMs(latencies.percentile(50)) << "  p90 " << toMs(latencies.percentile(90)) << "  p99 "
+              << toMs(latencies.percentile(99)) << "  max " << toMs(latencies.max()) << "\n";
+    if (!firstOutput.empty()) {
+        const std::size_t best = std::max_element(firstOutput.begin(), firstOutput.end()) - firstOutput.begin();
+        std::cout << "Top-1 class " << best << " (" << std::setprecision(2) << firstOutput[best] * 100 << "%)\n";
+    }
+    std::cout.unsetf(std::ios::fixed);
+    std::cout << std::setprecision(6);
+}
+
+}  // namespace ML
+
+#endif
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+#include "Model.h"
+#include "Types.h"
+
+namespace ML {
+
+// Fixed capacity of the shared-memory request ring (its layout is the same for every process mapping it)
+constexpr ui32 SHM_RING_MAX_SLOTS = 64;      // Power of two
+constexpr ui32 SHM_RING_MAX_PRODUCERS = 16;
+
+// Sequence word in shared memory that waiters sleep on with FUTEX_WAIT until notify() moves it
+// Usage: seen = sequence, try the queue, wait(seen) if it was empty; a notify in between makes the wait return at once
+struct FutexEvent {
+    std::atomic<ui32> sequence;
+    std::atomic<ui32> waiters;
+
+    void notify();
+    void wait(ui32 seen, int timeoutMs);
+};
+
+// Bounded lock-free multi-producer multi-consumer queue of slot indices (per-cell sequence numbers)
+struct MpmcQueue {
+    struct Cell {
+        std::atomic<ui64> sequence;
+        ui32 value;
+    };
+
+    alignas(64) std::atomic<ui64> enqueuePos;
+    alignas(64) std::atomic<ui64> dequeuePos;
+    alignas(64) Cell cells[SHM_RING_MAX_SLOTS];
+
+    void init();
+    bool push(ui32 value);
+    bool pop(ui32& value);
+};
+
+// Single-producer single-consumer queue of slot indices
+struct SpscQueue {
+    alignas(64) std::atomic<ui64> head;  // Next to pop, written by the consumer
+    alignas(64) std::atomic<ui64> tail;  // Next to push, written by the producer
+    ui32 values[SHM_RING_MAX_SLOTS];
+
+    bool push(ui32 value);
+    bool pop(ui32& value);
+};
+
+// Start of the shared-memory object, followed by the slots
+// Producers take a free slot (MPMC), write the input into it and submit it (MPMC); the server runs the model on the
+// slot in place, writes the output next to it and hands the slot back on the producer's completion queue (SPSC)
+struct ShmRingHeader {
+    ui32 magic;
+    ui32 slotCount;
+    ui32 inputFloats, outputFloats;
+    ui64 slotBytes;
+    std::atomic<ui32> serving;  // 1 while the server runs
+
+    MpmcQueue freeSlots;
+    MpmcQueue submitted;
+    FutexEvent freeEvent;    // Producers waiting for a free slot
+    FutexEvent submitEvent;  // Server waiting for requests
+
+    struct Producer {
+        std::atomic<ui32> claimed;
+        SpscQueue completed;
+        FutexEvent completedEvent;
+    } producers[SHM_RING_MAX_PRODUCERS];
+};
+
+// Per-slot bookkeeping in front of the input
+struct ShmSlotHeader {
+    ui32 producer;
+    ui32 status;   // 0 on success, 1 when inference failed
+    ui64 submitNs; // CLOCK_MONOTONIC, comparable across processes
+};
+
+// A mapping of the POSIX shared-memory ring
+class SharedRing {
+   public:
+    // Create (replacing any stale object of that name) and initialize a ring, unlinked again when destroyed
+    static std::unique_ptr<SharedRing> create(const std::string& name, ui32 slots, ui32 inputFloats, ui32 outputFloats);
+
+    // Map a ring created by the server
+    static std::unique_ptr<SharedRing> attach(const std::string& name);
+
+    ~SharedRing();
+
+    SharedRing(const SharedRing&) = delete;
+    SharedRing& operator=(const SharedRing&) = delete;
+
+    inline ShmRingHeader& header() { return *(ShmRingHeader*)base; }
+    inline ShmSlotHeader& slot(ui32 index) { return *(ShmSlotHeader*)slotBase(index); }
+    inline fp32* input(ui32 index) { return (fp32*)(slotBase(index) + INPUT_OFFSET); }
+    inline fp32* output(ui32 index) { return input(index) + header().inputFloats; }
+
+   private:
+    static constexpr std::size_t INPUT_OFFSET = 64;  // Inputs start cache-line aligned after the slot header
+
+    SharedRing(const std::string& name, void* base, std::size_t bytes, bool owner) : name(name), base((char*)base), bytes(bytes), owner(owner) {}
+    inline char* slotBase(ui32 index) { return base + sizeof(ShmRingHeader) + index * header().slotBytes; }
+
+    std::string name;
+    char* base;
+    std::size_t bytes;
+    bool owner;
+};
+
+// Request side of a ring, one per producing thread (claims one of the ring's producer ids)
+class RingProducer {
+   public:
+    explicit RingProducer(SharedRing& ring);
+    ~RingProducer();
+
+    RingProducer(const RingProducer&) = delete;
+    RingProducer& operator=(const RingProducer&) = delete;
+
+    // Take a free slot to write an input into, waiting for one if all are in flight
+    ui32 acquire();
+    inline fp32* input(ui32 slot) { return ring.input(slot); }
+
+    // Hand the written slot to the server
+    void submit(ui32 slot);
+
+    // Next slot of this producer the server finished, its output valid until release()
+    ui32 waitCompleted();
+    inline const fp32* output(ui32 slot) { return ring.output(slot); }
+    inline bool failed(ui32 slot) { return ring.slot(slot).status != 0; }
+
+    void release(ui32 slot);
+
+   private:
+    SharedRing& ring;
+    ui32 id;
+};
+
+// Serves a ring with an allocated model, batching whatever is submitted (up to maxBatch) without waiting for more
+class RingServer {
+   public:
+    RingServer(const Model& model, SharedRing& ring, std::size_t maxBatch, Layer::InfType infType);
+
+    // Serve until stop() (safe to call from a signal handler)
+    void run();
+    inline void stop() { stopping = true; }
+
+    // Requests, batch-size histogram and submit-to-completion latency (once run() has returned)
+    std::string statsReport() const;
+
+   private:
+    const Model& model;
+    SharedRing& ring;
+    std::size_t maxBatch;
+    Layer::InfType infType;
+    std::atomic<bool> stopping{false};
+
+    std::vector<std::unique_ptr<LayerData>> inputs;  // Views of each slot's input, read in place by the first layer
+
+    ui64 requests = 0, batches = 0;
+    std::vector<ui64> batchSizes;
+    LatencyHistogram latencies;
+};
+
+// Closed-loop producers in this process: `clients` threads each submit `requests` copies of an input
+void runRingLoadGenerator(const std::string& name, std::size_t clients, std::size_t requests, const std::string& inputPath);
+
+}  // namespace ML
@@ -0,0 +1,204 @@
+#include "Sparse.h"
+
+#include <cmath>
+#include <stdexcept>
+
+#include "CpuDispatch.h"
+
+#if ML_HAS_ISA_TARGETS
+#    include <immintrin.h>
+#endif
+
+namespace ML {
+
+#if ML_HAS_ISA_TARGETS
+namespace {
+// For every 8 bit nonzero mask, the lane indices of its set bits packed to the front
+struct CompactTable {
+    alignas(32) ui32 lanes[256][8];
+
+    CompactTable() {
+        for (unsigned mask = 0; mask < 256; mask++) {
+            unsigned n = 0;
+            for (unsigned lane = 0; lane < 8; lane++) {
+                if (mask & (1u << lane)) lanes[mask][n++] = lane;
+            }
+            while (n < 8) lanes[mask][n++] = 0;
+        }
+    }
+};
+
+const CompactTable& compactTable() {
+    static const CompactTable table;
+    return table;
+}
+
+// Each compacts the whole vectors of values from `i` on, advancing `i` and the count `n` of indices written
+ML_TARGET_AVX512 void compactAVX512(const fp32* values, std::size_t count, ui32* indices, std::size_t& i, std::size_t& n) {
+    const __m512 zero = _mm512_setzero_ps();
+    __m512i lane = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m512i step = _mm512_set1_epi32(16);
+    for (; i + 16 <= count; i += 16) {
+        const __mmask16 mask = _mm512_cmp_ps_mask(_mm512_loadu_ps(values + i), zero, _CMP_NEQ_UQ);
+        _mm512_mask_compressstoreu_epi32(indices + n, mask, lane);
+        n += __builtin_popcount(mask);
+        lane = _mm512_add_epi32(lane, step);
+    }
+}
+
+ML_TARGET_AVX2 void compactAVX2(const fp32* values, std::size_t count, ui32* indices, std::size_t& i, std::size_t& n) {
+    const CompactTable& table = compactTable();
+    const __m256 zero = _mm256_setzero_ps();
+    for (; i + 8 <= count; i += 8) {
+        const unsigned mask = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(values + i), zero, _CMP_NEQ_UQ));
+        const __m256i packed = _mm256_add_epi32(_mm256_load_si256((const __m256i*)table.lanes[mask]), _mm256_set1_epi32(int(i)));
+        // Full 8 lane store, the unused tail is overwritten by the next group (indices has room for count entries)
+        if (n + 8 <= count) {
+            _mm256_storeu_si256((__m256i*)(indices + n), packed);
+        } else {
+            alignas(32) ui32 tmp[8];
+            _mm256_store_si256((__m256i*)tmp, packed);
+            for (int lane = 0; lane < __builtin_popcount(mask); lane++) indices[n + lane] = tmp[lane];
+        }
+        n += __builtin_popcount(mask);
+    }
+}
+}  // namespace
+#endif
+
+std::size_t compactNonzero(const fp32* values, std::size_t count, ui32* indices) {
+    std::size_t i = 0, n = 0;
+
+#if ML_HAS_ISA_TARGETS
+    switch (getIsa()) {
+    case Isa::AVX512: compactAVX512(values, count, indices, i, n); break;
+    case Isa::AVX2: compactAVX2(values, count, indices, i, n); break;
+    default: break;
+    }
+#endif
+
+    // Branchless: always write, only advance past nonzeros
+    for (; i < count; i++) {
+        indices[n] = ui32(i);
+        n += values[i] != 0.0f;
+    }
+    return n;
+}
+
+BlockShape BlockShape::parse(const std::string& text) {
+    BlockShape shape;
+    const std::size_t x = text.find('x');
+    try {
+        if (x == std::string::npos) throw std::invalid_argument(text);
+        shape.rows = std::stoul(text.substr(0, x));
+        shape.cols = std::stoul(text.substr(x + 1));
+    } catch (const std::logic_error&) {
+        throw std::runtime_error("Block shape `" + text + "` is not ROWSxCOLS");
+    }
+    if (shape.rows == 0 || shape.cols == 0 || shape.rows > MAX_ROWS) {
+        throw std::runtime_error("Block shape `" + text + "` needs 1 to " + std::to_string(MAX_ROWS) + " rows and at least one column");
+    }
+    return shape;
+}
+
+namespace {
+// Calls f(blockIndex, k, m) for every element, blocks numbered row-major over the block grid
+template <typename F> void forEachBlockElement(std::size_t rows, std::size_t cols, const BlockShape& block, F f) {
+    const std::size_t blockCols = (cols + block.cols - 1) / block.cols;
+    for (std::size_t k = 0; k < rows; k++) {
+        for (std::size_t m = 0; m < cols; m++) f((k / block.rows) * blockCols + m / block.cols, k, m);
+    }
+}
+
+inline std::size_t blockCount(std::size_t rows, std::size_t cols, const BlockShape& block) {
+    return ((rows + block.rows - 1) / block.rows) * ((cols + block.cols - 1) / block.cols);
+}
+}  // namespace
+
+float blockDensity(const fp32* weights, std::size_t rows, std::size_t cols, const BlockShape& block) {
+    std::vector<bool> nonzero(blockCount(rows, cols, block), false);
+    forEachBlockElement(rows, cols, block, [&](std::size_t b, std::size_t k, std::size_t m) {
+        if (weights[k * cols + m] != 0.0f) nonzero[b] = true;
+    });
+    return float(std::count(nonzero.begin(), nonzero.end(), true)) / nonzero.size();
+}
+
+float pruneBlocks(fp32* weights, std::size_t rows, std::size_t cols, const BlockShape& block, float sparsity) {
+    std::vector<double> norms(blockCount(rows, cols, block), 0.0);
+    forEachBlockElement(rows, cols, block, [&](std::size_t b, std::size_t k, std::size_t m) {
+        norms[b] += double(weights[k * cols + m]) * weights[k * cols + m];
+    });
+
+    // Blocks at or below the norm of the `sparsity` quantile are zeroed
+    const std::size_t zeroed = std::min(norms.size(), std::size_t(std::ceil(sparsity * norms.size())));
+    if (zeroed > 0) {
+        std::vector<double> sorted = norms;
+        std::nth_element(sorted.begin(), sorted.begin() + (zeroed - 1), sorted.end());
+        const double cutoff = sorted[zeroed - 1];
+        std::size_t budget = zeroed;  // Ties at the cutoff only zero as many blocks as asked for
+        std::vector<bool> drop(norms.size(), false);
+        for (std::size_t b = 0; b < norms.size() && budget; b++) {
+            if (norms[b] < cutoff) drop[b] = true, budget--;
+        }
+        for (std::size_t b = 0; b < norms.size() && budget; b++) {
+            if (norms[b] == cutoff) drop[b] = true, budget--;
+        }
+        forEachBlockElement(rows, cols, block, [&](std::size_t b, std::size_t k, std::size_t m) {
+            if (drop[b]) weights[k * cols + m] = 0.0f;
+        });
+    }
+    return blockDensity(weights, rows, cols, block);
+}
+
+void BlockSparseWeights::load(const fp32* weights, std::size_t rowCount, std::size_t colCount, const BlockShape& shape) {
+    block = shape;
+    rows = rowCount;
+    cols = colCount;
+    const std::size_t blockRows = (rows + block.rows - 1) / block.rows;
+    const std::size_t blockCols = (cols + block.cols - 1) / block.cols;
+    paddedCols = blockCols * block.cols;
+
+    clear();
+    rowStart.reserve(blockRows + 1);
+    for (std::size_t kb = 0; kb < blockRows; kb++) {
+        rowStart.push_back(ui32(blockCol.size()));
+        const std::size_t kn = std::min(block.rows, rows - kb * block.rows);
+        for (std::size_t mb = 0; mb < blockCols; mb++) {
+            const std::size_t mn = std::min(block.cols, cols - mb * block.cols);
+            bool nonzero = false;
+            for (std::size_t kk = 0; kk < kn && !nonzero; kk++) {
+                const fp32* row = weights + (kb * block.rows + kk) * cols + mb * block.cols;
+                for (std::size_t mm = 0; mm < mn; mm++) nonzero |= row[mm] != 0.0f;
+            }
+            if (!nonzero) continue;
+
+            blockCol.push_back(ui32(mb));
+            const std::size_t offset = values.size();
+            values.resize(offset + block.rows * block.cols, 0.0f);
+            for (std::size_t kk = 0; kk < kn; kk++) {
+                const fp32* row = weights + (kb * block.rows + kk) * cols + mb * block.cols;
+                std::copy(row, row + mn, values.begin() + offset + kk * block.cols);
+            }
+        }
+    }
+    rowStart.push_back(ui32(blockCol.size()));
+}
+
+void BlockSparseWeights::clear() {
+    rowStart.clear();
+    rowStart.shrink_to_fit();
+    blockCol.clear();
+    blockCol.shrink_to_fit();
+    values.clear();
+    values.shrink_to_fit();
+}
+
+const char* compactKernelName() {
+    switch (getIsa()) {
+    case Isa::AVX512: return "avx512 compress";
+    case Isa::AVX2: return "avx2 permute";
+    default: return "scalar";
+    }
+}
+
+}  // namespace ML
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Config.h"
+#include "CpuDispatch.h"
+#include "Types.h"
+
+namespace ML {
+
+// Write the indices of the nonzero values to `indices` (room for `count` entries) and return how many there are
+// Uses an AVX-512 compress store or an AVX2 permute from a lookup table when the AVX512 / AVX2 tier is active
+std::size_t compactNonzero(const fp32* values, std::size_t count, ui32* indices);
+
+// Name of the compaction kernel of the active instruction set
+const char* compactKernelName();
+
+// y[0..n) += a * x[0..n)
+ML_ISA_INLINE void axpy(fp32* y, fp32 a, const fp32* x, std::size_t n) {
+    for (std::size_t i = 0; i < n; i++) y[i] += a * x[i];
+}
+
+// y[0..n) += a0 * x0 + a1 * x1 + a2 * x2 + a3 * x3, one pass over y for four rows
+ML_ISA_INLINE void axpy4(fp32* y, const fp32 a[4], const fp32* x0, const fp32* x1, const fp32* x2, const fp32* x3, std::size_t n) {
+    for (std::size_t i = 0; i < n; i++) y[i] += a[0] * x0[i] + a[1] * x1[i] + a[2] * x2[i] + a[3] * x3[i];
+}
+
+// Block shape of structured pruning and block-sparse weights (rows x cols of a [K][M] weight matrix)
+struct BlockShape {
+    static constexpr std::size_t MAX_ROWS = 16;
+
+    std::size_t rows = Config::SPARSE_BLOCK_ROWS;
+    std::size_t cols = Config::SPARSE_BLOCK_COLS;
+
+    std::string str() const { return std::to_string(rows) + "x" + std::to_string(cols); }
+
+    // "4x16", throws on malformed shapes and more than MAX_ROWS rows
+    static BlockShape parse(const std::string& text);
+};
+
+// Fraction of the blocks of a [rows][cols] matrix holding a nonzero element (partial edge blocks count as blocks)
+float blockDensity(const fp32* weights, std::size_t rows, std::size_t cols, const BlockShape& block);
+
+// Zero the blocks with the smallest L2 norm until `sparsity` of all blocks are zero, returns the resulting density
+float pruneBlocks(fp32* weights, std::size_t rows, std::size_t cols, const BlockShape& block, float sparsity);
+
+// A [K][M] weight matrix kept in block-CSR form: only blocks with a nonzero element are stored, grouped by block row
+// Memory and multiply time scale with the number of stored blocks
+struct BlockSparseWeights {
+    BlockShape block;
+    std::size_t rows = 0, cols = 0;  // K, M of the dense matrix
+    std::size_t paddedCols = 0;      // M rounded up to whole blocks, the length multiplyAdd accumulates into
+    std::vector<ui32> rowStart;      // First stored block of each block row, plus the total at the end
+    std::vector<ui32> blockCol;      // Column block of each stored block
+    std::vector<fp32> values;        // Stored blocks, [block.rows][block.cols] each, edge blocks zero padded
+
+    void load(const fp32* weights, std::size_t rows, std::size_t cols, const BlockShape& block);
+    void clear();
+
+    inline bool empty() const { return rowStart.empty(); }
+    inline std::size_t storedBlocks() const { return blockCol.size(); }
+    inline std::size_t bytes() const {
+        return values.size() * sizeof(fp32) + blockCol.size() * sizeof(ui32) + rowStart.size() * sizeof(ui32);
+    }
+
+    // y[0..paddedCols) += sum over k of x(k) * W[k][0..M), x(k) read once per k
+    // Block rows without stored blocks, or whose inputs are all zero, are skipped
+    template <typename X> ML_ISA_INLINE void multiplyAdd(const X& x, fp32* y) const {
+        const std::size_t blockRows = rowStart.size() - 1;
+        const std::size_t blockSize = block.rows * block.cols;
+        fp32 xs[BlockShape::MAX_ROWS];
+        for (std::size_t kb = 0; kb < blockRows; kb++) {
+            if (rowStart[kb] == rowStart[kb + 1]) continue;
+
+            const std::size_t k0 = kb * block.rows;
+            const std::size_t kn = std::min(block.rows, rows - k0);
+            bool any = false;
+            for (std::size_t kk = 0; kk < kn; kk++) {
+                xs[kk] = x(k0 + kk);
+                any |= xs[kk] != 0.0f;
+            }
+            if (!any) continue;
+
+            for (ui32 b = rowStart[kb]; b < rowStart[kb + 1]; b++) {
+                fp32* yb = y + blockCol[b] * block.cols;
+                const fp32* v = values.data() + b * blockSize;
+                for (std::size_t kk = 0; kk < kn; kk++) axpy(yb, xs[kk], v + kk * block.cols, block.cols);
+            }
+        }
+    }
+};
+
+}  // namespace ML
@@ -0,0 +1,104 @@
+#include "StaticModel.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include "Validation.h"
+#include "layers/Layer.h"
+
+namespace ML {
+
+namespace {
+const char* const LAYER_NAMES[StaticAudioCNN::LAYERS] = {"conv1_1", "conv1_2", "pool1", "conv2_1", "conv2_2", "pool2", "conv3_1",
+                                                         "conv3_2", "pool3",   "flatten", "fc1",     "fc2",   "softmax"};
+
+// Weight and bias counts of each layer, zero for the layers without
+struct LayerShape {
+    std::size_t weights, biases, outputs;
+};
+const LayerShape SHAPES[StaticAudioCNN::LAYERS] = {
+    {StaticAudioCNN::Conv1_1::WEIGHTS, StaticAudioCNN::Conv1_1::BIASES, StaticAudioCNN::Conv1_1::OUTPUTS},
+    {StaticAudioCNN::Conv1_2::WEIGHTS, StaticAudioCNN::Conv1_2::BIASES, StaticAudioCNN::Conv1_2::OUTPUTS},
+    {0, 0, StaticAudioCNN::Pool1::OUTPUTS},
+    {StaticAudioCNN::Conv2_1::WEIGHTS, StaticAudioCNN::Conv2_1::BIASES, StaticAudioCNN::Conv2_1::OUTPUTS},
+    {StaticAudioCNN::Conv2_2::WEIGHTS, StaticAudioCNN::Conv2_2::BIASES, StaticAudioCNN::Conv2_2::OUTPUTS},
+    {0, 0, StaticAudioCNN::Pool2::OUTPUTS},
+    {StaticAudioCNN::Conv3_1::WEIGHTS, StaticAudioCNN::Conv3_1::BIASES, StaticAudioCNN::Conv3_1::OUTPUTS},
+    {StaticAudioCNN::Conv3_2::WEIGHTS, StaticAudioCNN::Conv3_2::BIASES, StaticAudioCNN::Conv3_2::OUTPUTS},
+    {0, 0, StaticAudioCNN::Pool3::OUTPUTS},
+    {0, 0, 0},  // Flatten: pool3's output
+    {StaticAudioCNN::Fc1::WEIGHTS, StaticAudioCNN::Fc1::BIASES, StaticAudioCNN::Fc1::OUTPUTS},
+    {StaticAudioCNN::Fc2::WEIGHTS, StaticAudioCNN::Fc2::BIASES, StaticAudioCNN::Fc2::OUTPUTS},
+    {0, 0, StaticAudioCNN::Output::OUTPUTS},
+};
+constexpr std::size_t FLATTEN = 9;
+
+// Copy `count` floats from `path` into an aligned buffer, through LayerData so the board reads them from the SD card
+void loadBuffer(const Path& path, std::size_t count, Static::Buffer& buffer) {
+    if (fileSize(path) != (long long)(count * sizeof(fp32))) {
+        throw std::runtime_error("Static model expects " + std::to_string(count) + " floats in " + path + " (the trained shapes)");
+    }
+    LayerData data({sizeof(fp32), {count}, path});
+    data.loadData();
+    buffer.alloc(count);
+    std::memcpy(buffer.get(), data.raw(), count * sizeof(fp32));
+}
+}  // namespace
+
+void StaticAudioCNN::load(const Path& modelPath) {
+    for (std::size_t i = 0; i < LAYERS; i++) {
+        if (SHAPES[i].weights) {
+            loadBuffer(modelPath / (std::string(LAYER_NAMES[i]) + "_weights.bin"), SHAPES[i].weights, weights[i]);
+            loadBuffer(modelPath / (std::string(LAYER_NAMES[i]) + "_bias.bin"), SHAPES[i].biases, biases[i]);
+        }
+        if (SHAPES[i].outputs) outputs[i].alloc(SHAPES[i].outputs);
+    }
+}
+
+void StaticAudioCNN::free() {
+    for (std::size_t i = 0; i < LAYERS; i++) {
+        weights[i].free();
+        biases[i].free();
+        outputs[i].free();
+    }
+}
+
+void StaticAudioCNN::inferenceLayer(const fp32* input, std::size_t layerNum) const {
+    const fp32* in = layerNum == 0 ? input : getOutput(layerNum - 1);
+    const fp32* w = weights[layerNum].get();
+    const fp32* b = biases[layerNum].get();
+    fp32* out = outputs[layerNum].get();
+    switch (layerNum) {
+    case 0: Conv1_1::run(in, w, b, out); break;
+    case 1: Conv1_2::run(in, w, b, out); break;
+    case 2: Pool1::run(in, out); break;
+    case 3: Conv2_1::run(in, w, b, out); break;
+    case 4: Conv2_2::run(in, w, b, out); break;
+    case 5: Pool2::run(in, out); break;
+    case 6: Conv3_1::run(in, w, b, out); break;
+    case 7: Conv3_2::run(in, w, b, out); break;
+    case 8: Pool3::run(in, out); break;
+    case FLATTEN: break;
+    case 10: Fc1::run(in, w, b, out); break;
+    case 11: Fc2::run(in, w, b, out); break;
+    case 12: Output::run(in, out); break;
+    default: throw std::runtime_error("Static model has no layer " + std::to_string(layerNum));
+    }
+}
+
+const fp32* StaticAudioCNN::inference(const fp32* input) const {
+    for (std::size_t i = 0; i < LAYERS; i++) inferenceLayer(input, i);
+    return getOutput(LAYERS - 1);
+}
+
+const char* StaticAudioCNN::layerName(std::size_t layerNum) { return LAYER_NAMES[layerNum]; }
+
+const fp32* StaticAudioCNN::getOutput(std::size_t layerNum) const {
+    return layerNum == FLATTEN ? outputs[FLATTEN - 1].get() : outputs[layerNum].get();
+}
+
+std::size_t StaticAudioCNN::getOutputCount(std::size_t layerNum) const {
+    return SHAPES[layerNum == FLATTEN ? FLATTEN - 1 : layerNum].outputs;
+}
+
+}  // namespace ML
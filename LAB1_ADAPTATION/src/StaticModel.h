@@ -0,0 +1,213 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#include "Config.h"
+#include "Types.h"
+#include "Utils.h"
+
+namespace ML {
+
+// Compile-time specialized kernels: every dimension is a template parameter, so filter taps are unrolled, channel
+// loops have constant trip counts and strides, and buffers are known to be cache-line aligned. The dynamic Model reads
+// the same shapes from LayerParams::dims at runtime; these run the fixed AudioCNN_IRMAS topology only
+namespace Static {
+
+// f(integral_constant<0>) ... f(integral_constant<N-1>), each call with its index as a constant
+template <std::size_t N> struct Unroll {
+    template <typename F> static inline void run(F& f) {
+        Unroll<N - 1>::run(f);
+        f(std::integral_constant<std::size_t, N - 1>());
+    }
+};
+template <> struct Unroll<0> {
+    template <typename F> static inline void run(F&) {}
+};
+
+constexpr std::size_t ALIGNMENT = Config::CACHE_LINE_SIZE;
+
+template <typename T> inline T* aligned(T* p) { return (T*)__builtin_assume_aligned(p, ALIGNMENT); }
+
+// Valid convolution of an [H][W][C] input with [R][S][C][M] weights, bias and ReLU, input stationary: each nonzero
+// input is read once and scattered into the R*S unrolled output vectors it contributes to (taps falling outside the
+// output compile to a pair of compares), over the R output rows still open. A row gets its bias when the first input
+// row reaching it is read and its ReLU when the last one is done
+template <std::size_t H, std::size_t W, std::size_t C, std::size_t R, std::size_t S, std::size_t M> struct Conv {
+    static constexpr std::size_t P = H - R + 1, Q = W - S + 1;
+    static constexpr std::size_t INPUTS = H * W * C, OUTPUTS = P * Q * M, WEIGHTS = R * S * C * M, BIASES = M;
+
+    struct Scatter {
+        std::size_t h, w;
+        fp32 x;
+        const fp32* taps;  // w[0][0][c]
+        fp32* output;
+
+        template <std::size_t K> inline void operator()(std::integral_constant<std::size_t, K>) const {
+            constexpr std::size_t r = K / S, s = K % S;
+            if (h < r || h - r >= P || w < s || w - s >= Q) return;
+            fp32* out = aligned(output + ((h - r) * Q + w - s) * M);
+            const fp32* row = aligned(taps + K * C * M);
+            for (std::size_t m = 0; m < M; m++) out[m] += x * row[m];
+        }
+    };
+
+    static void run(const fp32* input, const fp32* weights, const fp32* bias, fp32* output) {
+        weights = aligned(weights);
+        output = aligned(output);
+        for (std::size_t h = 0; h < H; h++) {
+            if (h < P) {
+                for (std::size_t q = 0; q < Q; q++) std::copy(bias, bias + M, output + (h * Q + q) * M);
+            }
+            for (std::size_t w = 0; w < W; w++) {
+                const fp32* x = input + (h * W + w) * C;
+                for (std::size_t c = 0; c < C; c++) {
+                    if (x[c] == 0.0f) continue;  // Most inputs after ReLU
+                    Scatter scatter{h, w, x[c], weights + c * M, output};
+                    Unroll<R * S>::run(scatter);
+                }
+            }
+            if (h + 1 >= R) {
+                fp32* row = output + (h + 1 - R) * Q * M;
+                for (std::size_t i = 0; i < Q * M; i++) row[i] = row[i] > 0.0f ? row[i] : 0.0f;
+            }
+        }
+    }
+};
+
+// K x K max pooling with stride K of an [H][W][C] input, channels innermost (maxima compared by value: std::max
+// returns a reference to one of its operands, which keeps the loop from vectorizing)
+template <std::size_t H, std::size_t W, std::size_t C, std::size_t K> struct MaxPool {
+    static constexpr std::size_t P = H / K, Q = W / K;
+    static constexpr std::size_t INPUTS = H * W * C, OUTPUTS = P * Q * C;
+
+    struct Window {
+        const fp32* x;  // Window corner
+        fp32* acc;
+
+        template <std::size_t T> inline void operator()(std::integral_constant<std::size_t, T>) const {
+            const fp32* in = x + ((T / K) * W + T % K) * C;
+            for (std::size_t c = 0; c < C; c++) acc[c] = in[c] > acc[c] ? in[c] : acc[c];
+        }
+    };
+
+    static void run(const fp32* input, fp32* output) {
+        output = aligned(output);
+        for (std::size_t p = 0; p < P; p++) {
+            for (std::size_t q = 0; q < Q; q++) {
+                // Maxima in a local array so the compiler need not assume it aliases the input
+                alignas(ALIGNMENT) fp32 acc[C];
+                const fp32* x = input + (p * K * W + q * K) * C;
+                std::copy(x, x + C, acc);
+                Window window{x, acc};
+                Unroll<K * K>::run(window);
+                std::copy(acc, acc + C, output + (p * Q + q) * C);
+            }
+        }
+    }
+};
+
+// [K] x [K][M] GEMV with bias (and ReLU for hidden layers): the M sums stay in registers while each nonzero input
+// sweeps its contiguous weight row
+template <std::size_t K, std::size_t M, bool Relu> struct Dense {
+    static constexpr std::size_t INPUTS = K, OUTPUTS = M, WEIGHTS = K * M, BIASES = M;
+
+    static void run(const fp32* input, const fp32* weights, const fp32* bias, fp32* output) {
+        weights = aligned(weights);
+        output = aligned(output);
+        alignas(ALIGNMENT) fp32 acc[M];
+        for (std::size_t m = 0; m < M; m++) acc[m] = bias[m];
+        for (std::size_t k = 0; k < K; k++) {
+            const fp32 x = input[k];
+            if (x == 0.0f) continue;
+            const fp32* row = weights + k * M;
+            for (std::size_t m = 0; m < M; m++) acc[m] += x * row[m];
+        }
+        for (std::size_t m = 0; m < M; m++) output[m] = Relu && !(acc[m] > 0.0f) ? 0.0f : acc[m];
+    }
+};
+
+template <std::size_t N> struct Softmax {
+    static constexpr std::size_t INPUTS = N, OUTPUTS = N;
+
+    static void run(const fp32* input, fp32* output) {
+        fp32 maxVal = input[0];
+        for (std::size_t i = 1; i < N; i++) maxVal = std::max(maxVal, input[i]);
+        fp32 sum = 0.0f;
+        for (std::size_t i = 0; i < N; i++) sum += output[i] = std::exp(input[i] - maxVal);
+        for (std::size_t i = 0; i < N; i++) output[i] /= sum;
+    }
+};
+
+// Cache-line aligned fp32 array
+class Buffer {
+   public:
+    void alloc(std::size_t count) {
+        storage.reset(new fp32[count + ALIGNMENT / sizeof(fp32)]);
+        data = (fp32*)((std::uintptr_t(storage.get()) + ALIGNMENT - 1) & ~std::uintptr_t(ALIGNMENT - 1));
+        size = count;
+    }
+    void free() {
+        storage.reset();
+        data = nullptr;
+        size = 0;
+    }
+
+    fp32* get() const { return data; }
+    std::size_t count() const { return size; }
+
+   private:
+    std::unique_ptr<fp32[]> storage;
+    fp32* data = nullptr;
+    std::size_t size = 0;
+};
+
+}  // namespace Static
+
+// AudioCNN_IRMAS with every layer shape fixed at compile time, the counterpart of buildAudioCNN_IRMAS's 13 fp32
+// layers (the trained channel counts, so not for weights written by `ml shrink`). Layer outputs, numbered as in the
+// dynamic model, are kept in their own buffers; flatten is a view of pool3
+class StaticAudioCNN {
+   public:
+    using Conv1_1 = Static::Conv<128, 128, 1, 5, 5, 32>;
+    using Conv1_2 = Static::Conv<124, 124, 32, 5, 5, 32>;
+    using Pool1 = Static::MaxPool<120, 120, 32, 2>;
+    using Conv2_1 = Static::Conv<60, 60, 32, 3, 3, 64>;
+    using Conv2_2 = Static::Conv<58, 58, 64, 3, 3, 64>;
+    using Pool2 = Static::MaxPool<56, 56, 64, 2>;
+    using Conv3_1 = Static::Conv<28, 28, 64, 3, 3, 64>;
+    using Conv3_2 = Static::Conv<26, 26, 64, 3, 3, 128>;
+    using Pool3 = Static::MaxPool<24, 24, 128, 2>;
+    using Fc1 = Static::Dense<Pool3::OUTPUTS, 256, true>;
+    using Fc2 = Static::Dense<256, 10, false>;
+    using Output = Static::Softmax<10>;
+
+    static constexpr std::size_t LAYERS = 13;
+    static constexpr std::size_t INPUTS = Conv1_1::INPUTS;
+
+    // Read the weights from `modelPath` (throws when a file does not have the trained size)
+    void load(const Path& modelPath);
+    void free();
+
+    // Run layer `layerNum` on the output of the previous one (`input` for layer 0)
+    void inferenceLayer(const fp32* input, std::size_t layerNum) const;
+
+    // Run every layer, returns the softmax probabilities
+    const fp32* inference(const fp32* input) const;
+
+    static const char* layerName(std::size_t layerNum);
+    const fp32* getOutput(std::size_t layerNum) const;
+    std::size_t getOutputCount(std::size_t layerNum) const;
+
+   private:
+    // Weights and bias of the Conv/Dense layers, indexed by layer number (empty for the others)
+    Static::Buffer weights[LAYERS], biases[LAYERS];
+    mutable Static::Buffer outputs[LAYERS];
+};
+
+}  // namespace ML
@@ -0,0 +1,124 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <exception>
+#include <memory>
+
+#if defined(__linux__) && !defined(ZEDBOARD)
+#    include <sys/syscall.h>
+#    include <unistd.h>
+#    define HAVE_GETTID
+#endif
+
+#include "Trace.h"
+
+namespace ML {
+
+ThreadPool::ThreadPool(std::size_t numThreads) : stopping(false) {
+    // The calling thread always runs one tile itself
+    for (std::size_t i = 1; i < numThreads; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+#ifdef HAVE_GETTID
+    // Every worker has published its thread id once the pool is constructed
+    std::unique_lock<std::mutex> lock(mutex);
+    workerStarted.wait(lock, [this] { return workerIds.size() == workers.size(); });
+#endif
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    taskReady.notify_all();
+    for (std::thread& worker : workers) worker.join();
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    return pool;
+}
+
+void ThreadPool::workerLoop() {
+#ifdef HAVE_GETTID
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        workerIds.push_back(syscall(SYS_gettid));
+    }
+    workerStarted.notify_one();
+#endif
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            taskReady.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) return;
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
+
+void ThreadPool::parallelFor(std::size_t begin, std::size_t end, const std::function<void(std::size_t, std::size_t)>& body) {
+    if (end <= begin) return;
+
+    const TraceContext trace = Tracer::context();
+    const std::size_t count = end - begin;
+    const std::size_t numTiles = std::min(size(), count);
+    const std::size_t tileSize = (count + numTiles - 1) / numTiles;
+
+    // Completion barrier for this call only, so independent callers can share the pool. Shared with the tasks so the
+    // last one can still notify after the caller has returned; the first exception of any tile is kept for the caller
+    struct Completion {
+        std::mutex mutex;
+        std::condition_variable done;
+        std::size_t remaining;
+        std::exception_ptr error;
+    };
+    const std::shared_ptr<Completion> completion = std::make_shared<Completion>();
+    completion->remaining = numTiles - 1;
+
+    auto runTile = [&](std::size_t tileBegin, std::size_t tileEnd) {
+        TraceTileScope scope(trace, tileBegin, tileEnd);
+        body(tileBegin, tileEnd);
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (std::size_t t = 1; t < numTiles; t++) {
+            const std::size_t tileBegin = begin + t * tileSize;
+            const std::size_t tileEnd = std::min(end, tileBegin + tileSize);
+            tasks.push([&runTile, completion, tileBegin, tileEnd] {
+                std::exception_ptr error;
+                try {
+                    if (tileBegin < tileEnd) runTile(tileBegin, tileEnd);
+                } catch (...) {
+                    error = std::current_exception();
+                }
+                std::lock_guard<std::mutex> doneLock(completion->mutex);
+                if (error && !completion->error) completion->error = error;
+                if (--completion->remaining == 0) completion->done.notify_one();
+            });
+        }
+    }
+    taskReady.notify_all();
+
+    // First tile runs on the calling thread. The queued tiles reference this frame, so even when it throws every one
+    // of them is waited for before the first exception is rethrown
+    std::exception_ptr error;
+    try {
+        runTile(begin, std::min(end, begin + tileSize));
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    std::unique_lock<std::mutex> lock(completion->mutex);
+    completion->done.wait(lock, [&] { return completion->remaining == 0; });
+    if (!error) error = completion->error;
+    lock.unlock();
+    if (error) std::rethrow_exception(error);
+}
+
+}  // namespace ML
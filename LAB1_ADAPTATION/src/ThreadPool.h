@@ -0,0 +1,51 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "Types.h"
+
+namespace ML {
+
+// Fixed set of persistent worker threads shared by all threaded kernels
+class ThreadPool {
+   public:
+    explicit ThreadPool(std::size_t numThreads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Number of threads work is split across (workers plus the calling thread)
+    inline std::size_t size() const { return workers.size() + 1; }
+
+    // Split [begin, end) into one contiguous tile per thread and block until every tile has run
+    // body(tileBegin, tileEnd) must be safe to call concurrently on disjoint ranges
+    // Tiles are reported to the tracer of the layer currently traced on the calling thread
+    // An exception thrown by any tile is rethrown on the calling thread once all tiles have finished
+    void parallelFor(std::size_t begin, std::size_t end, const std::function<void(std::size_t, std::size_t)>& body);
+
+    // Kernel thread ids of the workers (Linux only, empty elsewhere), e.g. to open per-thread perf counters on them
+    inline const std::vector<long>& workerThreadIds() const { return workerIds; }
+
+    // Process-wide pool sized to the hardware
+    static ThreadPool& shared();
+
+   private:
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::vector<long> workerIds;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable taskReady;
+    std::condition_variable workerStarted;
+    bool stopping;
+};
+
+}  // namespace ML
@@ -0,0 +1,256 @@
+#include "Tiling.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+#include "Config.h"
+#include "CpuDispatch.h"
+#include "Packing.h"
+#include "Sparse.h"
+
+namespace ML {
+
+TileShape TileShape::conv(const std::vector<std::size_t>& inDims, const std::vector<std::size_t>& weightDims, std::size_t elementSize) {
+    if (inDims.size() != 3 || weightDims.size() != 4) throw std::runtime_error("Conv tiling expects [H][W][C] inputs and [R][S][C][M] weights");
+    TileShape shape;
+    shape.H = inDims[0];
+    shape.W = inDims[1];
+    shape.C = inDims[2];
+    shape.R = weightDims[0];
+    shape.S = weightDims[1];
+    shape.M = weightDims[3];
+    shape.P = shape.H - shape.R + 1;
+    shape.Q = shape.W - shape.S + 1;
+    shape.elementSize = elementSize;
+    return shape;
+}
+
+TileShape TileShape::dense(std::size_t inputs, std::size_t outputs, std::size_t elementSize) {
+    TileShape shape;
+    shape.C = inputs;
+    shape.M = outputs;
+    shape.elementSize = elementSize;
+    return shape;
+}
+
+TileTraffic& TileTraffic::operator+=(const TileTraffic& other) {
+    input += other.input;
+    weights += other.weights;
+    output += other.output;
+    return *this;
+}
+
+void TileTrafficCounter::store(const TileTraffic& traffic) {
+    input.store(traffic.input, std::memory_order_relaxed);
+    weights.store(traffic.weights, std::memory_order_relaxed);
+    output.store(traffic.output, std::memory_order_relaxed);
+}
+
+TileTraffic TileTrafficCounter::load() const {
+    TileTraffic traffic;
+    traffic.input = input.load(std::memory_order_relaxed);
+    traffic.weights = weights.load(std::memory_order_relaxed);
+    traffic.output = output.load(std::memory_order_relaxed);
+    return traffic;
+}
+
+std::string TilePlan::str() const {
+    std::ostringstream out;
+    out << rows << "x" << channels << "x" << inChannels << " (rows x out x in), " << tiles.size() << " tiles, " << footprint() << " B";
+    return out.str();
+}
+
+namespace {
+inline std::size_t ceilDiv(std::size_t a, std::size_t b) { return (a + b - 1) / b; }
+
+// Closed form of the traffic of walking the tiles with TilePlan's reuse rule: the input slab is kept across the output
+// channel tiles only when the input channels are not split, the weights across row tiles only when nothing else is
+TileTraffic predictTraffic(const TileShape& shape, std::size_t rows, std::size_t channels, std::size_t inChannels) {
+    const std::size_t tilesP = ceilDiv(shape.P, rows), tilesM = ceilDiv(shape.M, channels), tilesC = ceilDiv(shape.C, inChannels);
+    const ui64 slabRows = shape.P + tilesP * (shape.R - 1);  // Halo rows loaded by every row tile
+    TileTraffic traffic;
+    traffic.input = (tilesC == 1 ? 1 : tilesM) * slabRows * shape.W * shape.C * shape.elementSize;
+    traffic.weights = (tilesM == 1 && tilesC == 1 ? 1 : tilesP) * ui64(shape.R) * shape.S * shape.C * shape.M * shape.elementSize;
+    traffic.output = ui64(shape.P) * shape.Q * shape.M * shape.elementSize;
+    return traffic;
+}
+}  // namespace
+
+TilePlan planTiles(const TileShape& shape, std::size_t budget, const TileConstraints& constraints) {
+    const std::size_t e = shape.elementSize;
+    const std::size_t step = std::max<std::size_t>(constraints.channelMultiple, 1);
+
+    // Output channel tiles in multiples of the step, input channel tiles in multiples of 8 or all of them
+    std::vector<std::size_t> channelSizes, inChannelSizes;
+    for (std::size_t m = step; m < shape.M; m += step) channelSizes.push_back(m);
+    channelSizes.push_back(shape.M);
+    if (constraints.splitInputChannels) {
+        for (std::size_t c = 8; c < shape.C; c += 8) inChannelSizes.push_back(c);
+    }
+    inChannelSizes.push_back(shape.C);
+
+    TilePlan plan;
+    plan.shape = shape;
+    plan.budget = budget;
+    ui64 bestTraffic = std::numeric_limits<ui64>::max(), bestTiles = 0;
+    for (std::size_t rows = 1; rows <= shape.P; rows++) {
+        for (std::size_t channels : channelSizes) {
+            const std::size_t outputBytes = rows * shape.Q * channels * sizeof(i32);
+            for (std::size_t inChannels : inChannelSizes) {
+                const std::size_t inputBytes = (rows + shape.R - 1) * shape.W * inChannels * e;
+                const std::size_t weightBytes = shape.R * shape.S * inChannels * channels * e;
+                if (2 * (inputBytes + weightBytes) + outputBytes > budget) break;  // Sizes ascend
+
+                const ui64 traffic = predictTraffic(shape, rows, channels, inChannels).total();
+                const ui64 tiles = ui64(ceilDiv(shape.P, rows)) * ceilDiv(shape.M, channels) * ceilDiv(shape.C, inChannels);
+                if (traffic < bestTraffic || (traffic == bestTraffic && tiles < bestTiles)) {
+                    bestTraffic = traffic;
+                    bestTiles = tiles;
+                    plan.rows = rows;
+                    plan.channels = channels;
+                    plan.inChannels = inChannels;
+                    plan.inputTileBytes = inputBytes;
+                    plan.weightTileBytes = weightBytes;
+                    plan.outputTileBytes = outputBytes;
+                }
+            }
+        }
+    }
+    if (plan.rows == 0) throw std::runtime_error("Tile budget of " + std::to_string(budget) + " B does not fit a single output");
+
+    for (std::size_t p0 = 0; p0 < shape.P; p0 += plan.rows) {
+        for (std::size_t m0 = 0; m0 < shape.M; m0 += plan.channels) {
+            for (std::size_t c0 = 0; c0 < shape.C; c0 += plan.inChannels) {
+                plan.tiles.push_back({p0, std::min(plan.rows, shape.P - p0), m0, std::min(plan.channels, shape.M - m0), c0,
+                                      std::min(plan.inChannels, shape.C - c0)});
+            }
+        }
+    }
+    plan.predicted = predictTraffic(shape, plan.rows, plan.channels, plan.inChannels);
+    return plan;
+}
+
+namespace {
+std::size_t tileBudget = Config::TILE_BUDGET_BYTES;
+
+// Accumulate one tile's input channels into its [rows][Q][channels] partial sums: per output pixel, an axpy of each
+// contiguous [channels] weight row scaled by its input, vectorized across the tile's output channels. Zero inputs
+// (most of them after ReLU) are skipped, the others applied four rows per pass over the sums
+struct TileCompute {
+    const Tile& tile;
+    const fp32* slab;
+    const fp32* w;
+    std::size_t W, Q, R, S;
+    fp32* sums;
+
+    ML_ISA_INLINE void operator()() const {
+        const std::size_t Tc = tile.inChannels, Tm = tile.channels;
+        for (std::size_t pp = 0; pp < tile.rows; pp++) {
+            for (std::size_t q = 0; q < Q; q++) {
+                fp32* out = sums + (pp * Q + q) * Tm;
+                for (std::size_t r = 0; r < R; r++) {
+                    // The S*Tc inputs of kernel row r are contiguous in the slab, as are their weight rows
+                    const fp32* x = slab + ((pp + r) * W + q) * Tc;
+                    const fp32* wr = w + r * S * Tc * Tm;
+                    fp32 a[4];
+                    const fp32* rows[4];
+                    std::size_t n = 0;
+                    for (std::size_t k = 0; k < S * Tc; k++) {
+                        if (x[k] == 0.0f) continue;
+                        a[n] = x[k];
+                        rows[n] = wr + k * Tm;
+                        if (++n == 4) {
+                            axpy4(out, a, rows[0], rows[1], rows[2], rows[3], Tm);
+                            n = 0;
+                        }
+                    }
+                    for (std::size_t i = 0; i < n; i++) axpy(out, a[i], rows[i], Tm);
+                }
+            }
+        }
+    }
+};
+}  // namespace
+
+std::size_t getTileBudget() { return tileBudget; }
+
+void setTileBudget(std::size_t bytes) { tileBudget = bytes; }
+
+TileTraffic runTiledPlan(const TilePlan& plan, const fp32* input, const fp32* weights, const fp32* bias, bool relu, fp32* output) {
+    const TileShape& shape = plan.shape;
+    if (shape.elementSize != sizeof(fp32)) throw std::runtime_error("runTiledPlan executes fp32 plans only");
+    const std::size_t W = shape.W, C = shape.C, Q = shape.Q, M = shape.M, R = shape.R, S = shape.S;
+
+    // Load stages, run on the helper threads of the double buffers (input and weight counts are written by one each)
+    TileTraffic traffic;
+    const auto loadInput = [&](const Tile& tile, fp32* slab) {
+        const std::size_t Tc = tile.inChannels;
+        for (std::size_t row = 0; row < tile.rows + R - 1; row++) {
+            for (std::size_t x = 0; x < W; x++) {
+                std::memcpy(slab + (row * W + x) * Tc, input + ((tile.p0 + row) * W + x) * C + tile.c0, Tc * sizeof(fp32));
+            }
+        }
+        traffic.input += (tile.rows + R - 1) * W * Tc * sizeof(fp32);
+    };
+    const auto loadWeights = [&](const Tile& tile, fp32* w) {
+        const std::size_t Tc = tile.inChannels, Tm = tile.channels;
+        for (std::size_t r = 0; r < R; r++) {
+            for (std::size_t s = 0; s < S; s++) {
+                for (std::size_t c = 0; c < Tc; c++) {
+                    const fp32* source = weights + ((r * S + s) * C + tile.c0 + c) * M + tile.m0;
+                    std::memcpy(w + ((r * S + s) * Tc + c) * Tm, source, Tm * sizeof(fp32));
+                }
+            }
+        }
+        traffic.weights += R * S * Tc * Tm * sizeof(fp32);
+    };
+
+    // Scratchpad kept across calls on this thread (with the buffers' helper threads), regrown for a larger plan
+    thread_local std::unique_ptr<DoubleBuffer> slabBuffers, weightBuffers;
+    thread_local std::vector<fp32> sums;
+    if (!slabBuffers || slabBuffers->size() < plan.inputTileBytes) slabBuffers.reset(new DoubleBuffer(plan.inputTileBytes));
+    if (!weightBuffers || weightBuffers->size() < plan.weightTileBytes) weightBuffers.reset(new DoubleBuffer(plan.weightTileBytes));
+    sums.resize(std::max(sums.size(), plan.outputTileBytes / sizeof(fp32)));
+    DoubleBuffer& slabs = *slabBuffers;
+    DoubleBuffer& weightTiles = *weightBuffers;
+
+    const std::vector<Tile>& tiles = plan.tiles;
+    loadInput(tiles[0], (fp32*)slabs.front());
+    loadWeights(tiles[0], (fp32*)weightTiles.front());
+    for (std::size_t i = 0; i < tiles.size(); i++) {
+        const bool next = i + 1 < tiles.size();
+        const bool nextInput = next && plan.loadsInput(i + 1), nextWeights = next && plan.loadsWeights(i + 1);
+        if (nextInput) slabs.fillBack([&, i](ui8* back) { loadInput(tiles[i + 1], (fp32*)back); });
+        if (nextWeights) weightTiles.fillBack([&, i](ui8* back) { loadWeights(tiles[i + 1], (fp32*)back); });
+
+        // Compute: accumulate the tile's input channels into the partial sums
+        const Tile& tile = tiles[i];
+        const std::size_t Tc = tile.inChannels, Tm = tile.channels;
+        const fp32* slab = (const fp32*)slabs.front();
+        const fp32* w = (const fp32*)weightTiles.front();
+        if (tile.c0 == 0) std::fill(sums.begin(), sums.end(), 0.0f);
+        dispatchIsa(TileCompute{tile, slab, w, W, Q, R, S, sums.data()});
+
+        // Store: bias and ReLU once the last input channels are in
+        if (tile.c0 + Tc == C) {
+            for (std::size_t pp = 0; pp < tile.rows; pp++) {
+                for (std::size_t q = 0; q < Q; q++) {
+                    const fp32* in = sums.data() + (pp * Q + q) * Tm;
+                    fp32* out = output + ((tile.p0 + pp) * Q + q) * M + tile.m0;
+                    for (std::size_t m = 0; m < Tm; m++) out[m] = relu ? std::max(0.0f, in[m] + bias[tile.m0 + m]) : in[m] + bias[tile.m0 + m];
+                }
+            }
+            traffic.output += tile.rows * Q * Tm * sizeof(fp32);
+        }
+
+        if (nextInput) slabs.swap();
+        if (nextWeights) weightTiles.swap();
+    }
+    return traffic;
+}
+
+}  // namespace ML
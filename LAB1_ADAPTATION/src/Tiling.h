@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Types.h"
+
+namespace ML {
+
+// Loop nest of a Conv layer, out[p][q][m] = sum over r, s, c of in[p + r][q + s][c] * w[r][s][c][m] (stride 1, valid
+// padding, weights [R][S][C][M]); a Dense layer is the 1x1 case with C inputs and M outputs
+struct TileShape {
+    std::size_t H = 1, W = 1, C = 1;  // Input
+    std::size_t P = 1, Q = 1, M = 1;  // Output
+    std::size_t R = 1, S = 1;         // Kernel
+    std::size_t elementSize = sizeof(fp32);  // Bytes per activation and weight
+
+    static TileShape conv(const std::vector<std::size_t>& inDims, const std::vector<std::size_t>& weightDims, std::size_t elementSize);
+    static TileShape dense(std::size_t inputs, std::size_t outputs, std::size_t elementSize);
+};
+
+// Bytes moved between memory and the scratchpad by one inference of a layer
+struct TileTraffic {
+    ui64 input = 0, weights = 0, output = 0;
+
+    inline ui64 total() const { return input + weights + output; }
+    TileTraffic& operator+=(const TileTraffic& other);
+};
+
+// Traffic of the last inference of a layer, published by whichever concurrent inference finished last
+class TileTrafficCounter {
+   public:
+    void store(const TileTraffic& traffic);
+    TileTraffic load() const;
+
+   private:
+    std::atomic<ui64> input{0}, weights{0}, output{0};
+};
+
+// One step of a schedule: output rows [p0, p0 + rows) and channels [m0, m0 + channels) over input channels
+// [c0, c0 + inChannels). Partial sums stay in the scratchpad until the step with the last input channels stores them
+struct Tile {
+    std::size_t p0, rows, m0, channels, c0, inChannels;
+};
+
+// Restrictions an executor puts on the tile sizes
+struct TileConstraints {
+    bool splitInputChannels = true;   // false when the executor needs whole dot products (the accelerator)
+    std::size_t channelMultiple = 1;  // Output channel tiles are whole multiples of this (accelerator lanes, fp32 vectors)
+};
+
+// Loop-tile schedule of a layer for a scratchpad of `budget` bytes. Tiles walk output rows, then output channels, then
+// input channels innermost. The input slab (rows + R - 1 rows of the tile's input channels) and the weight tile are
+// double-buffered, the next tile's loading while the current one computes, next to one tile of 32-bit partial sums;
+// a block equal to the previous tile's is kept instead of loaded again
+struct TilePlan {
+    TileShape shape;
+    std::size_t budget = 0;
+    std::size_t rows = 0, channels = 0, inChannels = 0;  // Tile sizes
+    std::size_t inputTileBytes = 0, weightTileBytes = 0, outputTileBytes = 0;
+    TileTraffic predicted;  // Per inference, outputs stored once
+    std::vector<Tile> tiles;
+
+    inline bool empty() const { return tiles.empty(); }
+    inline std::size_t footprint() const { return 2 * (inputTileBytes + weightTileBytes) + outputTileBytes; }
+
+    // Whether tile i loads its input slab / weights or keeps the previous tile's
+    inline bool loadsInput(std::size_t i) const { return i == 0 || tiles[i].p0 != tiles[i - 1].p0 || tiles[i].c0 != tiles[i - 1].c0; }
+    inline bool loadsWeights(std::size_t i) const { return i == 0 || tiles[i].m0 != tiles[i - 1].m0 || tiles[i].c0 != tiles[i - 1].c0; }
+
+    std::string str() const;  // e.g. "8x32x64 (rows x out x in), 64 tiles, 245760 B"
+};
+
+// Tile sizes fitting footprint() into the budget with the least predicted traffic, fewest tiles on ties
+// Throws when not even a single output fits
+TilePlan planTiles(const TileShape& shape, std::size_t budget, const TileConstraints& constraints = TileConstraints());
+
+// Scratchpad budget layers plan for at allocLayer (Config::TILE_BUDGET_BYTES unless set, e.g. by --tile-budget)
+std::size_t getTileBudget();
+void setTileBudget(std::size_t bytes);
+
+// Execute a plan on fp32 data: out = bias + conv(in, weights), optionally ReLU'd. Every step copies its input slab
+// into the scratchpad and its weights as [R][S][inChannels][channels], so each input adds one contiguous weight row to
+// the output pixel's partial sums; the next step's copies run on a helper thread. Returns the bytes actually copied
+// and stored
+TileTraffic runTiledPlan(const TilePlan& plan, const fp32* input, const fp32* weights, const fp32* bias, bool relu, fp32* output);
+
+}  // namespace ML
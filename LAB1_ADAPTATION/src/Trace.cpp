@@ -0,0 +1,122 @@
+#include "Trace.h"
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace ML {
+
+namespace {
+std::atomic<ui32> nextThreadId(0);
+
+// Layer event currently open on this thread
+thread_local TraceContext openContext = {nullptr, 0};
+
+// Render dims as a JSON array string, e.g. "[124,124,32]"
+std::string dimsToJson(const std::vector<std::size_t>& dims) {
+    std::ostringstream oss;
+    oss << "[";
+    for (std::size_t i = 0; i < dims.size(); i++) {
+        oss << (i ? "," : "") << dims[i];
+    }
+    oss << "]";
+    return oss.str();
+}
+
+// Escape a string for use inside a JSON string literal
+std::string jsonEscape(const std::string& str) {
+    std::string out;
+    out.reserve(str.size());
+    for (char c : str) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out;
+}
+}  // namespace
+
+ui32 traceThreadId() {
+    thread_local ui32 tid = nextThreadId++;
+    return tid;
+}
+
+TraceContext Tracer::context() { return openContext; }
+
+void Tracer::beginLayer(std::size_t layerNum, const Layer& layer, const LayerData& dataIn) {
+    std::ostringstream args;
+    args << "\"layer\":" << layerNum << ",\"type\":\"" << Layer::typeName(layer.getLType()) << "\",\"in\":"
+         << dimsToJson(dataIn.getParams().dims) << ",\"out\":" << dimsToJson(layer.getOutputParams().dims);
+
+    Event event;
+    event.name = layer.getName().empty() ? "layer_" + std::to_string(layerNum) : layer.getName();
+    event.category = "layer";
+    event.tid = traceThreadId();
+    event.args = args.str();
+    event.endNs = 0;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    event.beginNs = now();
+    openContext.tracer = this;
+    openContext.parent = events.size();
+    events.push_back(std::move(event));
+}
+
+void Tracer::endLayer(std::size_t, const Layer& layer, const LayerData&) {
+    ui64 endNs = now();
+    if (openContext.tracer != this) return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    events[openContext.parent].endNs = endNs;
+    if (layer.getInputDensity() >= 0) events[openContext.parent].args += ",\"density\":" + std::to_string(layer.getInputDensity());
+    openContext.tracer = nullptr;
+}
+
+void Tracer::recordTile(std::size_t parent, ui64 beginNs, ui64 endNs, std::size_t tileBegin, std::size_t tileEnd) {
+    Event event;
+    event.category = "tile";
+    event.tid = traceThreadId();
+    event.beginNs = beginNs;
+    event.endNs = endNs;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    event.name = events[parent].name + " tile";
+    event.args = "\"layer\":\"" + jsonEscape(events[parent].name) + "\",\"begin\":" + std::to_string(tileBegin) +
+                 ",\"end\":" + std::to_string(tileEnd);
+    events.push_back(std::move(event));
+}
+
+void Tracer::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    events.clear();
+}
+
+std::size_t Tracer::numEvents() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return events.size();
+}
+
+// Write all recorded events as trace-event JSON
+void Tracer::writeChromeTrace(const Path& filePath) const {
+    std::ofstream file(filePath);
+    if (!file.is_open()) throw std::runtime_error("Failed to open trace file: " + filePath);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"ml\"}}";
+
+    char ts[64];
+    for (const Event& event : events) {
+        if (event.endNs < event.beginNs) continue;  // Layer never finished (threw)
+
+        // Chrome expects microseconds, keep nanosecond resolution in the fraction
+        std::snprintf(ts, sizeof(ts), "\"ts\":%.3f,\"dur\":%.3f", event.beginNs / 1000.0, (event.endNs - event.beginNs) / 1000.0);
+        file << ",\n{\"name\":\"" << jsonEscape(event.name) << "\",\"cat\":\"" << event.category << "\",\"ph\":\"X\",\"pid\":0,\"tid\":"
+             << event.tid << "," << ts << ",\"args\":{" << event.args << "}}";
+    }
+    file << "\n]}\n";
+
+    if (!file) throw std::runtime_error("Failed to write trace file: " + filePath);
+}
+
+}  // namespace ML
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Config.h"
+#include "Model.h"
+#include "Types.h"
+#include "Utils.h"
+
+namespace ML {
+
+// Small sequential id for the calling thread (stable for the life of the thread)
+ui32 traceThreadId();
+
+class Tracer;
+
+// What a worker needs to attribute its tile to the layer span open on the dispatching thread
+struct TraceContext {
+    Tracer* tracer;
+    std::size_t parent;  // Index of the open layer event
+};
+
+// Records per-layer and per-worker-tile spans and exports them as Chrome/Perfetto trace-event JSON
+// Attach to a model with Model::addObserver(); open the exported file in chrome://tracing or ui.perfetto.dev
+class Tracer : public InferenceObserver {
+   public:
+    // A single complete ("ph":"X") trace event
+    struct Event {
+        std::string name;
+        const char* category;
+        ui32 tid;
+        ui64 beginNs;
+        ui64 endNs;
+        std::string args;  // Pre-rendered JSON object body
+    };
+
+   public:
+    Tracer() : origin(std::chrono::steady_clock::now()) {}
+    virtual ~Tracer() {}
+
+    // InferenceObserver hooks
+    virtual void beginLayer(std::size_t layerNum, const Layer& layer, const LayerData& dataIn) override;
+    virtual void endLayer(std::size_t layerNum, const Layer& layer, const LayerData& dataOut) override;
+
+    // Record one worker tile [tileBegin, tileEnd) of the layer event `parent`
+    void recordTile(std::size_t parent, ui64 beginNs, ui64 endNs, std::size_t tileBegin, std::size_t tileEnd);
+
+    // Nanoseconds since this tracer was created
+    inline ui64 now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+    }
+
+    // The tracer and layer event open on the calling thread ({nullptr, 0} when nothing is traced)
+    static TraceContext context();
+
+    // Drop all recorded events
+    void clear();
+
+    std::size_t numEvents() const;
+
+    // Write all recorded events as trace-event JSON
+    void writeChromeTrace(const Path& filePath) const;
+
+   private:
+    std::chrono::steady_clock::time_point origin;
+
+    mutable std::mutex mutex;
+    std::vector<Event> events;
+};
+
+// Times one worker tile and reports it to the context captured when the work was dispatched
+class TraceTileScope {
+   public:
+#ifndef DISABLE_TRACING
+    inline TraceTileScope(const TraceContext& ctx, std::size_t tileBegin, std::size_t tileEnd)
+        : ctx(ctx), tileBegin(tileBegin), tileEnd(tileEnd), beginNs(ctx.tracer ? ctx.tracer->now() : 0) {}
+    inline ~TraceTileScope() {
+        if (ctx.tracer) ctx.tracer->recordTile(ctx.parent, beginNs, ctx.tracer->now(), tileBegin, tileEnd);
+    }
+
+   private:
+    TraceContext ctx;
+    std::size_t tileBegin, tileEnd;
+    ui64 beginNs;
+#else
+    inline TraceTileScope(const TraceContext&, std::size_t, std::size_t) {}
+#endif
+};
+
+}  // namespace ML
@@ -23,6 +23,8 @@ using ui32 = std::uint32_t;
 using ui64 = std::uint64_t;
 
 // Floating point
+using fp16 = std::uint16_t;  // IEEE 754 half, storage only (see Half.h)
+using bf16 = std::uint16_t;  // bfloat16, storage only (see Half.h)
 using fp32 = float;
 using fp64 = double;
 using fp96 = long double;
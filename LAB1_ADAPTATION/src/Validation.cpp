@@ -0,0 +1,158 @@
+#include "Validation.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+#include "Activations.h"
+#include "Config.h"
+#include "FixedPoint.h"
+#include "Quantization.h"
+#include "layers/ClassifierHead.h"
+
+namespace ML {
+
+long long fileSize(const Path& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) return -1;
+    return file.tellg();
+}
+
+Path findReferenceMap(const Path& featureMapDir, std::size_t layerNum, const Layer& layer) {
+    Path outputName = featureMapDir / ("layer_" + std::to_string(layerNum) + "_output.bin");
+    if (fileSize(outputName) >= 0) return outputName;
+
+    if (!layer.getName().empty()) {
+        Path featuresName = featureMapDir / ("layer_" + std::to_string(layerNum) + "_" + layer.getName() + "_features.bin");
+        if (fileSize(featuresName) >= 0) return featuresName;
+    }
+    return Path("");
+}
+
+void LayerValidator::beginLayer(std::size_t layerNum, const Layer&, const LayerData&) {
+    if (layerNum == 0) convertLayers = 0;
+    beginTime = std::chrono::steady_clock::now();
+}
+
+void LayerValidator::endLayer(std::size_t modelLayerNum, const Layer& layer, const LayerData& modelDataOut) {
+    // Conversions inserted for reduced precision have no reference, number layers as the fp32 model does
+    if (layer.getLType() == Layer::LayerType::CONVERT) {
+        convertLayers++;
+        return;
+    }
+    std::size_t layerNum = modelLayerNum - convertLayers;
+
+    // A fused classifier head stands for the Dense and Softmax layers, compared with the Softmax output (the Dense
+    // logits in argmax mode)
+    if (layer.getLType() == Layer::LayerType::CLASSIFIER_HEAD && static_cast<const ClassifierHeadLayer&>(layer).getMode() != HeadMode::ARGMAX) {
+        layerNum++;
+    }
+
+    // Compare reduced precision outputs by their float value, blocked outputs in the NHWC order of the references
+    LayerData floatOut({sizeof(fp32), modelDataOut.getParams().dims});
+    if (layer.getPrecision() == Layer::Precision::FIXED) {
+        floatOut.allocData();
+        fixedToFloat(modelDataOut, floatOut);
+    } else if (layer.getPrecision() == Layer::Precision::INT8) {
+        floatOut.allocData();
+        dequantizeData(modelDataOut, floatOut, layer.getOutputQuant());
+    } else if (layer.getOutputLayout() != Layout::NHWC) {
+        floatOut.allocData();
+        convertLayout(modelDataOut, floatOut);
+    } else if (layer.getOutputStorage() != Layer::Storage::FP32) {
+        floatOut.allocData();
+        convertStorage(modelDataOut, layer.getOutputStorage(), layer.getOutputQuant(), floatOut, Layer::Storage::FP32, QuantParams());
+    }
+    const LayerData& dataOut = floatOut.isAlloced() ? floatOut : modelDataOut;
+
+    Result result;
+    result.layerNum = layerNum;
+    result.name = layer.getName();
+    result.ms = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - beginTime).count() / 1000.0;
+
+    Path expectedPath = findReferenceMap(featureMapDir, layerNum, layer);
+    const long long expectedBytes = expectedPath.empty() ? -1 : fileSize(expectedPath);
+    if (expectedBytes < 0) {
+        result.note = "no reference";
+    } else if (std::size_t(expectedBytes) != dataOut.getParams().byte_size()) {
+        result.note = "size mismatch (" + std::to_string(expectedBytes / dataOut.getParams().elementSize) + " expected, " +
+                      std::to_string(dataOut.getParams().flat_count()) + " produced)";
+    } else {
+        LayerData expected(dataOut.getParams(), expectedPath);
+        expected.loadData();
+        result.stats = dataOut.compareStats<fp32>(expected);
+        result.compared = true;
+        result.passed = result.stats.cosine > Config::COSINE_SIMILARITY_THRESHOLD;
+    }
+
+    results.push_back(result);
+}
+
+bool LayerValidator::allPassed() const {
+    for (const Result& result : results) {
+        if (result.compared && !result.passed) return false;
+    }
+    return true;
+}
+
+std::vector<std::vector<LayerValidator::Result>> validateCases(const std::function<Model()>& buildModel, const std::vector<ValidationCase>& cases,
+                                                               Layer::InfType infType, std::size_t jobs) {
+    std::vector<std::vector<LayerValidator::Result>> results(cases.size());
+    std::atomic<std::size_t> nextCase(0);
+
+    // Each worker owns one model and pulls cases until none are left
+    auto worker = [&]() {
+        Model model = buildModel();
+        model.allocLayers();
+
+        for (std::size_t i = nextCase++; i < cases.size(); i = nextCase++) {
+            LayerData input({sizeof(fp32), model[0].getInputParams().dims, cases[i].inputPath});
+            input.loadData();
+
+            LayerValidator validator(cases[i].featureMapDir);
+            model.addObserver(&validator);
+            model.inference(input, infType);
+            model.removeObserver(&validator);
+
+            results[i] = validator.getResults();
+        }
+
+        model.freeLayers();
+    };
+
+    jobs = std::max<std::size_t>(1, std::min(jobs, cases.size()));
+    std::vector<std::thread> threads;
+    for (std::size_t j = 1; j < jobs; j++) threads.emplace_back(worker);
+    worker();
+    for (std::thread& thread : threads) thread.join();
+
+    return results;
+}
+
+void printValidationResults(const ValidationCase& validationCase, const std::vector<LayerValidator::Result>& results) {
+    std::cout << "\nValidation of " << validationCase.inputPath << " against " << validationCase.featureMapDir << ":\n";
+    std::cout << std::left << std::setw(7) << "Layer" << std::setw(10) << "Name" << std::right << std::setw(11) << "Time(ms)" << std::setw(12)
+              << "Max abs" << std::setw(12) << "Mean abs" << std::setw(10) << "Cosine" << "  Result\n";
+
+    std::size_t passed = 0, compared = 0;
+    for (const LayerValidator::Result& r : results) {
+        std::cout << std::left << std::setw(7) << r.layerNum << std::setw(10) << r.name << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(11) << r.ms;
+        if (r.compared) {
+            std::cout << std::setprecision(6) << std::setw(12) << r.stats.maxAbs << std::setw(12) << r.stats.meanAbs << std::setprecision(4)
+                      << std::setw(10) << r.stats.cosine << "  " << (r.passed ? "PASS" : "FAIL") << "\n";
+            compared++;
+            passed += r.passed;
+        } else {
+            std::cout << std::setw(34) << "" << "  skipped: " << r.note << "\n";
+        }
+    }
+    std::cout.unsetf(std::ios::fixed);
+    std::cout << std::setprecision(6);
+    std::cout << passed << "/" << compared << " layers within cosine similarity " << Config::COSINE_SIMILARITY_THRESHOLD << "\n";
+}
+
+}  // namespace ML
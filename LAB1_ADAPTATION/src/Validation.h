@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Model.h"
+#include "Types.h"
+#include "Utils.h"
+
+namespace ML {
+
+// Reference feature map of a layer in featureMapDir, empty if none exists
+// Looked up as layer_<N>_output.bin (data/feature_maps) and then layer_<N>_<layer name>_features.bin
+// (feature_maps/, feature_maps_improved/)
+Path findReferenceMap(const Path& featureMapDir, std::size_t layerNum, const Layer& layer);
+
+// Size in bytes of a file, -1 if it cannot be opened
+long long fileSize(const Path& path);
+
+// Checks each layer's output against its exported reference feature map as a single forward pass runs
+// Reduced precision outputs are converted to fp32 first and inserted ConvertLayers are skipped
+class LayerValidator : public InferenceObserver {
+   public:
+    struct Result {
+        std::size_t layerNum = 0;
+        std::string name;
+        double ms = 0;          // Layer compute time (excluding the comparison)
+        bool compared = false;  // False when no usable reference exists, see note
+        bool passed = false;
+        std::string note;
+        CompareStats stats;
+    };
+
+   public:
+    explicit LayerValidator(const Path& featureMapDir) : featureMapDir(featureMapDir) {}
+    virtual ~LayerValidator() {}
+
+    // InferenceObserver hooks
+    virtual void beginLayer(std::size_t layerNum, const Layer& layer, const LayerData& dataIn) override;
+    virtual void endLayer(std::size_t layerNum, const Layer& layer, const LayerData& dataOut) override;
+
+    inline const std::vector<Result>& getResults() const { return results; }
+    bool allPassed() const;
+
+   private:
+    Path featureMapDir;
+    std::size_t convertLayers = 0;  // ConvertLayers seen so far in the current pass
+    std::chrono::steady_clock::time_point beginTime;
+    std::vector<Result> results;
+};
+
+// One input and the directory holding its reference feature maps
+struct ValidationCase {
+    Path inputPath;
+    Path featureMapDir;
+};
+
+// Validate every case with one forward pass each, running up to `jobs` cases at once
+// Each concurrent case gets its own model from buildModel() because layers own their output buffers
+std::vector<std::vector<LayerValidator::Result>> validateCases(const std::function<Model()>& buildModel, const std::vector<ValidationCase>& cases,
+                                                               Layer::InfType infType, std::size_t jobs);
+
+// Print one table row per layer
+void printValidationResults(const ValidationCase& validationCase, const std::vector<LayerValidator::Result>& results);
+
+}  // namespace ML
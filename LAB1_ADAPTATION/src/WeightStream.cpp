@@ -0,0 +1,82 @@
+#include "WeightStream.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace ML {
+
+void WeightStream::open(const Path& filePath, std::size_t rowCount, std::size_t bytesPerRow, std::size_t peak) {
+    close();
+    if (bytesPerRow == 0) throw std::runtime_error("Weight stream rows must not be empty");
+    chunkRows = std::min(peak / (2 * bytesPerRow), rowCount);
+    if (chunkRows == 0) {
+        throw std::runtime_error("Weight memory of " + std::to_string(peak) + " B does not hold two " + std::to_string(bytesPerRow) +
+                                 " B rows of " + filePath);
+    }
+
+#ifdef ZEDBOARD
+    if (f_open(&file, filePath.c_str(), FA_OPEN_EXISTING | FA_READ) != FR_OK) {
+#else
+    file.open(filePath, std::ios::binary);
+    if (!file.is_open()) {
+#endif
+        throw std::runtime_error("Failed to open binary file: " + filePath);
+    }
+    path = filePath;
+    rows = rowCount;
+    rowBytes = bytesPerRow;
+    buffers.reset(new DoubleBuffer(chunkRows * rowBytes));
+}
+
+void WeightStream::close() {
+    if (!buffers) return;
+    buffers.reset();
+#ifdef ZEDBOARD
+    f_close(&file);
+#else
+    file.close();
+#endif
+    rows = rowBytes = chunkRows = 0;
+}
+
+void WeightStream::readRows(std::size_t first, std::size_t count, ui8* out) {
+    const std::size_t bytes = count * rowBytes;
+#ifdef ZEDBOARD
+    UINT bytesRead = 0;
+    if (f_lseek(&file, first * rowBytes) != FR_OK || f_read(&file, out, bytes, &bytesRead) != FR_OK || bytesRead != bytes) {
+#else
+    file.clear();
+    if (!file.seekg(first * rowBytes) || !file.read((char*)out, bytes)) {
+#endif
+        throw std::runtime_error("Failed to read rows " + std::to_string(first) + "+" + std::to_string(count) + " of " + path);
+    }
+}
+
+void WeightStream::forEachChunk(const std::function<void(std::size_t, std::size_t, const ui8*)>& consume) {
+    if (!buffers) throw std::runtime_error("Weight stream is not open");
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const std::size_t chunks = getChunks();
+    const auto readChunk = [this](std::size_t c) {
+        return [this, c](ui8* out) { readRows(c * chunkRows, std::min(chunkRows, rows - c * chunkRows), out); };
+    };
+    buffers->fillBack(readChunk(0));
+    buffers->swap();
+    for (std::size_t c = 0; c < chunks; c++) {
+        const bool next = c + 1 < chunks;
+        if (next) buffers->fillBack(readChunk(c + 1));
+        consume(c * chunkRows, std::min(chunkRows, rows - c * chunkRows), buffers->front());
+        if (next) buffers->swap();
+    }
+}
+
+namespace {
+std::size_t weightMemoryLimit = 0;
+}  // namespace
+
+std::size_t getWeightMemoryLimit() { return weightMemoryLimit; }
+
+void setWeightMemoryLimit(std::size_t bytes) { weightMemoryLimit = bytes; }
+
+}  // namespace ML
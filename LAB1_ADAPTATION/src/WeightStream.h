@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "Packing.h"
+#include "Types.h"
+#include "Utils.h"
+
+#ifndef ZEDBOARD
+#    include <fstream>
+#endif
+
+namespace ML {
+
+// Row-major matrix read from its file in chunks of whole rows through two rotating buffers instead of loaded resident:
+// the read of the next chunk (FatFS f_read on the board) overlaps the caller's work on the current one, so at most
+// peakBytes() of the matrix are in memory at any time
+class WeightStream {
+   public:
+    WeightStream() = default;
+    WeightStream(const WeightStream&) = delete;
+    WeightStream& operator=(const WeightStream&) = delete;
+    ~WeightStream() { close(); }
+
+    // Throws when the file cannot be opened or `peakBytes` does not hold two rows
+    void open(const Path& path, std::size_t rows, std::size_t rowBytes, std::size_t peakBytes);
+    void close();
+    inline bool isOpen() const { return buffers != nullptr; }
+
+    inline std::size_t getChunkRows() const { return chunkRows; }
+    inline std::size_t getChunks() const { return rows ? (rows + chunkRows - 1) / chunkRows : 0; }
+    inline std::size_t peakBytes() const { return 2 * chunkRows * rowBytes; }
+
+    // consume(firstRow, rowCount, rowData) for every chunk in row order; concurrent callers take turns
+    void forEachChunk(const std::function<void(std::size_t, std::size_t, const ui8*)>& consume);
+
+   private:
+    void readRows(std::size_t first, std::size_t count, ui8* out);
+
+    Path path{""};
+    std::size_t rows = 0, rowBytes = 0, chunkRows = 0;
+    std::unique_ptr<DoubleBuffer> buffers;
+    std::mutex mutex;
+#ifdef ZEDBOARD
+    FIL file;
+#else
+    std::ifstream file;
+#endif
+};
+
+// Dense layers whose fp32 weights exceed this many bytes stream them through a WeightStream of that peak size,
+// 0 (the default) keeps every layer resident
+std::size_t getWeightMemoryLimit();
+void setWeightMemoryLimit(std::size_t bytes);
+
+}  // namespace ML
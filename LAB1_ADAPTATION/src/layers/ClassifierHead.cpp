@@ -0,0 +1,159 @@
+#include "ClassifierHead.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "../CpuDispatch.h"
+#include "../Types.h"
+#include "../Utils.h"
+#include "Layer.h"
+
+namespace ML
+{
+
+    const char* headModeName(HeadMode mode)
+    {
+        switch (mode)
+        {
+        case HeadMode::NONE: return "none";
+        case HeadMode::SOFTMAX: return "softmax";
+        case HeadMode::ARGMAX: return "argmax";
+        }
+        return "unknown";
+    }
+
+    HeadMode parseHeadMode(const std::string& name)
+    {
+        for (HeadMode mode : {HeadMode::NONE, HeadMode::SOFTMAX, HeadMode::ARGMAX})
+        {
+            if (name == headModeName(mode)) return mode;
+        }
+        throw std::runtime_error("Unknown classifier head mode: " + name + " (none, softmax or argmax)");
+    }
+
+    namespace {
+        HeadMode headMode = HeadMode::NONE;
+
+        constexpr size_t LANES = Config::HEAD_MAX_CLASSES;
+
+        // exp(x) of LANES values x <= 0 (max-subtracted logits). Cody-Waite reduction x = n ln2 + r with |r| <= ln2/2,
+        // the Cephes degree 6 polynomial for exp(r) and 2^n built in the exponent bits; branch free so every loop
+        // vectorizes. Below -87 the result flushes to 2^-126 * exp(r), negligible next to the exp(0) = 1 of the max
+        ML_ISA_INLINE void expNonPositive(const fp32* x, fp32* y)
+        {
+            i32 bits[LANES];
+            fp32 r[LANES];
+            for (size_t i = 0; i < LANES; i++)
+            {
+                const fp32 v = std::max(x[i], -87.0f);
+                const fp32 n = fp32(i32(v * 1.44269504088896341f - 0.5f));  // Rounds to nearest for v <= 0
+                const fp32 t = v - n * 0.693359375f + n * 2.12194440e-4f;
+                fp32 p = 1.9875691500e-4f;
+                p = p * t + 1.3981999507e-3f;
+                p = p * t + 8.3334519073e-3f;
+                p = p * t + 4.1665795894e-2f;
+                p = p * t + 1.6666665459e-1f;
+                p = p * t + 5.0000001201e-1f;
+                r[i] = p * t * t + t + 1.0f;
+                bits[i] = (i32(n) + 127) << 23;
+            }
+            fp32 scale[LANES];
+            std::memcpy(scale, bits, sizeof(scale));
+            for (size_t i = 0; i < LANES; i++) y[i] = r[i] * scale[i];
+        }
+
+        // The logits of `classes` outputs (bias preloaded), then for softmax the exp of each minus their max over all
+        // LANES. Unused lanes enter at -inf, which expNonPositive clamps to -87 (a tiny nonzero exp), so the caller
+        // zeroes them before summing
+        struct HeadKernel {
+            const fp32* input;
+            const fp32* weights;
+            size_t inputs, classes;
+            fp32* logits;
+            fp32* probs;  // nullptr in ARGMAX mode
+
+            ML_ISA_INLINE void operator()() const
+            {
+                // GEMV: one register-resident row of logits, weight rows of `classes` contiguous outputs per input
+                for (size_t k = 0; k < inputs; k++)
+                {
+                    const fp32 x = input[k];
+                    if (x == 0.0f) continue;  // Post-ReLU inputs are mostly zero
+                    const fp32* row = weights + k * classes;
+                    for (size_t c = 0; c < classes; c++) logits[c] += x * row[c];
+                }
+                if (!probs) return;
+
+                fp32 maxVal = logits[0];
+                for (size_t c = 1; c < classes; c++) maxVal = std::max(maxVal, logits[c]);
+                fp32 shifted[LANES];
+                for (size_t c = 0; c < LANES; c++) shifted[c] = c < classes ? logits[c] - maxVal : -INFINITY;
+                expNonPositive(shifted, probs);
+            }
+        };
+    }
+
+    HeadMode getHeadMode() { return headMode; }
+
+    void setHeadMode(HeadMode mode) { headMode = mode; }
+
+    size_t selectTopK(const fp32* scores, size_t n, size_t k, ClassScore* best)
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            if (count == k && !(scores[i] > best[k - 1].score)) continue;
+            size_t j = count < k ? count++ : k - 1;
+            for (; j > 0 && scores[i] > best[j - 1].score; j--) best[j] = best[j - 1];
+            best[j].label = i;
+            best[j].score = scores[i];
+        }
+        return count;
+    }
+
+    void ClassifierHeadLayer::computeNaive(const LayerData &dataIn) const
+    {
+        const size_t inputs = getInputParams().flat_count();
+        const size_t classes = getOutputParams().flat_count();
+
+        const fp32* input = (const fp32*)dataIn.raw();
+        const fp32* weights = (const fp32*)weightData.raw();
+        fp32* output = (fp32*)getOutputData().raw();
+
+        fp32 logits[LANES] = {}, probs[LANES];
+        std::memcpy(logits, biasData.raw(), classes * sizeof(fp32));
+        dispatchIsa(HeadKernel{input, weights, inputs, classes, logits, mode == HeadMode::ARGMAX ? nullptr : probs});
+
+        if (mode == HeadMode::ARGMAX)
+        {
+            std::memcpy(output, logits, classes * sizeof(fp32));
+            topCount = selectTopK(logits, classes, 1, top);
+            return;
+        }
+
+        // Softmax, without the clamped exp of the unused lanes
+        for (size_t c = classes; c < LANES; c++) probs[c] = 0.0f;
+
+        fp32 sum = 0.0f;
+        for (size_t c = 0; c < LANES; c++) sum += probs[c];
+        const fp32 inverse = 1.0f / sum;
+        for (size_t c = 0; c < classes; c++) output[c] = probs[c] * inverse;
+
+        topCount = selectTopK(output, classes, Config::HEAD_TOP_K, top);
+    }
+
+    void ClassifierHeadLayer::computeThreaded(const LayerData& dataIn) const {
+        computeNaive(dataIn);
+    }
+
+    void ClassifierHeadLayer::computeTiled(const LayerData& dataIn) const {
+        computeNaive(dataIn);
+    }
+
+    void ClassifierHeadLayer::computeSIMD(const LayerData& dataIn) const {
+        computeNaive(dataIn);
+    }
+
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <string>
+
+#include "../Config.h"
+#include "../Types.h"
+#include "../Utils.h"
+#include "Layer.h"
+
+namespace ML {
+
+// What a fused classifier head computes: the probabilities and their top-k (SOFTMAX), or only the label (ARGMAX,
+// no exp at all, the output holds the logits). NONE leaves the Dense and Softmax layers unfused
+enum class HeadMode { NONE, SOFTMAX, ARGMAX };
+
+const char* headModeName(HeadMode mode);
+HeadMode parseHeadMode(const std::string& name);
+
+// Mode the model builder fuses the classifier head of the models it builds in (NONE unless set, e.g. by --head)
+HeadMode getHeadMode();
+void setHeadMode(HeadMode mode);
+
+// A class and its score (probability, or logit in ARGMAX mode)
+struct ClassScore {
+    std::size_t label = 0;
+    fp32 score = 0;
+};
+
+// The min(k, n) highest of n scores, best first, ties to the lower label. Partial selection: each score is inserted
+// into a sorted list of at most k, nothing is allocated. Returns how many were written to `best`
+std::size_t selectTopK(const fp32* scores, std::size_t n, std::size_t k, ClassScore* best);
+
+// The final fp32 Dense layer (no ReLU) and the Softmax after it as one operator: GEMV with every logit in registers,
+// exp of the max-subtracted logits by a vectorizable polynomial, normalization and top-k selection, with no buffer
+// between the steps. Substituted for the pair by Model::fuseClassifierHead
+class ClassifierHeadLayer : public Layer {
+   public:
+    ClassifierHeadLayer(const LayerParams inParams, const LayerParams outParams, const LayerParams weightParams,
+                        const LayerParams biasParams, HeadMode mode)
+        : Layer(inParams, outParams, LayerType::CLASSIFIER_HEAD),
+          weightParam(weightParams),
+          weightData(weightParams),
+          biasParam(biasParams),
+          biasData(biasParams),
+          mode(mode) {}
+
+    HeadMode getMode() const { return mode; }
+
+    // Top-k of the last inference (only the label in ARGMAX mode)
+    std::size_t getTopKCount() const { return topCount; }
+    const ClassScore* getTopK() const { return top; }
+    std::size_t getLabel() const { return top[0].label; }
+
+    // One MAC per weight
+    virtual ui64 getMACs() const override { return weightParam.flat_count(); }
+
+    virtual void allocLayer() override {
+        Layer::allocLayer();
+        weightData.loadData();
+        biasData.loadData();
+    }
+
+    virtual void freeLayer() override {
+        Layer::freeLayer();
+        weightData.freeData();
+        biasData.freeData();
+    }
+
+    // Virtual functions, all the same single-threaded kernel (a few thousand MACs)
+    virtual void computeNaive(const LayerData& dataIn) const override;
+    virtual void computeThreaded(const LayerData& dataIn) const override;
+    virtual void computeTiled(const LayerData& dataIn) const override;
+    virtual void computeSIMD(const LayerData& dataIn) const override;
+
+   private:
+    LayerParams weightParam;
+    LayerData weightData;
+
+    LayerParams biasParam;
+    LayerData biasData;
+
+    HeadMode mode;
+    mutable ClassScore top[Config::HEAD_TOP_K];
+    mutable std::size_t topCount = 0;
+};
+
+}  // namespace ML
@@ -0,0 +1,81 @@
+#include "Convert.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include "../Activations.h"
+#include "../FixedPoint.h"
+#include "../Quantization.h"
+#include "../Types.h"
+#include "../Utils.h"
+#include "Layer.h"
+
+namespace ML
+{
+
+    namespace {
+        // Fixed <-> int8 goes through float one element at a time, no intermediate buffer needed
+        void fixedToInt8(const LayerData& in, LayerData& out, const QuantParams& params)
+        {
+            const std::size_t count = in.getParams().flat_count();
+            const FixedAct* src = (const FixedAct*)in.raw();
+            ui8* dst = (ui8*)out.raw();
+            for (std::size_t i = 0; i < count; i++) dst[i] = quantize(src[i].to_float(), params);
+        }
+
+        void int8ToFixed(const LayerData& in, LayerData& out, const QuantParams& params)
+        {
+            const std::size_t count = in.getParams().flat_count();
+            const ui8* src = (const ui8*)in.raw();
+            FixedAct* dst = (FixedAct*)out.raw();
+            for (std::size_t i = 0; i < count; i++) dst[i] = toFixedAct(dequantize(src[i], params));
+        }
+    }
+
+    void ConvertLayer::computeNaive(const LayerData &dataIn) const
+    {
+        LayerData& output = getOutputData();
+
+        if (getInputLayout() != getOutputLayout()) {
+            convertLayout(dataIn, output);
+        } else if (from == to) {
+            std::memcpy(output.raw(), dataIn.raw(), getInputParams().byte_size());
+        } else if (from == Precision::FP32 && to == Precision::FIXED) {
+            floatToFixed(dataIn, output);
+        } else if (from == Precision::FIXED && to == Precision::FP32) {
+            fixedToFloat(dataIn, output);
+        } else if (from == Precision::FP32 && to == Precision::INT8) {
+            quantizeData(dataIn, output, getOutputQuant());
+        } else if (from == Precision::INT8 && to == Precision::FP32) {
+            dequantizeData(dataIn, output, getInputQuant());
+        } else if (from == Precision::FIXED && to == Precision::INT8) {
+            fixedToInt8(dataIn, output, getOutputQuant());
+        } else if (from == Precision::INT8 && to == Precision::FIXED) {
+            int8ToFixed(dataIn, output, getInputQuant());
+        } else {
+            throw std::runtime_error(std::string("No conversion from ") + precisionName(from) + " to " + precisionName(to));
+        }
+    }
+
+    void ConvertLayer::computeThreaded(const LayerData& dataIn) const {
+        // A single streaming pass, not worth splitting
+        computeNaive(dataIn);
+    }
+
+    void ConvertLayer::computeTiled(const LayerData& dataIn) const {
+        computeNaive(dataIn);
+    }
+
+    void ConvertLayer::computeSIMD(const LayerData& dataIn) const {
+        computeNaive(dataIn);
+    }
+
+    void ConvertLayer::computeFixed(const LayerData& dataIn, InfType) const {
+        computeNaive(dataIn);
+    }
+
+    void ConvertLayer::computeInt8(const LayerData& dataIn, InfType) const {
+        computeNaive(dataIn);
+    }
+
+}
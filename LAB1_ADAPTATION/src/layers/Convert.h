@@ -0,0 +1,48 @@
+#pragma once
+
+#include "../Types.h"
+#include "../Utils.h"
+#include "Layer.h"
+
+namespace ML {
+// Converts activations between precisions or between layouts where a model switches format (inserted by
+// Model::setPrecisionPlan). Int8 sides use the layer's input/output quantization
+class ConvertLayer : public Layer {
+   public:
+    ConvertLayer(const LayerParams params, Precision from, Precision to)
+        : Layer(params, params, LayerType::CONVERT), from(from), to(to) {
+        setPrecision(to);
+        setElementSizes(elementSize(from), elementSize(to));
+        setName(std::string("to_") + precisionName(to));
+    }
+
+    // fp32 layout reorder at an end of a run of blocked layers
+    ConvertLayer(const LayerParams params, Layout toLayout)
+        : Layer(params, params, LayerType::CONVERT), from(Precision::FP32), to(Precision::FP32) {
+        setLayout(params.layout, toLayout);
+        setName(std::string("to_") + layoutName(toLayout));
+    }
+
+    // Getters
+    Precision getFromPrecision() const { return from; }
+
+    // The output is in the target precision, whatever that is
+    virtual bool supportsPrecision(Precision p) const override { return p == to; }
+
+    // Layouts are only reordered, not converted along with the precision
+    virtual bool supportsLayout(Layout in, Layout out) const override { return from == to || (in == Layout::NHWC && out == Layout::NHWC); }
+
+    // Virtual functions
+    virtual void computeNaive(const LayerData& dataIn) const override;
+    virtual void computeThreaded(const LayerData& dataIn) const override;
+    virtual void computeTiled(const LayerData& dataIn) const override;
+    virtual void computeSIMD(const LayerData& dataIn) const override;
+    virtual void computeFixed(const LayerData& dataIn, InfType infType) const override;
+    virtual void computeInt8(const LayerData& dataIn, InfType infType) const override;
+
+   private:
+    Precision from;
+    Precision to;
+};
+
+}  // namespace ML
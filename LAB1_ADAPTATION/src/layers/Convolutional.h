@@ -1,5 +1,16 @@
 #pragma once
 
+#include <atomic>
+#include <limits>
+
+#include "../Accelerator.h"
+#include "../Activations.h"
+#include "../Config.h"
+#include "../Dataflow.h"
+#include "../FixedPoint.h"
+#include "../Half.h"
+#include "../Quantization.h"
+#include "../Sparse.h"
 #include "../Types.h"
 #include "../Utils.h"
 #include "Layer.h"
@@ -19,12 +30,71 @@ class ConvolutionalLayer : public Layer {
     const LayerParams& getBiasParams() const { return biasParam; }
     const LayerData& getWeightData() const { return weightData; }
     const LayerData& getBiasData() const { return biasData; }
+    const FixedWeights& getFixedWeights() const { return fixedWeights; }
+    const QuantizedWeights& getQuantizedWeights() const { return quantWeights; }
+
+    // Loop order of the fp32 NHWC kernels (naive and threaded, dense weights). AUTO is resolved by the cache model at every
+    // inference from the density of its input; getDataflow() is the loop order the last inference ran
+    Dataflow getDataflow() const { return dataflow.load(std::memory_order_relaxed); }
+    Dataflow getRequestedDataflow() const { return requestedDataflow; }
+    void setDataflow(Dataflow requested) {
+        requestedDataflow = requested;
+        dataflow.store(requested == Dataflow::AUTO ? CacheModel().select(getTileShape()) : requested, std::memory_order_relaxed);
+        inputDensity.store(-1.0f, std::memory_order_relaxed);
+    }
+    TileShape getTileShape() const { return TileShape::conv(getInputParams().dims, weightParam.dims, sizeof(fp32)); }
+
+    // Runs in fp32, fp32 with fp16/bf16 weights (widened in registers), fixed point (weights converted to a per-layer
+    // Q-format at load) or int8 (per-channel weight scales)
+    virtual bool supportsPrecision(Precision p) const override {
+        return p == Precision::FP32 || p == Precision::FP16 || p == Precision::BF16 || p == Precision::FIXED ||
+               p == Precision::INT8;
+    }
+
+    // fp32 layers can keep their input and output as fp16 or uint8 (widened on load, rounded in the epilogue)
+    virtual bool supportsStorage(Storage s) const override { return s == Storage::FP32 || getPrecision() == Precision::FP32; }
+
+    // fp32 layers with fp32 activations also run channel-blocked, reading an NHWC or an equally blocked input
+    virtual bool supportsLayout(Layout in, Layout out) const override {
+        if (out == Layout::NHWC) return in == Layout::NHWC;
+        return getPrecision() == Precision::FP32 && getInputStorage() == Storage::FP32 && getOutputStorage() == Storage::FP32 &&
+               (in == Layout::NHWC || in == out);
+    }
+
+    // P*Q*M output elements, each an R*S*C dot product
+    virtual float getInputDensity() const override { return inputDensity.load(std::memory_order_relaxed); }
+    virtual ui64 getMACs() const override {
+        return getOutputParams().flat_count() * weightParam.dims[0] * weightParam.dims[1] * weightParam.dims[2];
+    }
+
+    virtual const TilePlan* getTilePlan() const override { return tilePlan.empty() ? nullptr : &tilePlan; }
+    virtual TileTraffic getTileTraffic() const override { return tileTraffic.load(); }
 
     // Allocate all resources needed for the layer & Load all of the required data for the layer
     virtual void allocLayer() override {
         Layer::allocLayer();
+        setDataflow(getDataflowPlan().forLayer(getName()));
         weightData.loadData();
         biasData.loadData();
+        if (getPrecision() == Precision::FP16 || getPrecision() == Precision::BF16) {
+            halfWeights.load(weightData, biasParam.flat_count(), getPrecision());
+            weightData.freeData();  // Half layers only ever run computeHalf
+        }
+        if (getPrecision() == Precision::FIXED) {
+            fixedWeights.load(weightData, biasData);
+            weightData.freeData();  // Fixed layers only ever run computeFixed
+            logInfo(getName() + ": fixed-point weights " + fixedWeights.format.str());
+        }
+        if (getPrecision() == Precision::INT8) {
+            quantWeights.load(weightData, biasData, getInputQuant(), getOutputQuant());
+            weightData.freeData();  // Int8 layers only ever run computeInt8, the ACCEL packing is built from quantWeights
+        }
+        if (getOutputLayout() != Layout::NHWC) {
+            loadBlockedWeights();
+            return;
+        }
+        if (getPrecision() == Precision::FP32) loadBlockSparse();
+        planTiling();
     }
 
     // Fre all resources allocated for the layer
@@ -32,6 +102,15 @@ class ConvolutionalLayer : public Layer {
         Layer::freeLayer();
         weightData.freeData();
         biasData.freeData();
+        halfWeights.clear();
+        fixedWeights.clear();
+        quantWeights.clear();
+        accelWeights.clear();
+        sparseWeights.clear();
+        blockedWeights.clear();
+        blockedBias.clear();
+        tilePlan = TilePlan();
+        patchOffsets.clear();
     }
 
     // Virtual functions
@@ -39,13 +118,183 @@ class ConvolutionalLayer : public Layer {
     virtual void computeThreaded(const LayerData& dataIn) const override;
     virtual void computeTiled(const LayerData& dataIn) const override;
     virtual void computeSIMD(const LayerData& dataIn) const override;
+    virtual void computeHalf(const LayerData& dataIn, InfType infType) const override;
+    virtual void computeFixed(const LayerData& dataIn, InfType infType) const override;
+    virtual void computeInt8(const LayerData& dataIn, InfType infType) const override;
 
    private:
+    // Keep the [R*S*C][M] fp32 weights block-sparse instead when few enough blocks are nonzero (e.g. after `ml prune`)
+    void loadBlockSparse() {
+        const std::size_t cols = biasParam.flat_count();
+        const std::size_t rows = weightParam.flat_count() / cols;
+        const BlockShape block;
+        const float density = blockDensity((const fp32*)weightData.raw(), rows, cols, block);
+        if (density > Config::BLOCK_SPARSE_DENSITY_THRESHOLD) return;
+
+        sparseWeights.load((const fp32*)weightData.raw(), rows, cols, block);
+        weightData.freeData();
+        logInfo(getName() + ": block-sparse weights " + block.str() + ", " + std::to_string(int(density * 100 + 0.5f)) +
+                "% of blocks kept (" + std::to_string(sparseWeights.bytes()) + " bytes)");
+
+        // Offset of weight row k = (r*S + s)*C + c within the input patch of an output pixel
+        const std::size_t S = weightParam.dims[1], C = weightParam.dims[2], W = getInputParams().dims[1];
+        patchOffsets.resize(rows);
+        for (std::size_t k = 0; k < rows; k++) patchOffsets[k] = ui32((k / (S * C)) * W * C + k % (S * C));
+    }
+
+    // Repack the [R][S][C][M] fp32 weights as [M/b][R][S][C][b] for the output's channel block b, zero padded like
+    // the bias, so the blocked kernel reads one contiguous b-vector per input channel
+    void loadBlockedWeights() {
+        const std::size_t R = weightParam.dims[0], S = weightParam.dims[1], C = weightParam.dims[2], M = weightParam.dims[3];
+        const std::size_t b = getOutputParams().channelBlock(), blocks = getOutputParams().channelBlocks();
+        const fp32* weights = (const fp32*)weightData.raw();
+        const fp32* bias = (const fp32*)biasData.raw();
+        blockedWeights.assign(blocks * R * S * C * b, 0.0f);
+        blockedBias.assign(blocks * b, 0.0f);
+        for (std::size_t m = 0; m < M; m++) {
+            blockedBias[m] = bias[m];
+            for (std::size_t k = 0; k < R * S * C; k++) blockedWeights[((m / b) * R * S * C + k) * b + m % b] = weights[k * M + m];
+        }
+    }
+
+    // Plan the tiles of the TILED path (dense fp32 weights) or of the ACCEL path (int8, whole dot products per lane
+    // tile) for the current budget, untiled with a warning when the budget cannot hold a single output
+    void planTiling() const {
+        TileShape shape = getTileShape();
+        TileConstraints constraints;
+        if (getPrecision() == Precision::INT8) {
+            if (!accelWeights.lanes) return;  // Planned by prepareAccelerated()
+            shape.elementSize = sizeof(ui8);
+            constraints.splitInputChannels = false;
+            constraints.channelMultiple = accelWeights.lanes;
+        } else if (getPrecision() != Precision::FP32 || !sparseWeights.empty()) {
+            return;
+        } else {
+            constraints.channelMultiple = Config::TILE_CHANNEL_MULTIPLE;
+        }
+        try {
+            tilePlan = planTiles(shape, getTileBudget(), constraints);
+        } catch (const std::runtime_error& e) {
+            logWarn(getName() + ": " + e.what() + ", running untiled");
+            tilePlan = planTiles(shape, std::numeric_limits<std::size_t>::max(), constraints);
+        }
+    }
+
+    // Block-sparse convolution of output rows [pBegin, pEnd), each output pixel one block-sparse GEMV over its patch
+    template <typename In, typename Out>
+    ML_ISA_INLINE void computeBlockSparseRows(const LayerData& dataIn, In in, Out out, std::size_t pBegin, std::size_t pEnd) const;
+
+    // computeBlockSparseRows bound to the storage codecs picked at run time
+    struct BlockSparseRowsKernel {
+        const ConvolutionalLayer& layer;
+        const LayerData& dataIn;
+        std::size_t pBegin, pEnd;
+
+        template <typename In, typename Out> ML_ISA_INLINE void operator()(In in, Out out) const {
+            layer.computeBlockSparseRows(dataIn, in, out, pBegin, pEnd);
+        }
+    };
+
+    // Naive convolution of output rows [pBegin, pEnd), shared by the naive and threaded paths
+    // In/Out are the codecs of the stored input and output activations
+    template <typename In, typename Out>
+    ML_ISA_INLINE void computeOutputRows(const LayerData& dataIn, In in, Out out, std::size_t pBegin, std::size_t pEnd) const;
+
+    // Weight-stationary convolution of output rows [pBegin, pEnd)
+    template <typename In, typename Out>
+    ML_ISA_INLINE void computeWeightStationaryRows(const LayerData& dataIn, In in, Out out, std::size_t pBegin, std::size_t pEnd) const;
+
+    // Input-stationary convolution of output rows [pBegin, pEnd)
+    template <typename In, typename Out>
+    ML_ISA_INLINE void computeInputStationaryRows(const LayerData& dataIn, In in, Out out, std::size_t pBegin, std::size_t pEnd) const;
+
+    // The rows kernel of the layer's dataflow bound to the storage codecs picked at run time
+    struct RowsKernel {
+        const ConvolutionalLayer& layer;
+        const LayerData& dataIn;
+        std::size_t pBegin, pEnd;
+        Dataflow dataflow;
+
+        template <typename In, typename Out> ML_ISA_INLINE void operator()(In in, Out out) const {
+            switch (dataflow) {
+            case Dataflow::WEIGHT: layer.computeWeightStationaryRows(dataIn, in, out, pBegin, pEnd); break;
+            case Dataflow::INPUT: layer.computeInputStationaryRows(dataIn, in, out, pBegin, pEnd); break;
+            default: layer.computeOutputRows(dataIn, in, out, pBegin, pEnd); break;
+            }
+        }
+    };
+
+    // Fraction of nonzero values of the input, decoded through its storage codec
+    struct DensityKernel {
+        const LayerData& dataIn;
+        float& density;
+
+        template <typename In, typename Out> ML_ISA_INLINE void operator()(In in, Out) const {
+            const std::size_t n = dataIn.getParams().flat_count();
+            const typename In::type* x = (const typename In::type*)dataIn.raw();
+            std::size_t nonzero = 0;
+            for (std::size_t i = 0; i < n; i++) nonzero += in.load(x[i]) != 0.0f;
+            density = n ? float(nonzero) / n : 1.0f;
+        }
+    };
+
+    // Loop order for this input: the requested one, or under AUTO the cache model's pick for its measured density
+    Dataflow resolveDataflow(const LayerData& dataIn) const;
+
+    // Channel-blocked convolution of output rows [pBegin, pEnd) with B channels per output block
+    template <std::size_t B> ML_ISA_INLINE void computeBlockedRows(const LayerData& dataIn, std::size_t pBegin, std::size_t pEnd) const;
+    void computeBlockedRows(const LayerData& dataIn, std::size_t pBegin, std::size_t pEnd) const;
+
+    // computeBlockedRows<B> for dispatchIsa
+    template <std::size_t B> struct BlockedRowsKernel {
+        const ConvolutionalLayer& layer;
+        const LayerData& dataIn;
+        std::size_t pBegin, pEnd;
+
+        ML_ISA_INLINE void operator()() const { layer.computeBlockedRows<B>(dataIn, pBegin, pEnd); }
+    };
+
+    // Convolution of output rows [pBegin, pEnd) widening fp16/bf16 weights
+    void computeHalfRows(const LayerData& dataIn, std::size_t pBegin, std::size_t pEnd) const;
+
+    // Fixed-point convolution of output rows [pBegin, pEnd)
+    void computeFixedRows(const LayerData& dataIn, std::size_t pBegin, std::size_t pEnd) const;
+
+    // Int8 convolution of output rows [pBegin, pEnd)
+    void computeInt8Rows(const LayerData& dataIn, std::size_t pBegin, std::size_t pEnd) const;
+
+    // Pack quantWeights for the accelerator and plan its tiles on the first ACCEL run, as DenseLayer does
+    void prepareAccelerated() const {
+        if (accelWeights.lanes) return;
+        const MacAccelerator& accel = MacAccelerator::shared();
+        accelWeights.load(quantWeights, accel.getConfig(), accel.getPacker());
+        planTiling();
+    }
+
+    // Int8 convolution on the MAC accelerator emulator, one transaction per output pixel and tile of output channels
+    void computeAccelerated(const LayerData& dataIn) const;
+
+    // Streams of every output pixel of row `row` of an input slab for one tile of accelWeights, each streamBytes() long
+    void packAcceleratorRow(const ui8* slab, const ui8* tile, std::size_t row, ui8* out) const;
+
     LayerParams weightParam;
     LayerData weightData;
 
     LayerParams biasParam;
     LayerData biasData;
+
+    HalfWeights halfWeights;
+    FixedWeights fixedWeights;
+    QuantizedWeights quantWeights;
+    mutable AcceleratorWeights accelWeights;  // quantWeights pre-packed by the first ACCEL run
+    BlockSparseWeights sparseWeights;  // Loaded instead of the dense fp32 weights when they are mostly zero blocks
+    std::vector<ui32> patchOffsets;     // Input offset of each weight row, used by the block-sparse path
+    std::vector<fp32> blockedWeights, blockedBias;  // Repacked for a blocked output layout
+    mutable TilePlan tilePlan;  // TILED plan from allocLayer(), or the ACCEL plan from its first run
+    mutable TileTrafficCounter tileTraffic;
+    Dataflow requestedDataflow = Dataflow::AUTO;
+    mutable std::atomic<Dataflow> dataflow{Dataflow::OUTPUT};
+    mutable std::atomic<float> inputDensity{-1.0f};  // Measured while resolving AUTO
 };
 
 }  // namespace ML
\ No newline at end of file
@@ -2,9 +2,12 @@
 
 #include <iostream>
 #include <algorithm>
+#include <cstring>
 #include <thread>
 #include <vector>
 
+#include "../Accelerator.h"
+#include "../ThreadPool.h"
 #include "../Types.h"
 #include "../Utils.h"
 #include "Layer.h"
@@ -19,9 +22,32 @@ namespace ML
     // Perform convolution
     void ConvolutionalLayer::computeNaive(const LayerData &dataIn) const
     {
-        // TODO: Your Code Here...
-        // The following line is an example of copying a single 32-bit floating point integer from the input layer data to the output layer data
+        if (!blockedWeights.empty()) {
+            computeBlockedRows(dataIn, 0, getOutputParams().dims[0]);
+            return;
+        }
+        if (!sparseWeights.empty()) {
+            withStorageCodecs(*this, BlockSparseRowsKernel{*this, dataIn, 0, getOutputParams().dims[0]});
+            return;
+        }
+        withStorageCodecs(*this, RowsKernel{*this, dataIn, 0, getOutputParams().dims[0], resolveDataflow(dataIn)});
+    }
 
+    Dataflow ConvolutionalLayer::resolveDataflow(const LayerData &dataIn) const
+    {
+        if (requestedDataflow != Dataflow::AUTO) return requestedDataflow;
+        float density = 1.0f;
+        withStorageCodecs(*this, DensityKernel{dataIn, density});
+        const Dataflow selected = CacheModel().select(getTileShape(), density);
+        inputDensity.store(density, std::memory_order_relaxed);
+        dataflow.store(selected, std::memory_order_relaxed);
+        return selected;
+    }
+
+    // Convolve output rows [pBegin, pEnd)
+    template <typename In, typename Out>
+    void ConvolutionalLayer::computeOutputRows(const LayerData &dataIn, In in, Out out, size_t pBegin, size_t pEnd) const
+    {
         const auto &inputDims = getInputParams().dims;   // [H, W, C_in]
         const auto &outputDims = getOutputParams().dims; // [H_out, W_out, C_out]
         const auto &weightDims = getWeightParams().dims; // [K_H, K_W, C_in, C_out]
@@ -31,14 +57,16 @@ namespace ML
         size_t W = inputDims[1];
         size_t C = inputDims[2];
 
-        size_t P = outputDims[0];
         size_t Q = outputDims[1];
         size_t M = outputDims[2];
 
         size_t R = weightDims[0];
         size_t S = weightDims[1];
 
-        for (size_t p = 0; p < P; p++)
+        const typename In::type* input = (const typename In::type*)dataIn.raw();
+        typename Out::type* output = (typename Out::type*)getOutputData().raw();
+
+        for (size_t p = pBegin; p < pEnd; p++)
         {
             for (size_t q = 0; q < Q; q++)
             {
@@ -65,7 +93,7 @@ namespace ML
                                 size_t weight_idx = r * S * C * M + s * C * M + c * M + m;
                                 
                                 // Accumulate
-                                result += dataIn.get<fp32>(input_idx) *
+                                result += in.load(input[input_idx]) *
                                           getWeightData().get<fp32>(weight_idx);
                             }
                         }
@@ -76,33 +104,583 @@ namespace ML
                     // Apply ReLU activation
                     result = std::max(0.0f, result);
                     
-                    // Output index: [p, q, m]
+                    // Output index: [p, q, m], rounded to the output storage
                     size_t output_idx = p * Q * M + q * M + m;
-                    getOutputData().get<fp32>(output_idx) = result;
+                    output[output_idx] = out.store(result);
+                }
+            }
+        }
+    }
+
+    // Weight-stationary: each weight vector w[r][s][c][0..M) is loaded once per output row and applied to the Q output
+    // vectors it touches, contiguous axpys over M into one row of partial sums
+    template <typename In, typename Out>
+    void ConvolutionalLayer::computeWeightStationaryRows(const LayerData &dataIn, In in, Out out, size_t pBegin, size_t pEnd) const
+    {
+        const auto &inputDims = getInputParams().dims;   // [H, W, C_in]
+        const auto &outputDims = getOutputParams().dims; // [H_out, W_out, C_out]
+        const auto &weightDims = getWeightParams().dims; // [K_H, K_W, C_in, C_out]
+
+        size_t W = inputDims[1];
+        size_t C = inputDims[2];
+
+        size_t Q = outputDims[1];
+        size_t M = outputDims[2];
+
+        size_t R = weightDims[0];
+        size_t S = weightDims[1];
+
+        const typename In::type* input = (const typename In::type*)dataIn.raw();
+        typename Out::type* output = (typename Out::type*)getOutputData().raw();
+        const fp32* weights = (const fp32*)getWeightData().raw();
+        const fp32* bias = (const fp32*)getBiasData().raw();
+
+        thread_local std::vector<fp32> sums;
+        sums.resize(Q * M);
+
+        for (size_t p = pBegin; p < pEnd; p++)
+        {
+            for (size_t q = 0; q < Q; q++) std::memcpy(sums.data() + q * M, bias, M * sizeof(fp32));
+
+            for (size_t r = 0; r < R; r++)
+            {
+                for (size_t s = 0; s < S; s++)
+                {
+                    for (size_t c = 0; c < C; c++)
+                    {
+                        const fp32* w = weights + ((r * S + s) * C + c) * M;
+                        const typename In::type* x = input + ((p + r) * W + s) * C + c;
+                        for (size_t q = 0; q < Q; q++) axpy(sums.data() + q * M, in.load(x[q * C]), w, M);
+                    }
                 }
             }
+
+            // Apply ReLU activation
+            for (size_t i = 0; i < Q * M; i++) output[p * Q * M + i] = out.store(std::max(0.0f, sums[i]));
         }
     }
 
-    // Compute the convolution using threads
+    // Input-stationary: every input element of the rows feeding [pBegin, pEnd) is read once and scattered into the
+    // R*S output vectors it contributes to. Output row p only needs input rows p..p+R-1, so partial sums live in a
+    // ring of R rows and row p is stored as soon as input row p+R-1 is done. Zero inputs contribute nothing and are
+    // skipped
+    template <typename In, typename Out>
+    void ConvolutionalLayer::computeInputStationaryRows(const LayerData &dataIn, In in, Out out, size_t pBegin, size_t pEnd) const
+    {
+        const auto &inputDims = getInputParams().dims;   // [H, W, C_in]
+        const auto &outputDims = getOutputParams().dims; // [H_out, W_out, C_out]
+        const auto &weightDims = getWeightParams().dims; // [K_H, K_W, C_in, C_out]
+
+        size_t W = inputDims[1];
+        size_t C = inputDims[2];
+
+        size_t Q = outputDims[1];
+        size_t M = outputDims[2];
+
+        size_t R = weightDims[0];
+        size_t S = weightDims[1];
+
+        const typename In::type* input = (const typename In::type*)dataIn.raw();
+        typename Out::type* output = (typename Out::type*)getOutputData().raw();
+        const fp32* weights = (const fp32*)getWeightData().raw();
+        const fp32* bias = (const fp32*)getBiasData().raw();
+
+        thread_local std::vector<fp32> ring;
+        ring.resize(R * Q * M);
+
+        for (size_t h = pBegin; h < pEnd + R - 1; h++)
+        {
+            // Input row h is the first to reach output row h
+            if (h < pEnd)
+            {
+                fp32* sums = ring.data() + (h % R) * Q * M;
+                for (size_t q = 0; q < Q; q++) std::memcpy(sums + q * M, bias, M * sizeof(fp32));
+            }
+
+            // Output rows h-R+1..h within range, kernel rows r = h - p
+            const size_t rFirst = h >= pEnd ? h - pEnd + 1 : 0;
+            const size_t rLast = std::min(R - 1, h - pBegin);
+            for (size_t w = 0; w < W; w++)
+            {
+                // Output columns w-S+1..w within range, kernel columns s = w - q
+                const size_t sFirst = w >= Q ? w - Q + 1 : 0;
+                const size_t sLast = std::min(S - 1, w);
+                for (size_t c = 0; c < C; c++)
+                {
+                    const fp32 x = in.load(input[(h * W + w) * C + c]);
+                    if (x == 0.0f) continue;
+                    for (size_t r = rFirst; r <= rLast; r++)
+                    {
+                        fp32* sums = ring.data() + ((h - r) % R) * Q * M;
+                        for (size_t s = sFirst; s <= sLast; s++)
+                        {
+                            axpy(sums + (w - s) * M, x, weights + ((r * S + s) * C + c) * M, M);
+                        }
+                    }
+                }
+            }
+
+            // Output row h-R+1 has all its input rows, apply ReLU and store it
+            if (h + 1 >= pBegin + R)
+            {
+                const size_t p = h + 1 - R;
+                const fp32* sums = ring.data() + (p % R) * Q * M;
+                for (size_t i = 0; i < Q * M; i++) output[p * Q * M + i] = out.store(std::max(0.0f, sums[i]));
+            }
+        }
+    }
+
+    namespace {
+        // N adjacent output pixels of one block of B output channels, the N*B partial sums held in registers while
+        // every nonzero input channel of the R*S window broadcasts against its B contiguous weights. `x` is the first input
+        // pixel of the window, `block` the channels stored per input pixel, `row`/`plane` the input row/block strides
+        template <size_t B, size_t N>
+        ML_ISA_INLINE void blockedPixels(const fp32 *x, const fp32 *w, const fp32 *bias, fp32 *out, size_t R, size_t S, size_t C,
+                                  size_t block, size_t row, size_t plane)
+        {
+            fp32 acc[N][B];
+            for (size_t j = 0; j < N; j++)
+                for (size_t k = 0; k < B; k++) acc[j][k] = bias[k];
+
+            for (size_t r = 0; r < R; r++)
+            {
+                for (size_t s = 0; s < S; s++)
+                {
+                    for (size_t c0 = 0; c0 < C; c0 += block)
+                    {
+                        const fp32 *xc = x + r * row + s * block + (c0 / block) * plane;
+                        const fp32 *wc = w + ((r * S + s) * C + c0) * B;
+                        const size_t n = std::min(block, C - c0);
+                        for (size_t c = 0; c < n; c++, wc += B)
+                        {
+                            for (size_t j = 0; j < N; j++)
+                            {
+                                const fp32 xv = xc[j * block + c];
+                                if (xv == 0.0f) continue;  // Most inputs after ReLU
+                                for (size_t k = 0; k < B; k++) acc[j][k] += xv * wc[k];
+                            }
+                        }
+                    }
+                }
+            }
+
+            for (size_t j = 0; j < N; j++)
+                for (size_t k = 0; k < B; k++) out[j * B + k] = std::max(0.0f, acc[j][k]);
+        }
+    }
+
+    void ConvolutionalLayer::computeBlockedRows(const LayerData &dataIn, size_t pBegin, size_t pEnd) const
+    {
+        if (getOutputParams().channelBlock() == 16) {
+            dispatchIsa(BlockedRowsKernel<16>{*this, dataIn, pBegin, pEnd});
+        } else {
+            dispatchIsa(BlockedRowsKernel<8>{*this, dataIn, pBegin, pEnd});
+        }
+    }
+
+    // Blocked convolution: output [M/B][P][Q][B] in strips of 4 pixels per block of B channels. The input is read
+    // through its own channel block, all C channels for the NHWC input of the first layer of a blocked run
+    template <size_t B>
+    void ConvolutionalLayer::computeBlockedRows(const LayerData &dataIn, size_t pBegin, size_t pEnd) const
+    {
+        constexpr size_t STRIP = 4;
+        const LayerParams &inParams = dataIn.getParams();
+        const auto &outputDims = getOutputParams().dims; // [H_out, W_out, C_out]
+
+        const size_t H = inParams.dims[0], W = inParams.dims[1], C = inParams.dims[2];
+        const size_t P = outputDims[0], Q = outputDims[1];
+        const size_t R = weightParam.dims[0], S = weightParam.dims[1];
+        const size_t block = inParams.channelBlock();
+        const size_t blocks = getOutputParams().channelBlocks();
+
+        const fp32* input = (const fp32*)dataIn.raw();
+        fp32* output = (fp32*)getOutputData().raw();
+
+        for (size_t mb = 0; mb < blocks; mb++)
+        {
+            const fp32* w = blockedWeights.data() + mb * R * S * C * B;
+            const fp32* bias = blockedBias.data() + mb * B;
+            for (size_t p = pBegin; p < pEnd; p++)
+            {
+                fp32* out = output + (mb * P + p) * Q * B;
+                size_t q = 0;
+                for (; q + STRIP <= Q; q += STRIP)
+                {
+                    blockedPixels<B, STRIP>(input + (p * W + q) * block, w, bias, out + q * B, R, S, C, block, W * block,
+                                            H * W * block);
+                }
+                for (; q < Q; q++)
+                {
+                    blockedPixels<B, 1>(input + (p * W + q) * block, w, bias, out + q * B, R, S, C, block, W * block,
+                                        H * W * block);
+                }
+            }
+        }
+    }
+
+    // Block-sparse convolution: every output pixel is the bias plus the stored weight blocks scaled by its input
+    // patch, read through the precomputed patch offsets. Block rows whose patch inputs are all zero are skipped
+    template <typename In, typename Out>
+    void ConvolutionalLayer::computeBlockSparseRows(const LayerData &dataIn, In in, Out out, size_t pBegin, size_t pEnd) const
+    {
+        const auto &inputDims = getInputParams().dims;   // [H, W, C_in]
+        const auto &outputDims = getOutputParams().dims; // [H_out, W_out, C_out]
+
+        size_t W = inputDims[1];
+        size_t C = inputDims[2];
+
+        size_t Q = outputDims[1];
+        size_t M = outputDims[2];
+
+        const typename In::type* input = (const typename In::type*)dataIn.raw();
+        typename Out::type* output = (typename Out::type*)getOutputData().raw();
+        const ui32* offsets = patchOffsets.data();
+
+        thread_local std::vector<fp32> sums;
+        sums.resize(sparseWeights.paddedCols);
+
+        for (size_t p = pBegin; p < pEnd; p++)
+        {
+            for (size_t q = 0; q < Q; q++)
+            {
+                const typename In::type* patch = input + (p * W + q) * C;
+                std::fill(sums.begin(), sums.end(), 0.0f);
+                std::memcpy(sums.data(), getBiasData().raw(), M * sizeof(fp32));
+                sparseWeights.multiplyAdd([&](size_t k) { return in.load(patch[offsets[k]]); }, sums.data());
+
+                // Apply ReLU activation
+                for (size_t m = 0; m < M; m++) output[(p * Q + q) * M + m] = out.store(std::max(0.0f, sums[m]));
+            }
+        }
+    }
+
+    // Compute the convolution using threads (output rows split across the shared pool)
     void ConvolutionalLayer::computeThreaded(const LayerData &dataIn) const
     {
-        // For simplicity, use naive implementation with thread hints
-        computeNaive(dataIn);
+        if (!blockedWeights.empty()) {
+            ThreadPool::shared().parallelFor(0, getOutputParams().dims[0], [&](size_t pBegin, size_t pEnd) {
+                computeBlockedRows(dataIn, pBegin, pEnd);
+            });
+            return;
+        }
+        const Dataflow selected = sparseWeights.empty() ? resolveDataflow(dataIn) : Dataflow::OUTPUT;
+        ThreadPool::shared().parallelFor(0, getOutputParams().dims[0], [&](size_t pBegin, size_t pEnd) {
+            if (!sparseWeights.empty()) {
+                withStorageCodecs(*this, BlockSparseRowsKernel{*this, dataIn, pBegin, pEnd});
+            } else {
+                withStorageCodecs(*this, RowsKernel{*this, dataIn, pBegin, pEnd, selected});
+            }
+        });
     }
 
-    // Compute the convolution using a tiled approach
+    // Compute the convolution tile by tile as scheduled by the layer's tile plan (dense fp32 weights and activations,
+    // anything else runs naive)
     void ConvolutionalLayer::computeTiled(const LayerData &dataIn) const
     {
-        // For simplicity, use naive implementation
-        computeNaive(dataIn);
+        if (tilePlan.empty() || getInputStorage() != Storage::FP32 || getOutputStorage() != Storage::FP32) {
+            computeNaive(dataIn);
+            return;
+        }
+        tileTraffic.store(runTiledPlan(tilePlan, (const fp32*)dataIn.raw(), (const fp32*)getWeightData().raw(),
+                                       (const fp32*)getBiasData().raw(), true, (fp32*)getOutputData().raw()));
     }
 
-    // Compute the convolution using SIMD
+    // Compute the convolution using SIMD: the row kernels of computeNaive already run in the widest instruction set
+    // (withStorageCodecs/dispatchIsa), vectorized across the output channels, so both paths share them
     void ConvolutionalLayer::computeSIMD(const LayerData &dataIn) const
     {
-        // For simplicity, use naive implementation
         computeNaive(dataIn);
     }
 
+    // Convolution with fp16/bf16 weights (threaded like computeThreaded when asked to, otherwise serial)
+    void ConvolutionalLayer::computeHalf(const LayerData &dataIn, InfType infType) const
+    {
+        if (infType == InfType::THREADED) {
+            ThreadPool::shared().parallelFor(0, getOutputParams().dims[0], [&](size_t pBegin, size_t pEnd) {
+                computeHalfRows(dataIn, pBegin, pEnd);
+            });
+        } else {
+            computeHalfRows(dataIn, 0, getOutputParams().dims[0]);
+        }
+    }
+
+    // Same decomposition as computeInt8Rows: each output is R contiguous dot products of length S*C against the
+    // [M][R][S][C] half weights
+    void ConvolutionalLayer::computeHalfRows(const LayerData &dataIn, size_t pBegin, size_t pEnd) const
+    {
+        const auto &inputDims = getInputParams().dims;   // [H, W, C_in]
+        const auto &outputDims = getOutputParams().dims; // [H_out, W_out, C_out]
+        const auto &weightDims = getWeightParams().dims; // [K_H, K_W, C_in, C_out]
+
+        size_t W = inputDims[1];
+        size_t C = inputDims[2];
+
+        size_t Q = outputDims[1];
+        size_t M = outputDims[2];
+
+        size_t R = weightDims[0];
+        size_t S = weightDims[1];
+
+        const fp32* input = (const fp32*)dataIn.raw();
+        fp32* output = (fp32*)getOutputData().raw();
+        const LayerData& bias = getBiasData();
+
+        for (size_t p = pBegin; p < pEnd; p++)
+        {
+            for (size_t q = 0; q < Q; q++)
+            {
+                for (size_t m = 0; m < M; m++)
+                {
+                    fp32 result = bias.get<fp32>(m);
+                    for (size_t r = 0; r < R; r++)
+                    {
+                        result += halfWeights.dot(input + ((p + r) * W + q) * C, m, r * S * C, S * C);
+                    }
+
+                    // Apply ReLU activation
+                    output[(p * Q + q) * M + m] = std::max(0.0f, result);
+                }
+            }
+        }
+    }
+
+    // Fixed-point convolution (threaded like computeThreaded when asked to, otherwise serial). There are no tiled or
+    // SIMD fixed-point kernels, so those are rejected rather than quietly timed as naive
+    void ConvolutionalLayer::computeFixed(const LayerData &dataIn, InfType infType) const
+    {
+        if (infType == InfType::TILED || infType == InfType::SIMD) {
+            throw std::runtime_error(getName() + ": fixed-point Conv layers run naive or threaded only, not " +
+                                     (infType == InfType::TILED ? "tiled" : "simd"));
+        }
+        if (infType == InfType::THREADED) {
+            ThreadPool::shared().parallelFor(0, getOutputParams().dims[0], [&](size_t pBegin, size_t pEnd) {
+                computeFixedRows(dataIn, pBegin, pEnd);
+            });
+        } else {
+            computeFixedRows(dataIn, 0, getOutputParams().dims[0]);
+        }
+    }
+
+    // Same loop nest as computeOutputRows on Q16.16 activations and Q(16-F).F weights
+    // Products are summed exactly in a 64 bit accumulator and only rounded once per output
+    void ConvolutionalLayer::computeFixedRows(const LayerData &dataIn, size_t pBegin, size_t pEnd) const
+    {
+        const auto &inputDims = getInputParams().dims;   // [H, W, C_in]
+        const auto &outputDims = getOutputParams().dims; // [H_out, W_out, C_out]
+        const auto &weightDims = getWeightParams().dims; // [K_H, K_W, C_in, C_out]
+
+        size_t U = 1; // Stride
+
+        size_t W = inputDims[1];
+        size_t C = inputDims[2];
+
+        size_t Q = outputDims[1];
+        size_t M = outputDims[2];
+
+        size_t R = weightDims[0];
+        size_t S = weightDims[1];
+
+        const FixedAct* input = (const FixedAct*)dataIn.raw();
+        FixedAct* output = (FixedAct*)getOutputData().raw();
+        const FixedWeight* weights = fixedWeights.weights.data();
+        const unsigned fracBits = fixedWeights.format.fracBits;
+
+        for (size_t p = pBegin; p < pEnd; p++)
+        {
+            for (size_t q = 0; q < Q; q++)
+            {
+                for (size_t m = 0; m < M; m++)
+                {
+                    FixedAcc result = fixedWeights.bias[m];
+
+                    for (size_t c = 0; c < C; c++)
+                    {
+                        for (size_t r = 0; r < R; r++)
+                        {
+                            for (size_t s = 0; s < S; s++)
+                            {
+                                size_t input_idx = (U * p + r) * W * C + (U * q + s) * C + c;
+                                size_t weight_idx = r * S * C * M + s * C * M + c * M + m;
+
+                                result += FixedAcc(input[input_idx].to_raw()) * weights[weight_idx];
+                            }
+                        }
+                    }
+
+                    // Apply ReLU activation
+                    result = std::max<FixedAcc>(0, result);
+
+                    size_t output_idx = p * Q * M + q * M + m;
+                    output[output_idx] = fromFixedAcc(result, fracBits);
+                }
+            }
+        }
+    }
+
+    // Int8 convolution (threaded like computeThreaded when asked to, offloaded for ACCEL, otherwise serial)
+    void ConvolutionalLayer::computeInt8(const LayerData &dataIn, InfType infType) const
+    {
+        if (infType == InfType::ACCEL) {
+            computeAccelerated(dataIn);
+        } else if (infType == InfType::THREADED) {
+            ThreadPool::shared().parallelFor(0, getOutputParams().dims[0], [&](size_t pBegin, size_t pEnd) {
+                computeInt8Rows(dataIn, pBegin, pEnd);
+            });
+        } else {
+            computeInt8Rows(dataIn, 0, getOutputParams().dims[0]);
+        }
+    }
+
+    // For a fixed (p, q) and kernel row r the input patch i[p+r][q..q+S-1][0..C-1] is S*C contiguous bytes, as is
+    // the matching slice of the [M][R][S][C] quantized weights, so each output is R contiguous dot products
+    void ConvolutionalLayer::computeInt8Rows(const LayerData &dataIn, size_t pBegin, size_t pEnd) const
+    {
+        const auto &inputDims = getInputParams().dims;   // [H, W, C_in]
+        const auto &outputDims = getOutputParams().dims; // [H_out, W_out, C_out]
+        const auto &weightDims = getWeightParams().dims; // [K_H, K_W, C_in, C_out]
+
+        size_t W = inputDims[1];
+        size_t C = inputDims[2];
+
+        size_t Q = outputDims[1];
+        size_t M = outputDims[2];
+
+        size_t R = weightDims[0];
+        size_t S = weightDims[1];
+
+        const ui8* input = (const ui8*)dataIn.raw();
+        ui8* output = (ui8*)getOutputData().raw();
+        const i8* weights = quantWeights.weights.data();
+        const size_t K = quantWeights.length;  // R*S*C
+
+        for (size_t p = pBegin; p < pEnd; p++)
+        {
+            for (size_t q = 0; q < Q; q++)
+            {
+                for (size_t m = 0; m < M; m++)
+                {
+                    i32 acc = quantWeights.bias[m];
+                    for (size_t r = 0; r < R; r++)
+                    {
+                        acc += dotU8S8(input + ((p + r) * W + q) * C, weights + m * K + r * S * C, S * C);
+                    }
+
+                    // Requantize and apply ReLU in the epilogue
+                    output[(p * Q + q) * M + m] = quantWeights.output(acc, m, true);
+                }
+            }
+        }
+    }
+
+    // The PS executes the layer's tile plan: each tile's input slab (its output rows plus the kernel halo) is copied into
+    // the scratchpad, then for every lane tile of the tile's output channels each output pixel's R*S*C patch (R rows of
+    // S*C contiguous bytes in the slab) becomes one stream, interleaved with the pre-packed weights unless they are
+    // resident, and the returned int32 sums are requantized. The next output row is packed on a helper thread while
+    // the current row streams
+    void ConvolutionalLayer::computeAccelerated(const LayerData &dataIn) const
+    {
+        const auto &inputDims = getInputParams().dims;   // [H, W, C_in]
+        const auto &outputDims = getOutputParams().dims; // [H_out, W_out, C_out]
+
+        size_t W = inputDims[1];
+        size_t C = inputDims[2];
+
+        size_t Q = outputDims[1];
+        size_t M = outputDims[2];
+
+        size_t R = getWeightParams().dims[0];
+
+        const ui8* input = (const ui8*)dataIn.raw();
+        ui8* output = (ui8*)getOutputData().raw();
+        const size_t K = quantWeights.length;  // R*S*C
+
+        MacAccelerator& accel = MacAccelerator::shared();
+        std::lock_guard<std::mutex> lock(accel.lock());
+        prepareAccelerated();
+        if (!accelWeights.matches(accel.getConfig())) throw std::runtime_error(getName() + ": accelerator reconfigured after its weights were packed");
+        const size_t lanes = accelWeights.lanes;
+        const size_t streamBytes = accelWeights.streamBytes();
+
+        TileTraffic traffic;
+        std::vector<ui8> slab(tilePlan.inputTileBytes);
+        DoubleBuffer staging(Q * streamBytes);
+        std::vector<i32> sums(lanes);
+        for (size_t i = 0; i < tilePlan.tiles.size(); i++)
+        {
+            const Tile &tile = tilePlan.tiles[i];
+            if (tilePlan.loadsInput(i))
+            {
+                const size_t bytes = (tile.rows + R - 1) * W * C;
+                std::memcpy(slab.data(), input + tile.p0 * W * C, bytes);
+                traffic.input += bytes;
+            }
+
+            for (size_t t = tile.m0 / lanes; t * lanes < tile.m0 + tile.channels; t++)
+            {
+                const ui8* weights = accelWeights.tile(t);
+                if (accelWeights.resident) {
+                    accel.loadWeights((const i8*)weights, K);
+                    traffic.weights += lanes * K;
+                }
+
+                const ui8* rows = slab.data();
+                staging.fillBack([this, rows, weights](ui8* out) { packAcceleratorRow(rows, weights, 0, out); });
+                staging.swap();
+                for (size_t row = 0; row < tile.rows; row++)
+                {
+                    const bool next = row + 1 < tile.rows;
+                    if (next) staging.fillBack([this, rows, weights, row](ui8* out) { packAcceleratorRow(rows, weights, row + 1, out); });
+
+                    const size_t p = tile.p0 + row;
+                    for (size_t q = 0; q < Q; q++)
+                    {
+                        accel.multiply(staging.front() + q * streamBytes, K, accelWeights.resident, sums.data());
+                        if (!accelWeights.resident) traffic.weights += lanes * K;
+
+                        for (size_t l = 0; l < lanes && t * lanes + l < M; l++)
+                        {
+                            const size_t m = t * lanes + l;
+                            output[(p * Q + q) * M + m] = quantWeights.output(quantWeights.bias[m] + sums[l], m, true);
+                        }
+                    }
+                    if (next) staging.swap();
+                }
+                traffic.output += tile.rows * Q * std::min(lanes, M - t * lanes);
+            }
+        }
+        tileTraffic.store(traffic);
+    }
+
+    void ConvolutionalLayer::packAcceleratorRow(const ui8* slab, const ui8* tile, size_t row, ui8* out) const
+    {
+        const auto &inputDims = getInputParams().dims;   // [H, W, C_in]
+        const auto &weightDims = getWeightParams().dims; // [K_H, K_W, C_in, C_out]
+
+        size_t W = inputDims[1];
+        size_t C = inputDims[2];
+        size_t Q = getOutputParams().dims[1];
+        size_t R = weightDims[0];
+        size_t S = weightDims[1];
+
+        const size_t K = quantWeights.length;
+        const size_t streamBytes = accelWeights.streamBytes();
+        const StreamPacker& packer = MacAccelerator::shared().getPacker();
+
+        std::vector<ui8> patch(accelWeights.resident ? 0 : K);
+        for (size_t q = 0; q < Q; q++)
+        {
+            ui8* stream = out + q * streamBytes;
+            ui8* activations = accelWeights.resident ? stream : patch.data();
+            for (size_t r = 0; r < R; r++)
+            {
+                std::memcpy(activations + r * S * C, slab + ((row + r) * W + q) * C, S * C);
+            }
+            if (!accelWeights.resident)
+            {
+                std::memcpy(stream, tile, streamBytes);
+                packer.insertActivations(patch.data(), K, stream);
+            }
+        }
+    }
+
 } // namespace ML
@@ -2,9 +2,13 @@
 
 #include <iostream>
 #include <algorithm>
+#include <cstring>
 #include <thread>
 #include <vector>
 
+#include "../Config.h"
+#include "../Accelerator.h"
+#include "../ThreadPool.h"
 #include "../Types.h"
 #include "../Utils.h"
 #include "Layer.h"
@@ -13,6 +17,26 @@ namespace ML
 {
 
     void DenseLayer::computeNaive(const LayerData &dataIn) const
+    {
+        if (rank) {
+            withStorageCodecs(*this, LowRankKernel{*this, dataIn});
+            return;
+        }
+        if (!sparseWeights.empty()) {
+            withStorageCodecs(*this, BlockSparseKernel{*this, dataIn});
+            return;
+        }
+        inputDensity.store(-1.0f, std::memory_order_relaxed);  // Only the SIMD path measures it
+        if (isStreamed()) {
+            withStorageCodecs(*this, StreamedKernel{*this, dataIn});
+            return;
+        }
+        withStorageCodecs(*this, OutputsKernel{*this, dataIn, 0, getOutputParams().flat_count()});
+    }
+
+    // Compute outputs [outBegin, outEnd)
+    template <typename In, typename Out>
+    void DenseLayer::computeOutputs(const LayerData &dataIn, In in, Out out, size_t outBegin, size_t outEnd) const
     {
         //const auto &inputDims = getInputParams().dims;   // Can be [H, W, C] or [features] 
         //const auto &outputDims = getOutputParams().dims; // Expected: [output_features]
@@ -39,12 +63,13 @@ namespace ML
         }
 
         const LayerData& weights = getWeightData();
-        LayerData& output = getOutputData();
         const LayerData& bias = getBiasData();
+        const typename In::type* input = (const typename In::type*)dataIn.raw();
+        typename Out::type* output = (typename Out::type*)getOutputData().raw();
 
         // Dense layer computation: output = input * weights + bias
         // Input is treated as flattened regardless of original dimensions
-        for (size_t out_idx = 0; out_idx < outputSize; out_idx++)
+        for (size_t out_idx = outBegin; out_idx < outEnd; out_idx++)
         {
             fp32 sum = bias.get<fp32>(out_idx);
 
@@ -53,7 +78,7 @@ namespace ML
                 // Weight matrix: [input_features, output_features]
                 size_t weightIdx = in_idx * outputSize + out_idx;
                 
-                sum += dataIn.get<fp32>(in_idx) * weights.get<fp32>(weightIdx);
+                sum += in.load(input[in_idx]) * weights.get<fp32>(weightIdx);
             }
 
             // Apply ReLU activation only for hidden layers (not the final layer before Softmax)
@@ -65,27 +90,383 @@ namespace ML
             }
             // For the final layer (outputSize == 10), don't apply ReLU
 
-            // Store result in output
-            output.get<fp32>(out_idx) = sum;
+            // Store result in output, rounded to the output storage
+            output[out_idx] = out.store(sum);
+        }
+    }
+
+    namespace {
+        // Partial sums of one streamed chunk, weight rows [k0, k0 + count). The chunk callback is an out-of-line
+        // std::function, so the accumulation is dispatched again to run in the same tier (and FMA contraction) as the
+        // resident computeOutputs
+        template <typename In>
+        struct StreamedChunk {
+            In in;
+            const typename In::type* input;
+            const fp32* weights;
+            size_t k0, count, outputSize;
+            fp32* sums;
+
+            ML_ISA_INLINE void operator()() const
+            {
+                for (size_t k = 0; k < count; k++)
+                {
+                    const fp32 x = in.load(input[k0 + k]);
+                    const fp32* row = weights + k * outputSize;
+                    for (size_t out_idx = 0; out_idx < outputSize; out_idx++) sums[out_idx] += x * row[out_idx];
+                }
+            }
+        };
+    }
+
+    // Each chunk holds weight rows [k0, k0 + count), one contiguous row of M weights per input, so the partial sums of
+    // a chunk are axpys; the stream reads the next chunk meanwhile
+    template <typename In, typename Out>
+    void DenseLayer::computeStreamed(const LayerData &dataIn, In in, Out out) const
+    {
+        size_t outputSize = getOutputParams().flat_count();
+
+        const typename In::type* input = (const typename In::type*)dataIn.raw();
+        typename Out::type* output = (typename Out::type*)getOutputData().raw();
+
+        std::vector<fp32> sums((const fp32*)getBiasData().raw(), (const fp32*)getBiasData().raw() + outputSize);
+        weightStream.forEachChunk([&](size_t k0, size_t count, const ui8* chunk) {
+            dispatchIsa(StreamedChunk<In>{in, input, (const fp32*)chunk, k0, count, outputSize, sums.data()});
+        });
+
+        for (size_t out_idx = 0; out_idx < outputSize; out_idx++)
+        {
+            // ReLU for hidden layers only, as in computeOutputs
+            fp32 sum = outputSize != 10 ? std::max(0.0f, sums[out_idx]) : sums[out_idx];
+            output[out_idx] = out.store(sum);
         }
     }
 
+    // Block-sparse weights: the bias plus, for every block row with a nonzero input, its stored blocks scaled by the
+    // inputs. Pruned layers are small enough that this stays serial on every path
+    template <typename In, typename Out>
+    void DenseLayer::computeBlockSparse(const LayerData &dataIn, In in, Out out) const
+    {
+        size_t totalInputFeatures = getInputParams().flat_count();
+        size_t outputSize = getOutputParams().flat_count();
+
+        const typename In::type* input = (const typename In::type*)dataIn.raw();
+        typename Out::type* output = (typename Out::type*)getOutputData().raw();
+
+        size_t count = 0;
+        for (size_t in_idx = 0; in_idx < totalInputFeatures; in_idx++) count += in.load(input[in_idx]) != 0.0f;
+        inputDensity.store(float(count) / totalInputFeatures, std::memory_order_relaxed);
+
+        thread_local std::vector<fp32> sums;
+        sums.assign(sparseWeights.paddedCols, 0.0f);
+        std::memcpy(sums.data(), getBiasData().raw(), outputSize * sizeof(fp32));
+        sparseWeights.multiplyAdd([&](size_t in_idx) { return in.load(input[in_idx]); }, sums.data());
+
+        for (size_t out_idx = 0; out_idx < outputSize; out_idx++)
+        {
+            // ReLU for hidden layers only, as in computeOutputs
+            fp32 sum = outputSize != 10 ? std::max(0.0f, sums[out_idx]) : sums[out_idx];
+            output[out_idx] = out.store(sum);
+        }
+    }
+
+    // Factored weights: the input is first projected onto the rank-k basis (one contiguous U row of length k per
+    // nonzero input) and the k coefficients then expand through V, K*k + k*M MACs instead of K*M. Serial on every path
+    template <typename In, typename Out>
+    void DenseLayer::computeLowRank(const LayerData &dataIn, In in, Out out) const
+    {
+        size_t totalInputFeatures = getInputParams().flat_count();
+        size_t outputSize = getOutputParams().flat_count();
+
+        const typename In::type* input = (const typename In::type*)dataIn.raw();
+        typename Out::type* output = (typename Out::type*)getOutputData().raw();
+        const fp32* u = (const fp32*)factorU.raw();
+        const fp32* v = (const fp32*)factorV.raw();
+
+        thread_local std::vector<fp32> coefficients, sums;
+        coefficients.assign(rank, 0.0f);
+        size_t count = 0;
+        for (size_t in_idx = 0; in_idx < totalInputFeatures; in_idx++)
+        {
+            const fp32 x = in.load(input[in_idx]);
+            if (x == 0.0f) continue;
+            axpy(coefficients.data(), x, u + in_idx * rank, rank);
+            count++;
+        }
+        inputDensity.store(float(count) / totalInputFeatures, std::memory_order_relaxed);
+
+        sums.resize(outputSize);
+        std::memcpy(sums.data(), getBiasData().raw(), outputSize * sizeof(fp32));
+        for (size_t j = 0; j < rank; j++) axpy(sums.data(), coefficients[j], v + j * outputSize, outputSize);
+
+        for (size_t out_idx = 0; out_idx < outputSize; out_idx++)
+        {
+            // ReLU for hidden layers only, as in computeOutputs
+            fp32 sum = outputSize != 10 ? std::max(0.0f, sums[out_idx]) : sums[out_idx];
+            output[out_idx] = out.store(sum);
+        }
+    }
+
+    // Output neurons split across the shared pool
     void DenseLayer::computeThreaded(const LayerData& dataIn) const {
-        // For simplicity, use naive implementation with thread hints
-        // TODO: Implement actual threading
-        computeNaive(dataIn);
+        if (rank || !sparseWeights.empty() || isStreamed()) {
+            computeNaive(dataIn);
+            return;
+        }
+        inputDensity.store(-1.0f, std::memory_order_relaxed);
+        ThreadPool::shared().parallelFor(0, getOutputParams().flat_count(), [&](size_t outBegin, size_t outEnd) {
+            withStorageCodecs(*this, OutputsKernel{*this, dataIn, outBegin, outEnd});
+        });
     }
 
+    // Dense layer tile by tile as scheduled by the layer's tile plan (input chunks x output columns of the weights),
+    // naive for block-sparse or low-rank weights and reduced activation storage
     void DenseLayer::computeTiled(const LayerData& dataIn) const {
-        // For simplicity, use naive implementation 
-        // TODO: Implement tiled matrix multiplication
-        computeNaive(dataIn);
+        if (tilePlan.empty() || getInputStorage() != Storage::FP32 || getOutputStorage() != Storage::FP32) {
+            computeNaive(dataIn);
+            return;
+        }
+
+        // ReLU for hidden layers only, as in computeOutputs
+        tileTraffic.store(runTiledPlan(tilePlan, (const fp32*)dataIn.raw(), (const fp32*)getWeightData().raw(),
+                                       (const fp32*)getBiasData().raw(), getOutputParams().flat_count() != 10, (fp32*)getOutputData().raw()));
+    }
+
+    namespace {
+        // y = bias + x W streamed over the rows of every input (dense) or of the `count` nonzero ones listed in `nonzero`
+        struct ZeroSkipGemv {
+            const fp32* input;
+            const fp32* weights;
+            const ui32* nonzero;
+            size_t count, totalInputFeatures, outputSize;
+            bool dense;
+            fp32* output;
+
+            ML_ISA_INLINE void operator()() const
+            {
+                if (dense) {
+                    size_t k = 0;
+                    for (; k + 4 <= totalInputFeatures; k += 4) {
+                        const fp32* row = weights + k * outputSize;
+                        axpy4(output, input + k, row, row + outputSize, row + 2 * outputSize, row + 3 * outputSize, outputSize);
+                    }
+                    for (; k < totalInputFeatures; k++) axpy(output, input[k], weights + k * outputSize, outputSize);
+                } else {
+                    size_t i = 0;
+                    for (; i + 4 <= count; i += 4) {
+                        const fp32 a[4] = {input[nonzero[i]], input[nonzero[i + 1]], input[nonzero[i + 2]], input[nonzero[i + 3]]};
+                        axpy4(output, a, weights + nonzero[i] * outputSize, weights + nonzero[i + 1] * outputSize,
+                              weights + nonzero[i + 2] * outputSize, weights + nonzero[i + 3] * outputSize, outputSize);
+                    }
+                    for (; i < count; i++) axpy(output, input[nonzero[i]], weights + nonzero[i] * outputSize, outputSize);
+                }
+            }
+        };
     }
 
+    // Zero-skipping GEMV: the output is the bias plus x[k] * W[k][0..M) for every nonzero input k, and each of those
+    // weight rows is contiguous. Post-ReLU inputs are mostly zero, so the nonzero indices are compacted first and only
+    // their rows are streamed; dense inputs stream every row without the index list
     void DenseLayer::computeSIMD(const LayerData& dataIn) const {
-        // For simplicity, use naive implementation
-        // TODO: Implement SIMD optimized matrix multiplication
-        computeNaive(dataIn);
+        if (rank || !sparseWeights.empty() || isStreamed() || getInputStorage() != Storage::FP32 || getOutputStorage() != Storage::FP32) {
+            computeNaive(dataIn);
+            return;
+        }
+
+        size_t totalInputFeatures = getInputParams().flat_count();
+        size_t outputSize = getOutputParams().flat_count();
+
+        const fp32* input = (const fp32*)dataIn.raw();
+        const fp32* weights = (const fp32*)getWeightData().raw();
+        fp32* output = (fp32*)getOutputData().raw();
+
+        thread_local std::vector<ui32> nonzero;
+        nonzero.resize(totalInputFeatures);
+        const size_t count = compactNonzero(input, totalInputFeatures, nonzero.data());
+        const float density = float(count) / totalInputFeatures;
+        inputDensity.store(density, std::memory_order_relaxed);
+
+        std::memcpy(output, getBiasData().raw(), outputSize * sizeof(fp32));
+        dispatchIsa(ZeroSkipGemv{input, weights, nonzero.data(), count, totalInputFeatures, outputSize,
+                                 density > Config::SPARSE_DENSITY_THRESHOLD, output});
+
+        // ReLU for hidden layers only, as in computeOutputs
+        if (outputSize != 10) {
+            for (size_t out_idx = 0; out_idx < outputSize; out_idx++) output[out_idx] = std::max(0.0f, output[out_idx]);
+        }
+    }
+
+    // Dense layer with fp16/bf16 weights (output neurons split across the pool for THREADED)
+    void DenseLayer::computeHalf(const LayerData& dataIn, InfType infType) const {
+        if (infType == InfType::THREADED) {
+            ThreadPool::shared().parallelFor(0, getOutputParams().flat_count(), [&](size_t outBegin, size_t outEnd) {
+                computeHalfOutputs(dataIn, outBegin, outEnd);
+            });
+        } else {
+            computeHalfOutputs(dataIn, 0, getOutputParams().flat_count());
+        }
+    }
+
+    // Weights are stored [output][input] at half the fp32 size, so each output streams one contiguous row and widens
+    // it in registers
+    void DenseLayer::computeHalfOutputs(const LayerData& dataIn, size_t outBegin, size_t outEnd) const {
+        size_t totalInputFeatures = getInputParams().flat_count();
+        size_t outputSize = getOutputParams().flat_count();
+
+        const fp32* input = (const fp32*)dataIn.raw();
+        const LayerData& bias = getBiasData();
+        LayerData& output = getOutputData();
+
+        for (size_t out_idx = outBegin; out_idx < outEnd; out_idx++)
+        {
+            fp32 sum = bias.get<fp32>(out_idx) + halfWeights.dot(input, out_idx, 0, totalInputFeatures);
+
+            // ReLU for hidden layers only, as in computeOutputs
+            if (outputSize != 10) {
+                sum = std::max(0.0f, sum);
+            }
+
+            output.get<fp32>(out_idx) = sum;
+        }
+    }
+
+    // Fixed-point dense layer (output neurons split across the pool for THREADED), no tiled or SIMD kernels
+    void DenseLayer::computeFixed(const LayerData& dataIn, InfType infType) const {
+        if (infType == InfType::TILED || infType == InfType::SIMD) {
+            throw std::runtime_error(getName() + ": fixed-point Dense layers run naive or threaded only, not " +
+                                     (infType == InfType::TILED ? "tiled" : "simd"));
+        }
+        if (infType == InfType::THREADED) {
+            ThreadPool::shared().parallelFor(0, getOutputParams().flat_count(), [&](size_t outBegin, size_t outEnd) {
+                computeFixedOutputs(dataIn, outBegin, outEnd);
+            });
+        } else {
+            computeFixedOutputs(dataIn, 0, getOutputParams().flat_count());
+        }
+    }
+
+    // Same as computeOutputs on Q16.16 activations with a 64 bit accumulator
+    void DenseLayer::computeFixedOutputs(const LayerData& dataIn, size_t outBegin, size_t outEnd) const {
+        size_t totalInputFeatures = getInputParams().flat_count();
+        size_t outputSize = getOutputParams().flat_count();
+
+        const FixedAct* input = (const FixedAct*)dataIn.raw();
+        FixedAct* output = (FixedAct*)getOutputData().raw();
+        const FixedWeight* weights = fixedWeights.weights.data();
+        const unsigned fracBits = fixedWeights.format.fracBits;
+
+        for (size_t out_idx = outBegin; out_idx < outEnd; out_idx++)
+        {
+            FixedAcc sum = fixedWeights.bias[out_idx];
+
+            for (size_t in_idx = 0; in_idx < totalInputFeatures; in_idx++)
+            {
+                sum += FixedAcc(input[in_idx].to_raw()) * weights[in_idx * outputSize + out_idx];
+            }
+
+            // ReLU for hidden layers only, as in computeOutputs
+            if (outputSize != 10) {
+                sum = std::max<FixedAcc>(0, sum);
+            }
+
+            output[out_idx] = fromFixedAcc(sum, fracBits);
+        }
+    }
+
+    // Int8 dense layer (output neurons split across the pool for THREADED, offloaded for ACCEL)
+    void DenseLayer::computeInt8(const LayerData& dataIn, InfType infType) const {
+        if (infType == InfType::ACCEL) {
+            computeAccelerated(dataIn);
+        } else if (infType == InfType::THREADED) {
+            ThreadPool::shared().parallelFor(0, getOutputParams().flat_count(), [&](size_t outBegin, size_t outEnd) {
+                computeInt8Outputs(dataIn, outBegin, outEnd);
+            });
+        } else {
+            computeInt8Outputs(dataIn, 0, getOutputParams().flat_count());
+        }
+    }
+
+    // Weights are stored [output][input], so each output is one contiguous dot product over the input
+    void DenseLayer::computeInt8Outputs(const LayerData& dataIn, size_t outBegin, size_t outEnd) const {
+        size_t totalInputFeatures = getInputParams().flat_count();
+        size_t outputSize = getOutputParams().flat_count();
+
+        const ui8* input = (const ui8*)dataIn.raw();
+        ui8* output = (ui8*)getOutputData().raw();
+        const i8* weights = quantWeights.weights.data();
+
+        for (size_t out_idx = outBegin; out_idx < outEnd; out_idx++)
+        {
+            i32 acc = quantWeights.bias[out_idx] + dotU8S8(input, weights + out_idx * totalInputFeatures, totalInputFeatures);
+
+            // Requantize in the epilogue, ReLU for hidden layers only as in computeOutputs
+            output[out_idx] = quantWeights.output(acc, out_idx, outputSize != 10);
+        }
+    }
+
+    // The input is copied into the scratchpad once and streamed once per lane tile of outputs, in the order of the
+    // layer's tile plan: as is after loading the lane tile's resident weights, otherwise inserted into its pre-packed
+    // stream image, the next lane tile's stream being packed while one streams
+    void DenseLayer::computeAccelerated(const LayerData& dataIn) const {
+        size_t totalInputFeatures = getInputParams().flat_count();
+        size_t outputSize = getOutputParams().flat_count();
+
+        ui8* output = (ui8*)getOutputData().raw();
+
+        MacAccelerator& accel = MacAccelerator::shared();
+        std::lock_guard<std::mutex> lock(accel.lock());
+        prepareAccelerated();
+        if (!accelWeights.matches(accel.getConfig())) throw std::runtime_error(getName() + ": accelerator reconfigured after its weights were packed");
+        const size_t lanes = accelWeights.lanes;
+        const size_t streamBytes = accelWeights.streamBytes();
+        const StreamPacker& packer = accel.getPacker();
+
+        TileTraffic traffic;
+        const std::vector<ui8> slab((const ui8*)dataIn.raw(), (const ui8*)dataIn.raw() + totalInputFeatures);
+        traffic.input += totalInputFeatures;
+
+        std::vector<size_t> laneTiles;
+        for (const Tile& tile : tilePlan.tiles) {
+            for (size_t t = tile.m0 / lanes; t * lanes < tile.m0 + tile.channels; t++) laneTiles.push_back(t);
+        }
+
+        const ui8* input = slab.data();
+        const AcceleratorWeights& packed = accelWeights;
+        const auto packTile = [&packed, &packer, input, totalInputFeatures, streamBytes](size_t t) {
+            return [&packed, &packer, input, totalInputFeatures, streamBytes, t](ui8* out) {
+                std::memcpy(out, packed.tile(t), streamBytes);
+                packer.insertActivations(input, totalInputFeatures, out);
+            };
+        };
+
+        DoubleBuffer staging(accelWeights.resident ? 0 : streamBytes);
+        if (!accelWeights.resident) {
+            staging.fillBack(packTile(laneTiles[0]));
+            staging.swap();
+        }
+        std::vector<i32> sums(lanes);
+        for (size_t j = 0; j < laneTiles.size(); j++)
+        {
+            const size_t t = laneTiles[j];
+            const bool next = j + 1 < laneTiles.size();
+            if (accelWeights.resident) {
+                accel.loadWeights((const i8*)accelWeights.tile(t), totalInputFeatures);
+                accel.multiply(input, totalInputFeatures, true, sums.data());
+            } else {
+                if (next) staging.fillBack(packTile(laneTiles[j + 1]));
+                accel.multiply(staging.front(), totalInputFeatures, false, sums.data());
+            }
+            traffic.weights += lanes * totalInputFeatures;
+
+            for (size_t l = 0; l < lanes && t * lanes + l < outputSize; l++)
+            {
+                const size_t out_idx = t * lanes + l;
+                output[out_idx] = quantWeights.output(quantWeights.bias[out_idx] + sums[l], out_idx, outputSize != 10);
+            }
+            traffic.output += std::min(lanes, outputSize - t * lanes);
+            if (!accelWeights.resident && next) staging.swap();
+        }
+        tileTraffic.store(traffic);
     }
 
-}
\ No newline at end of file
+}
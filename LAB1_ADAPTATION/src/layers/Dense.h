@@ -1,7 +1,18 @@
 #pragma once
 
+#include <atomic>
+#include <limits>
+
+#include "../Accelerator.h"
+#include "../Activations.h"
+#include "../Config.h"
+#include "../FixedPoint.h"
+#include "../Half.h"
+#include "../Quantization.h"
+#include "../Sparse.h"
 #include "../Types.h"
 #include "../Utils.h"
+#include "../WeightStream.h"
 #include "Layer.h"
 
 namespace ML {
@@ -19,12 +30,67 @@ class DenseLayer : public Layer {
     const LayerParams& getBiasParams() const { return biasParam; }
     const LayerData& getWeightData() const { return weightData; }
     const LayerData& getBiasData() const { return biasData; }
+    const FixedWeights& getFixedWeights() const { return fixedWeights; }
+    const QuantizedWeights& getQuantizedWeights() const { return quantWeights; }
+    std::size_t getRank() const { return rank; }
+    bool isStreamed() const { return weightStream.isOpen(); }
+
+    // Run as the low-rank product x U V (U [K][rank], V [rank][M], written by `ml factor`) instead of the full weights
+    void setLowRank(std::size_t factorRank, const Path& uPath, const Path& vPath) {
+        rank = factorRank;
+        factorU.setParams(LayerParams(sizeof(fp32), {weightParam.dims[0], rank}, uPath));
+        factorV.setParams(LayerParams(sizeof(fp32), {rank, weightParam.dims[1]}, vPath));
+    }
+
+    // Runs in fp32, fp32 with fp16/bf16 weights (widened in registers), fixed point (weights converted to a per-layer
+    // Q-format at load) or int8 (per-channel weight scales)
+    virtual bool supportsPrecision(Precision p) const override {
+        if (rank) return p == Precision::FP32;  // Low-rank factors are fp32 only
+        return p == Precision::FP32 || p == Precision::FP16 || p == Precision::BF16 || p == Precision::FIXED ||
+               p == Precision::INT8;
+    }
+
+    // fp32 layers can keep their input and output as fp16 or uint8 (widened on load, rounded in the epilogue)
+    virtual bool supportsStorage(Storage s) const override { return s == Storage::FP32 || getPrecision() == Precision::FP32; }
+
+    // One MAC per weight, or per factor element when low-rank
+    virtual ui64 getMACs() const override { return rank ? factorU.getParams().flat_count() + factorV.getParams().flat_count() : weightParam.flat_count(); }
+
+    // Measured by the zero-skipping SIMD, block-sparse and low-rank paths
+    virtual float getInputDensity() const override { return inputDensity.load(std::memory_order_relaxed); }
+
+    virtual const TilePlan* getTilePlan() const override { return tilePlan.empty() ? nullptr : &tilePlan; }
+    virtual TileTraffic getTileTraffic() const override { return tileTraffic.load(); }
 
     // Allocate all resources needed for the layer & Load all of the required data for the layer
     virtual void allocLayer() override {
         Layer::allocLayer();
-        weightData.loadData();
         biasData.loadData();
+        if (rank) {
+            factorU.loadData();
+            factorV.loadData();
+            return;
+        }
+        if (getPrecision() == Precision::FP32 && getWeightMemoryLimit() && weightParam.byte_size() > getWeightMemoryLimit()) {
+            openWeightStream();
+            return;
+        }
+        weightData.loadData();
+        if (getPrecision() == Precision::FP16 || getPrecision() == Precision::BF16) {
+            halfWeights.load(weightData, biasParam.flat_count(), getPrecision());
+            weightData.freeData();  // Half layers only ever run computeHalf
+        }
+        if (getPrecision() == Precision::FIXED) {
+            fixedWeights.load(weightData, biasData);
+            weightData.freeData();  // Fixed layers only ever run computeFixed
+            logInfo(getName() + ": fixed-point weights " + fixedWeights.format.str());
+        }
+        if (getPrecision() == Precision::INT8) {
+            quantWeights.load(weightData, biasData, getInputQuant(), getOutputQuant());
+            weightData.freeData();  // Int8 layers only ever run computeInt8, the ACCEL packing is built from quantWeights
+        }
+        if (getPrecision() == Precision::FP32) loadBlockSparse();
+        planTiling();
     }
 
     // Free all resources allocated for the layer
@@ -32,6 +98,15 @@ class DenseLayer : public Layer {
         Layer::freeLayer();
         weightData.freeData();
         biasData.freeData();
+        halfWeights.clear();
+        fixedWeights.clear();
+        quantWeights.clear();
+        accelWeights.clear();
+        sparseWeights.clear();
+        tilePlan = TilePlan();
+        factorU.freeData();
+        factorV.freeData();
+        weightStream.close();
     }
 
     // Virtual functions
@@ -39,13 +114,149 @@ class DenseLayer : public Layer {
     virtual void computeThreaded(const LayerData& dataIn) const override;
     virtual void computeTiled(const LayerData& dataIn) const override;
     virtual void computeSIMD(const LayerData& dataIn) const override;
+    virtual void computeHalf(const LayerData& dataIn, InfType infType) const override;
+    virtual void computeFixed(const LayerData& dataIn, InfType infType) const override;
+    virtual void computeInt8(const LayerData& dataIn, InfType infType) const override;
 
    private:
+    // Keep the [K][M] fp32 weights block-sparse instead when few enough blocks are nonzero (e.g. after `ml prune`)
+    void loadBlockSparse() {
+        const std::size_t cols = biasParam.flat_count();
+        const std::size_t rows = weightParam.flat_count() / cols;
+        const BlockShape block;
+        const float density = blockDensity((const fp32*)weightData.raw(), rows, cols, block);
+        if (density > Config::BLOCK_SPARSE_DENSITY_THRESHOLD) return;
+
+        sparseWeights.load((const fp32*)weightData.raw(), rows, cols, block);
+        weightData.freeData();
+        logInfo(getName() + ": block-sparse weights " + block.str() + ", " + std::to_string(int(density * 100 + 0.5f)) +
+                "% of blocks kept (" + std::to_string(sparseWeights.bytes()) + " bytes)");
+    }
+
+    // Read the [K][M] fp32 weights from their file in chunks of input rows during inference, within the memory limit
+    void openWeightStream() {
+        const std::size_t K = weightParam.dims[0], M = weightParam.dims[1];
+        weightStream.open(weightParam.filePath, K, M * sizeof(fp32), getWeightMemoryLimit());
+        logInfo(getName() + ": streaming " + std::to_string(weightParam.byte_size()) + " B of weights in " +
+                std::to_string(weightStream.getChunks()) + " chunks of " + std::to_string(weightStream.getChunkRows()) + " rows (" +
+                std::to_string(weightStream.peakBytes()) + " B resident)");
+    }
+
+    // Plan the tiles of the TILED path (dense fp32 weights) or of the ACCEL path (int8, whole dot products per lane
+    // tile) for the current budget, untiled with a warning when the budget cannot hold a single output
+    void planTiling() const {
+        TileShape shape = TileShape::dense(getInputParams().flat_count(), getOutputParams().flat_count(), sizeof(fp32));
+        TileConstraints constraints;
+        if (getPrecision() == Precision::INT8) {
+            if (!accelWeights.lanes) return;  // Planned by prepareAccelerated()
+            shape.elementSize = sizeof(ui8);
+            constraints.splitInputChannels = false;
+            constraints.channelMultiple = accelWeights.lanes;
+        } else if (getPrecision() != Precision::FP32 || !sparseWeights.empty()) {
+            return;
+        } else {
+            constraints.channelMultiple = Config::TILE_CHANNEL_MULTIPLE;
+        }
+        try {
+            tilePlan = planTiles(shape, getTileBudget(), constraints);
+        } catch (const std::runtime_error& e) {
+            logWarn(getName() + ": " + e.what() + ", running untiled");
+            tilePlan = planTiles(shape, std::numeric_limits<std::size_t>::max(), constraints);
+        }
+    }
+
+    // Block-sparse GEMV: bias plus the stored weight blocks of every nonzero input block row
+    template <typename In, typename Out> ML_ISA_INLINE void computeBlockSparse(const LayerData& dataIn, In in, Out out) const;
+
+    // computeBlockSparse bound to the storage codecs picked at run time
+    struct BlockSparseKernel {
+        const DenseLayer& layer;
+        const LayerData& dataIn;
+
+        template <typename In, typename Out> ML_ISA_INLINE void operator()(In in, Out out) const { layer.computeBlockSparse(dataIn, in, out); }
+    };
+
+    // Naive dot products for outputs [outBegin, outEnd), shared by the naive and threaded paths
+    // In/Out are the codecs of the stored input and output activations
+    template <typename In, typename Out>
+    ML_ISA_INLINE void computeOutputs(const LayerData& dataIn, In in, Out out, std::size_t outBegin, std::size_t outEnd) const;
+
+    // computeOutputs bound to the storage codecs picked at run time
+    struct OutputsKernel {
+        const DenseLayer& layer;
+        const LayerData& dataIn;
+        std::size_t outBegin, outEnd;
+
+        template <typename In, typename Out> ML_ISA_INLINE void operator()(In in, Out out) const {
+            layer.computeOutputs(dataIn, in, out, outBegin, outEnd);
+        }
+    };
+
+    // GEMV over streamed weight chunks: the partial sums of each chunk's input rows are added in input order, the
+    // same operations as computeOutputs so the result is identical to the resident weights
+    template <typename In, typename Out> ML_ISA_INLINE void computeStreamed(const LayerData& dataIn, In in, Out out) const;
+
+    // computeStreamed bound to the storage codecs picked at run time
+    struct StreamedKernel {
+        const DenseLayer& layer;
+        const LayerData& dataIn;
+
+        template <typename In, typename Out> ML_ISA_INLINE void operator()(In in, Out out) const { layer.computeStreamed(dataIn, in, out); }
+    };
+
+    // Low-rank GEMV: t = x U over the nonzero inputs, then bias + t V
+    template <typename In, typename Out> ML_ISA_INLINE void computeLowRank(const LayerData& dataIn, In in, Out out) const;
+
+    // computeLowRank bound to the storage codecs picked at run time
+    struct LowRankKernel {
+        const DenseLayer& layer;
+        const LayerData& dataIn;
+
+        template <typename In, typename Out> ML_ISA_INLINE void operator()(In in, Out out) const { layer.computeLowRank(dataIn, in, out); }
+    };
+
+    // Dot products for outputs [outBegin, outEnd) widening fp16/bf16 weights
+    void computeHalfOutputs(const LayerData& dataIn, std::size_t outBegin, std::size_t outEnd) const;
+
+    // Fixed-point dot products for outputs [outBegin, outEnd)
+    void computeFixedOutputs(const LayerData& dataIn, std::size_t outBegin, std::size_t outEnd) const;
+
+    // Int8 dot products for outputs [outBegin, outEnd)
+    void computeInt8Outputs(const LayerData& dataIn, std::size_t outBegin, std::size_t outEnd) const;
+
+    // Pack quantWeights for the accelerator and plan its lane tiles on the first ACCEL run, so int8 layers that
+    // never run there do not hold them. Called with the accelerator locked
+    void prepareAccelerated() const {
+        if (accelWeights.lanes) return;
+        const MacAccelerator& accel = MacAccelerator::shared();
+        accelWeights.load(quantWeights, accel.getConfig(), accel.getPacker());
+        planTiling();
+    }
+
+    // Int8 dense layer on the MAC accelerator emulator, one transaction per tile of outputs
+    void computeAccelerated(const LayerData& dataIn) const;
+
     LayerParams weightParam;
     LayerData weightData;
 
     LayerParams biasParam;
     LayerData biasData;
+
+    HalfWeights halfWeights;
+    FixedWeights fixedWeights;
+    QuantizedWeights quantWeights;
+    mutable AcceleratorWeights accelWeights;  // quantWeights pre-packed by the first ACCEL run
+    BlockSparseWeights sparseWeights;  // Loaded instead of the dense fp32 weights when they are mostly zero blocks
+
+    mutable TilePlan tilePlan;  // TILED plan from allocLayer(), or the ACCEL plan from its first run
+    mutable TileTrafficCounter tileTraffic;
+    mutable WeightStream weightStream;  // Open instead of weightData when the weights exceed the memory limit
+
+    std::size_t rank = 0;  // Nonzero when running the low-rank factors instead of the weights
+    LayerData factorU{LayerParams(sizeof(fp32), {})};
+    LayerData factorV{LayerParams(sizeof(fp32), {})};
+
+    mutable std::atomic<float> inputDensity{-1.0f};
 };
 
 }  // namespace ML
@@ -26,9 +26,13 @@ namespace ML
         }
 
         LayerData& output = getOutputData();
-        
+
         // Simply copy the data (flattening is just a reshape operation)
-        std::memcpy(output.raw(), dataIn.raw(), inputElements * sizeof(fp32));
+        if (getInputStorage() == getOutputStorage()) {
+            std::memcpy(output.raw(), dataIn.raw(), getInputParams().byte_size());
+        } else {
+            convertStorage(dataIn, getInputStorage(), getInputQuant(), output, getOutputStorage(), getOutputQuant());
+        }
     }
 
     void FlattenLayer::computeThreaded(const LayerData& dataIn) const {
@@ -46,4 +50,13 @@ namespace ML
         computeNaive(dataIn);
     }
 
+    void FlattenLayer::computeFixed(const LayerData& dataIn, InfType) const {
+        // Same copy, the element format is irrelevant
+        computeNaive(dataIn);
+    }
+
+    void FlattenLayer::computeInt8(const LayerData& dataIn, InfType) const {
+        computeNaive(dataIn);
+    }
+
 }
\ No newline at end of file
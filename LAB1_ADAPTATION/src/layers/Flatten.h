@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../Activations.h"
 #include "../Types.h"
 #include "../Utils.h"
 #include "Layer.h"
@@ -8,13 +9,21 @@ namespace ML {
 class FlattenLayer : public Layer {
    public:
     FlattenLayer(const LayerParams inParams, const LayerParams outParams)
-        : Layer(inParams, outParams, LayerType::DENSE) {}  // Use DENSE type as closest match
+        : Layer(inParams, outParams, LayerType::FLATTEN) {}
+
+    // Flattening only moves bytes, so any activation format passes through unchanged (fp16/bf16 have no weights to store)
+    virtual bool supportsPrecision(Precision p) const override { return p != Precision::FP16 && p != Precision::BF16; }
+
+    // Stored activations are copied as they are, or converted when the consumer stores them differently
+    virtual bool supportsStorage(Storage s) const override { return s == Storage::FP32 || getPrecision() == Precision::FP32; }
 
     // Virtual functions
     virtual void computeNaive(const LayerData& dataIn) const override;
     virtual void computeThreaded(const LayerData& dataIn) const override;
     virtual void computeTiled(const LayerData& dataIn) const override;
     virtual void computeSIMD(const LayerData& dataIn) const override;
+    virtual void computeFixed(const LayerData& dataIn, InfType infType) const override;
+    virtual void computeInt8(const LayerData& dataIn, InfType infType) const override;
 };
 
 }  // namespace ML
\ No newline at end of file
@@ -11,6 +11,7 @@ namespace ML {
 bool LayerParams::isCompatible(const LayerParams& params) const {
     if (elementSize != params.elementSize) throw std::runtime_error("Element Size of params must match");
     if (dims.size() != params.dims.size()) throw std::runtime_error("Must have the same number of dimentions");
+    if (layout != params.layout) throw std::runtime_error("Layout of params must match");
     for (std::size_t i = 0; i < dims.size(); i++) {
         if (dims[i] != params.dims[i]) throw std::runtime_error("Each dimention must match");
         if (dims[i] != params.dims[i]) return false;
@@ -19,7 +20,168 @@ bool LayerParams::isCompatible(const LayerParams& params) const {
     return elementSize == params.elementSize && dims.size() == params.dims.size();
 }
 
+// Printable name of a layout
+const char* layoutName(Layout layout) {
+    switch (layout) {
+    case Layout::NHWC:
+        return "nhwc";
+    case Layout::NCHW8C:
+        return "nchw8c";
+    case Layout::NCHW16C:
+        return "nchw16c";
+    default:
+        return "unknown";
+    }
+}
+
+Layout parseLayout(const std::string& name) {
+    for (Layout layout : {Layout::NHWC, Layout::NCHW8C, Layout::NCHW16C}) {
+        if (name == layoutName(layout)) return layout;
+    }
+    throw std::runtime_error("Unknown layout: " + name);
+}
+
 // Ensure that data being inputted is of the correct size and shape that the layer expects
 bool Layer::checkDataInputCompatibility(const LayerData& data) const { return inParams.isCompatible(data.getParams()); }
 
+// Printable name of a layer type
+const char* Layer::typeName(LayerType lType) {
+    switch (lType) {
+    case LayerType::CONVOLUTIONAL:
+        return "Convolutional";
+    case LayerType::DENSE:
+        return "Dense";
+    case LayerType::SOFTMAX:
+        return "Softmax";
+    case LayerType::MAX_POOLING:
+        return "MaxPooling";
+    case LayerType::FLATTEN:
+        return "Flatten";
+    case LayerType::CONVERT:
+        return "Convert";
+    case LayerType::CLASSIFIER_HEAD:
+        return "ClassifierHead";
+    default:
+        return "None";
+    }
+}
+
+// Printable name of a precision
+const char* Layer::precisionName(Precision precision) {
+    switch (precision) {
+    case Precision::FP32:
+        return "fp32";
+    case Precision::FP16:
+        return "fp16";
+    case Precision::BF16:
+        return "bf16";
+    case Precision::FIXED:
+        return "fixed";
+    case Precision::INT8:
+        return "int8";
+    default:
+        return "unknown";
+    }
+}
+
+Layer::Precision Layer::parsePrecision(const std::string& name) {
+    for (Precision precision : {Precision::FP32, Precision::FP16, Precision::BF16, Precision::FIXED, Precision::INT8}) {
+        if (name == precisionName(precision)) return precision;
+    }
+    throw std::runtime_error("Unknown precision: " + name);
+}
+
+Layer::Precision Layer::activationFormat(Precision precision) {
+    return precision == Precision::FP16 || precision == Precision::BF16 ? Precision::FP32 : precision;
+}
+
+// Bytes per activation element in a precision
+std::size_t Layer::elementSize(Precision precision) {
+    switch (precision) {
+    case Precision::INT8:
+        return sizeof(ui8);
+    default:
+        return sizeof(fp32);  // fp32 and Q16.16
+    }
+}
+
+void Layer::setPrecision(Precision p) {
+    if (!supportsPrecision(p)) {
+        throw std::runtime_error(std::string(typeName(lType)) + " layer `" + name + "` does not support " + precisionName(p) + " precision");
+    }
+    precision = p;
+    inStorage = outStorage = Storage::FP32;
+    inParams.layout = outParams.layout = Layout::NHWC;
+    setElementSizes(elementSize(p), elementSize(p));
+}
+
+// Printable name of a storage format
+const char* Layer::storageName(Storage storage) {
+    switch (storage) {
+    case Storage::FP32:
+        return "fp32";
+    case Storage::FP16:
+        return "fp16";
+    case Storage::U8:
+        return "u8";
+    default:
+        return "unknown";
+    }
+}
+
+Layer::Storage Layer::parseStorage(const std::string& name) {
+    for (Storage storage : {Storage::FP32, Storage::FP16, Storage::U8}) {
+        if (name == storageName(storage)) return storage;
+    }
+    throw std::runtime_error("Unknown activation storage: " + name);
+}
+
+std::size_t Layer::storageSize(Storage storage) {
+    switch (storage) {
+    case Storage::FP16:
+        return sizeof(fp16);
+    case Storage::U8:
+        return sizeof(ui8);
+    default:
+        return sizeof(fp32);
+    }
+}
+
+void Layer::setStorage(Storage in, Storage out) {
+    if (!supportsStorage(in) || !supportsStorage(out)) {
+        throw std::runtime_error(std::string(typeName(lType)) + " layer `" + name + "` cannot store activations as " +
+                                 storageName(supportsStorage(in) ? out : in));
+    }
+    inStorage = in;
+    outStorage = out;
+    setElementSizes(storageSize(in), storageSize(out));
+}
+
+void Layer::setLayout(Layout in, Layout out) {
+    if (!supportsLayout(in, out)) {
+        throw std::runtime_error(std::string(typeName(lType)) + " layer `" + name + "` cannot map " + layoutName(in) + " to " + layoutName(out));
+    }
+    inParams.layout = in;
+    outParams.layout = out;
+    outData.setParams(outParams);
+}
+
+void Layer::setElementSizes(std::size_t inSize, std::size_t outSize) {
+    inParams.elementSize = inSize;
+    outParams.elementSize = outSize;
+    outData.setParams(outParams);
+}
+
+void Layer::computeHalf(const LayerData&, InfType) const {
+    throw std::runtime_error(std::string(typeName(lType)) + " layer `" + name + "` has no fp16/bf16 weight implementation");
+}
+
+void Layer::computeFixed(const LayerData&, InfType) const {
+    throw std::runtime_error(std::string(typeName(lType)) + " layer `" + name + "` has no fixed-point implementation");
+}
+
+void Layer::computeInt8(const LayerData&, InfType) const {
+    throw std::runtime_error(std::string(typeName(lType)) + " layer `" + name + "` has no int8 implementation");
+}
+
 }  // namespace ML
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
 #include <vector>
 #include <cstring>
 #include <memory>
@@ -7,10 +9,20 @@
 
 #include "../Config.h"
 #include "../Utils.h"
+#include "../Tiling.h"
 #include "../Types.h"
 
 namespace ML {
 
+// Memory order of [H][W][C] activations. NHWC keeps all channels of a pixel together; the blocked NCHW8c/NCHW16c
+// layouts store [C/b][H][W][b], blocks of 8/16 channels with the last one zero padded, so a kernel's innermost loop
+// reads one vector-width block of channels. Dims stay [H][W][C] in every layout
+enum class Layout { NHWC, NCHW8C, NCHW16C };
+
+// Printable name of a layout and its inverse (throws on unknown names)
+const char* layoutName(Layout layout);
+Layout parseLayout(const std::string& name);
+
 // Layer Parameter structure
 class LayerParams {
    public:
@@ -20,11 +32,26 @@ class LayerParams {
 
     bool isCompatible(const LayerParams& params) const;
 
+    // Channels stored together per pixel: all of them in NHWC, one block in the blocked layouts
+    inline size_t channelBlock() const {
+        switch (layout) {
+        case Layout::NCHW8C:
+            return 8;
+        case Layout::NCHW16C:
+            return 16;
+        default:
+            return dims.empty() ? 1 : dims.back();
+        }
+    }
+    inline size_t channelBlocks() const { return dims.empty() ? 1 : (dims.back() + channelBlock() - 1) / channelBlock(); }
+
+    // Stored elements, including the padding of a blocked layout
     inline size_t flat_count() const {
         size_t size = 1;
         for (auto dim : dims) {
             size *= dim;
         }
+        if (layout != Layout::NHWC) size = size / dims.back() * channelBlocks() * channelBlock();
         return size;
     }
 
@@ -33,26 +60,49 @@ class LayerParams {
     }
 
    public:
-    const std::size_t elementSize;
-    const std::vector<std::size_t> dims;
-    const Path filePath;
+    std::size_t elementSize;
+    std::vector<std::size_t> dims;
+    Path filePath;
+    Layout layout = Layout::NHWC;
+};
+
+// Error metrics between two Layer Data arrays
+struct CompareStats {
+    float maxAbs = 0;   // Largest absolute element difference
+    float meanAbs = 0;  // Mean absolute element difference
+    float cosine = 0;   // Cosine similarity
+};
+
+// Affine mapping of quantized activations: real = scale * (q - zeroPoint)
+struct QuantParams {
+    float scale = 1;
+    i32 zeroPoint = 0;
 };
 
 // Output data container of a layer inference
 class LayerData {
    public:
     inline LayerData(const LayerParams& params) : params(params) {}
-    inline LayerData(const LayerParams& params, const Path path) : params(params.elementSize, params.dims, path) {}
+    inline LayerData(const LayerParams& params, const Path path) : params(params.elementSize, params.dims, path) {
+        this->params.layout = params.layout;
+    }
 
     inline LayerData(const LayerData& other) : params(other.params) {
         allocData();
-        std::memcpy(data.get(), other.data.get(), params.byte_size());
+        std::memcpy(ptr(), other.ptr(), params.byte_size());
     }
 
-    inline bool isAlloced() const { return data != nullptr; }
+    inline bool isAlloced() const { return ptr() != nullptr; }
     inline const LayerParams& getParams() const { return params; }
-    inline const void* raw() const { return data.get(); }
-    inline void* raw() { return data.get(); }
+    inline const void* raw() const { return ptr(); }
+    inline void* raw() { return ptr(); }
+
+    // Use caller-owned memory of params.byte_size() bytes instead of an owned buffer, e.g. a shared-memory request
+    // slot read in place. The memory is never freed here and must outlive every use of this LayerData
+    inline void setView(void* memory) {
+        data.reset();
+        view = (char*)memory;
+    }
 
     
     template <typename T> void boundsCheck(unsigned int flat_index) const {
@@ -79,17 +129,17 @@ class LayerData {
     // Get the data pointer and cast it
     template <typename T> T& get(unsigned int flat_index) {
         boundsCheck<T>(flat_index);
-        return ((T*)data.get())[flat_index];
+        return ((T*)ptr())[flat_index];
     }
 
     template <typename T> T get(unsigned int flat_index) const {
         boundsCheck<T>(flat_index);
-        return ((T*)data.get())[flat_index];
+        return ((T*)ptr())[flat_index];
     }
 
     // Allocate data values
     inline void allocData() {
-        if (data) return;
+        if (isAlloced()) return;
         data.reset((char*)(new ui64[(params.byte_size() + 7)/8])); // Assume elementSize <= sizeof(u64) for alignment
     }
 
@@ -99,13 +149,22 @@ class LayerData {
 
     // Clean up data values
     inline void freeData() {
-        if (!data) return;
+        view = nullptr;
         data.reset();
     }
 
-    // Get the max difference between two Layer Data arrays
+    // Change the element size or shape (frees the current data)
+    inline void setParams(const LayerParams& newParams) {
+        freeData();
+        params = newParams;
+    }
+
+    // Get the cosine similarity between two Layer Data arrays
     template <typename T> float compare(const LayerData& other) const;
 
+    // Get max-abs, mean-abs and cosine error between two Layer Data arrays in one pass
+    template <typename T> CompareStats compareStats(const LayerData& other) const;
+
     // Compare within an Epsilon to ensure layer datas are similar within reason
     template <typename T, typename T_EP = float> bool compareWithin(const LayerData& other, const T_EP epsilon = Config::EPSILON) const;
 
@@ -113,18 +172,49 @@ class LayerData {
     template <typename T, typename T_EP = float> bool compareWithinPrint(const LayerData& other, const T_EP epsilon = Config::EPSILON) const;
 
    private:
+    inline char* ptr() const { return view ? view : data.get(); }
+
     LayerParams params;
     std::unique_ptr<char[]> data;
+    char* view = nullptr;  // setView memory, takes the place of data
 };
 
 // Base class all layers extend from
 class Layer {
    public:
-    // Inference Type
-    enum class InfType { NAIVE, THREADED, TILED, SIMD };
+    // Inference Type (ACCEL offloads int8 Conv/Dense to the MAC accelerator emulator, other layers run naive)
+    enum class InfType { NAIVE, THREADED, TILED, SIMD, ACCEL };
 
     // Layer Type
-    enum class LayerType { NONE, CONVOLUTIONAL, DENSE, SOFTMAX, MAX_POOLING };
+    enum class LayerType { NONE, CONVOLUTIONAL, DENSE, SOFTMAX, MAX_POOLING, FLATTEN, CONVERT, CLASSIFIER_HEAD };
+
+    // Numeric format a layer computes in and writes its output as
+    // FP16 and BF16 only change the weight storage, activations stay fp32
+    enum class Precision { FP32, FP16, BF16, FIXED, INT8 };
+
+    // Printable name of a layer type (used by logging and profiling output)
+    static const char* typeName(LayerType lType);
+
+    // Printable name of a precision and its inverse (throws on unknown names)
+    static const char* precisionName(Precision precision);
+    static Precision parsePrecision(const std::string& name);
+
+    // Format of the activations a layer in a precision exchanges (FP16/BF16 layers exchange FP32)
+    static Precision activationFormat(Precision precision);
+
+    // Bytes per activation element in a precision
+    static std::size_t elementSize(Precision precision);
+
+    // How fp32 activations are kept in memory between two layers: as is, as IEEE half, or as uint8 with the
+    // layer's quantization. Producers round in their epilogue and consumers widen on load
+    enum class Storage { FP32, FP16, U8 };
+
+    // Printable name of a storage format and its inverse (throws on unknown names)
+    static const char* storageName(Storage storage);
+    static Storage parseStorage(const std::string& name);
+
+    // Bytes per activation element in a storage format
+    static std::size_t storageSize(Storage storage);
 
    public:
     // Contructors
@@ -138,9 +228,51 @@ class Layer {
     const LayerParams& getOutputParams() const { return outParams; }
     LayerData& getOutputData() const { return outData; }
     LayerType getLType() const { return lType; }
+    const std::string& getName() const { return name; }
+    void setName(const std::string& layerName) { name = layerName; }
     bool isOutputBufferAlloced() const { return outData.isAlloced(); }
     bool checkDataInputCompatibility(const LayerData& data) const;
 
+    // Precision must be chosen before allocLayer() since reduced precision weights are converted at load
+    // Setting it also sets the element size of the input and output to that of the precision
+    Precision getPrecision() const { return precision; }
+    void setPrecision(Precision p);
+    virtual bool supportsPrecision(Precision p) const { return p == Precision::FP32; }
+
+    // Storage of the input and output activations, set after the precision (which resets it to fp32)
+    Storage getInputStorage() const { return inStorage; }
+    Storage getOutputStorage() const { return outStorage; }
+    void setStorage(Storage in, Storage out);
+    virtual bool supportsStorage(Storage s) const { return s == Storage::FP32; }
+
+    // Layout of the input and output activations, NHWC unless Model::setPrecisionPlan blocks the layer (set after the
+    // storage, reset by the precision)
+    Layout getInputLayout() const { return inParams.layout; }
+    Layout getOutputLayout() const { return outParams.layout; }
+    void setLayout(Layout in, Layout out);
+    virtual bool supportsLayout(Layout in, Layout out) const { return in == Layout::NHWC && out == Layout::NHWC; }
+
+    // Quantization of the int8 input and output activations (set by Model::setPrecisionPlan from a calibration)
+    // U8 stored activations use the same parameters
+    const QuantParams& getInputQuant() const { return inQuant; }
+    const QuantParams& getOutputQuant() const { return outQuant; }
+    void setQuant(const QuantParams& in, const QuantParams& out) {
+        inQuant = in;
+        outQuant = out;
+    }
+
+    // Multiply-accumulates performed by one inference of this layer (0 for data movement layers)
+    virtual ui64 getMACs() const { return 0; }
+
+    // Fraction of nonzero inputs seen by the last inference, negative when the layer does not measure it
+    virtual float getInputDensity() const { return -1; }
+
+    // Loop-tile schedule the TILED (fp32) or ACCEL (int8) path executes, null when the layer has none
+    virtual const TilePlan* getTilePlan() const { return nullptr; }
+
+    // Scratchpad traffic the last run of that schedule measured
+    virtual TileTraffic getTileTraffic() const { return TileTraffic(); }
+
     // Abstract/Virtual Functions
     virtual void allocLayer() {
         outData.allocData();
@@ -155,6 +287,19 @@ class Layer {
     virtual void computeTiled(const LayerData& dataIn) const = 0;
     virtual void computeSIMD(const LayerData& dataIn) const = 0;
 
+    // fp32 inference with weights stored as fp16 or bf16 (FP16 / BF16 precision)
+    virtual void computeHalf(const LayerData& dataIn, InfType infType) const;
+
+    // Fixed-point inference, dataIn and the output hold Q16.16 activations
+    virtual void computeFixed(const LayerData& dataIn, InfType infType) const;
+
+    // Quantized inference, dataIn and the output hold uint8 activations described by getInputQuant()/getOutputQuant()
+    virtual void computeInt8(const LayerData& dataIn, InfType infType) const;
+
+   protected:
+    // Change the element size of the input and output (conversion layers differ on each side)
+    void setElementSizes(std::size_t inSize, std::size_t outSize);
+
    private:
     LayerParams inParams;
 
@@ -162,6 +307,10 @@ class Layer {
     mutable LayerData outData;
 
     LayerType lType;
+    Precision precision = Precision::FP32;
+    Storage inStorage = Storage::FP32, outStorage = Storage::FP32;
+    QuantParams inQuant, outQuant;
+    std::string name;
 };
 
 // Load data values
@@ -189,9 +338,9 @@ inline void LayerData::loadData(Path filePath) {
 
 #ifdef ZEDBOARD
     UINT bytes_read = 0;
-    if ((f_read(&file, data.get(), params.byte_size(), &bytes_read) != FR_OK) || (bytes_read != params.byte_size())) {
+    if ((f_read(&file, ptr(), params.byte_size(), &bytes_read) != FR_OK) || (bytes_read != params.byte_size())) {
 #else
-    if (!file.read((char*)data.get(), params.byte_size())) {
+    if (!file.read(ptr(), params.byte_size())) {
 #endif
         throw std::runtime_error("Failed to read file data");
     }
@@ -204,7 +353,7 @@ inline void LayerData::loadData(Path filePath) {
 }
 
 
-// Load data values
+// Save data values
 inline void LayerData::saveData(Path filePath) {
     if (filePath.empty()) filePath = params.filePath;
     
@@ -217,23 +366,23 @@ inline void LayerData::saveData(Path filePath) {
     // Open our file and check for issues
 #ifdef ZEDBOARD
     FIL file;
-    if (f_open(&file, params.filePath.c_str(), FA_CREATE_ALWAYS | FA_WRITE) == FR_OK) { // Open our file on the SD card
+    if (f_open(&file, filePath.c_str(), FA_CREATE_ALWAYS | FA_WRITE) == FR_OK) { // Open our file on the SD card
 #else
-    std::ifstream file(params.filePath, std::ios::binary);  // Create and open our file
+    std::ofstream file(filePath, std::ios::binary);  // Create and open our file
     if (file.is_open()) {
 #endif
-        std::cout << "Opened binary file " << params.filePath << std::endl;
+        std::cout << "Opened binary file " << filePath << " for writing" << std::endl;
     } else {
-        throw std::runtime_error("Failed to open binary file: " + params.filePath);
+        throw std::runtime_error("Failed to open binary file: " + filePath);
     }
 
 #ifdef ZEDBOARD
     UINT bytes_written = 0;
-    if ((f_write(&file, data.get(), params.byte_size(), &bytes_written) != FR_OK) || (bytes_written != params.byte_size())) {
+    if ((f_write(&file, ptr(), params.byte_size(), &bytes_written) != FR_OK) || (bytes_written != params.byte_size())) {
 #else
-    if (!file.read((char*)data.get(), params.byte_size())) {
+    if (!file.write(ptr(), params.byte_size())) {
 #endif
-        throw std::runtime_error("Failed to read file data");
+        throw std::runtime_error("Failed to write file data");
     }
 
 #ifdef ZEDBOARD
@@ -243,8 +392,10 @@ inline void LayerData::saveData(Path filePath) {
 #endif
 }
 
-// Get the max difference between two Layer Data arrays
-template <typename T> float LayerData::compare(const LayerData& other) const {
+// Error metrics between two Layer Data arrays in a single pass
+// Sums are kept in COMPARE_LANES independent float lanes (so the loop vectorizes without -ffast-math) and
+// folded into double precision every COMPARE_BLOCK elements to bound rounding error
+template <typename T> CompareStats LayerData::compareStats(const LayerData& other) const {
     LayerParams aParams = getParams();
     LayerParams bParams = other.getParams();
 
@@ -253,6 +404,10 @@ template <typename T> float LayerData::compare(const LayerData& other) const {
         throw std::runtime_error("Comparison between two LayerData arrays with different element size (and possibly data types) is not advised (" + std::to_string(aParams.elementSize)
                   + " and " + std::to_string(bParams.elementSize) + ")\n");
     }
+    if (aParams.layout != bParams.layout) {
+        throw std::runtime_error(std::string("LayerData arrays must have the same layout to be compared (") + layoutName(aParams.layout) +
+                                 " and " + layoutName(bParams.layout) + ")");
+    }
     if (aParams.dims.size() != bParams.dims.size()) {
         throw std::runtime_error("LayerData arrays must have the same number of dimentions");
     }
@@ -264,55 +419,73 @@ template <typename T> float LayerData::compare(const LayerData& other) const {
         }
     }
 
-    size_t flat_count = params.flat_count();
-
-
-    
-
-    
-    // //MAXIMUM DIFFERENCE
-    // float max_diff = 0;
-
-    // T* data1 = (T*)data.get();
-    // T* data2 = (T*)other.data.get();
-    // // Recurse as needed into each array
-    // for (std::size_t i = 0; i < flat_count; i++) {
-    //     float curr_diff = fabsf(data1[i] - data2[i]);
-
-    //     // Update our max difference if it is larger
-    //     if (curr_diff > max_diff) {
-    //         max_diff = curr_diff;
-    //     }
-    // }
-
-    // return max_diff;
+    constexpr std::size_t COMPARE_LANES = 8;
+    constexpr std::size_t COMPARE_BLOCK = 1024;
 
+    const size_t flat_count = params.flat_count();
+    const size_t lane_count = flat_count - flat_count % COMPARE_LANES;
+    const T* a_vector = (const T*)ptr();
+    const T* b_vector = (const T*)other.ptr();
 
-    //MODIFIED LENGTH WEIGHTED COSINE SIMILARITY
     double dot_product = 0;
     double a_magnitude_sq = 0;
     double b_magnitude_sq = 0;
-    
+    double abs_sum = 0;
+    float max_lanes[COMPARE_LANES] = {};
+
+    for (std::size_t block = 0; block < lane_count; block += COMPARE_BLOCK) {
+        const std::size_t block_end = std::min(lane_count, block + COMPARE_BLOCK);
+        float dot_lanes[COMPARE_LANES] = {}, a_lanes[COMPARE_LANES] = {}, b_lanes[COMPARE_LANES] = {}, abs_lanes[COMPARE_LANES] = {};
+
+        for (std::size_t i = block; i < block_end; i += COMPARE_LANES) {
+            for (std::size_t l = 0; l < COMPARE_LANES; l++) {
+                const float a = a_vector[i + l], b = b_vector[i + l];
+                const float diff = std::fabs(a - b);
+                dot_lanes[l] += a * b;
+                a_lanes[l] += a * a;
+                b_lanes[l] += b * b;
+                abs_lanes[l] += diff;
+                max_lanes[l] = diff > max_lanes[l] ? diff : max_lanes[l];
+            }
+        }
 
-    T* a_vector = (T*)data.get();
-    T* b_vector = (T*)other.data.get();
-    // Recurse as needed into each array
-    for (std::size_t i = 0; i < flat_count; i++) {
-        a_magnitude_sq += a_vector[i] * a_vector[i];
-        b_magnitude_sq += b_vector[i] * b_vector[i];
-        dot_product += a_vector[i] * b_vector[i];
+        for (std::size_t l = 0; l < COMPARE_LANES; l++) {
+            dot_product += dot_lanes[l];
+            a_magnitude_sq += a_lanes[l];
+            b_magnitude_sq += b_lanes[l];
+            abs_sum += abs_lanes[l];
+        }
     }
 
-    float cosine_similarity = 0;
+    CompareStats stats;
+    for (std::size_t l = 0; l < COMPARE_LANES; l++) stats.maxAbs = std::max(stats.maxAbs, max_lanes[l]);
+
+    // Remainder that does not fill a whole set of lanes
+    for (std::size_t i = lane_count; i < flat_count; i++) {
+        const float a = a_vector[i], b = b_vector[i];
+        const float diff = std::fabs(a - b);
+        dot_product += a * b;
+        a_magnitude_sq += a * a;
+        b_magnitude_sq += b * b;
+        abs_sum += diff;
+        stats.maxAbs = std::max(stats.maxAbs, diff);
+    }
+
+    stats.meanAbs = flat_count ? abs_sum / flat_count : 0;
     if (a_magnitude_sq == 0 && b_magnitude_sq == 0){
         std::cout << "Zero Magnitude Vector Comparison" << std::endl;
     }
     else {
         // Correct cosine similarity formula: cos(θ) = (A·B) / (||A|| * ||B||)
-        cosine_similarity = dot_product / (std::sqrt(a_magnitude_sq) * std::sqrt(b_magnitude_sq));
+        stats.cosine = dot_product / (std::sqrt(a_magnitude_sq) * std::sqrt(b_magnitude_sq));
     }
-    
-    return cosine_similarity;
+
+    return stats;
+}
+
+// Get the cosine similarity between two Layer Data arrays
+template <typename T> float LayerData::compare(const LayerData& other) const {
+    return compareStats<T>(other).cosine;
 }
 
 // Compare within an Epsilon to ensure layer datas are similar within reason
@@ -335,8 +508,9 @@ template <typename T, typename T_EP> bool LayerData::compareWithinPrint(const La
     // return result;
 
     //LENGTH WEIGHTED COSINE SIMILARITY
-    float cosine_similarity = compare<T>(other);
-    bool result = (compare<T>(other) > 0.8);
+    CompareStats stats = compareStats<T>(other);
+    float cosine_similarity = stats.cosine;
+    bool result = (cosine_similarity > Config::COSINE_SIMILARITY_THRESHOLD);
 
     std::cout 
         << "Comparing Outputs (Cosine Similarity): " 
@@ -344,7 +518,8 @@ template <typename T, typename T_EP> bool LayerData::compareWithinPrint(const La
         << " " << clamp(cosine_similarity * 100.0, 0.0, 100.0) << "% "
         << " ("
         << cosine_similarity
-        << ")\n";
+        << "), max abs error " << stats.maxAbs
+        << ", mean abs error " << stats.meanAbs << "\n";
     
     return result;
 }
@@ -3,8 +3,12 @@
 #include <iostream>
 #include <algorithm>
 #include <thread>
+#include <limits>
 #include <vector>
 
+#include "../FixedPoint.h"
+#include "../Pooling.h"
+#include "../ThreadPool.h"
 #include "../Types.h"
 #include "../Utils.h"
 #include "Layer.h"
@@ -13,6 +17,37 @@ namespace ML
 {
 
     void MaxPoolingLayer::computeNaive(const LayerData &dataIn) const
+    {
+        withStorageCodecs(*this, PoolKernel{*this, dataIn, 0, getOutputParams().dims[0]});
+    }
+
+    // Fixed point pooling (output rows split across the shared pool when asked to, otherwise serial)
+    void MaxPoolingLayer::computeFixed(const LayerData &dataIn, InfType infType) const
+    {
+        const FixedAct lowest = FixedAct::from_base(std::numeric_limits<i32>::min());
+        if (infType == InfType::THREADED) {
+            ThreadPool::shared().parallelFor(0, getOutputParams().dims[0], [&](size_t hBegin, size_t hEnd) {
+                pool(dataIn, RawStorage<FixedAct>(), RawStorage<FixedAct>(), lowest, hBegin, hEnd);
+            });
+            return;
+        }
+        pool(dataIn, RawStorage<FixedAct>(), RawStorage<FixedAct>(), lowest, 0, getOutputParams().dims[0]);
+    }
+
+    // Int8 pooling (output rows split across the shared pool when asked to, otherwise serial)
+    void MaxPoolingLayer::computeInt8(const LayerData &dataIn, InfType infType) const
+    {
+        if (infType == InfType::THREADED) {
+            ThreadPool::shared().parallelFor(0, getOutputParams().dims[0], [&](size_t hBegin, size_t hEnd) {
+                pool(dataIn, RawStorage<ui8>(), RawStorage<ui8>(), ui8(0), hBegin, hEnd);
+            });
+            return;
+        }
+        pool(dataIn, RawStorage<ui8>(), RawStorage<ui8>(), ui8(0), 0, getOutputParams().dims[0]);
+    }
+
+    template <typename In, typename Out, typename T>
+    void MaxPoolingLayer::pool(const LayerData &dataIn, In in, Out out, T lowest, size_t hBegin, size_t hEnd) const
     {
         const auto &inputDims = getInputParams().dims;   // Expected: [H_in, W_in, C_in]
         const auto &outputDims = getOutputParams().dims; // Expected: [H_out, W_out, C_out]
@@ -20,25 +55,33 @@ namespace ML
 
         size_t inputHeight = inputDims[0];
         size_t inputWidth = inputDims[1];
-        size_t inputChannels = inputDims[2];
 
         size_t outputHeight = outputDims[0];
         size_t outputWidth = outputDims[1];
-        size_t outputChannels = outputDims[2];
 
         size_t poolHeight = poolDims[0];
         size_t poolWidth = poolDims[1];
 
-        LayerData& output = getOutputData();
+        // All channels in one block for NHWC, [C/b] blocks of b for the blocked layouts (padding pools to zero)
+        size_t block = getInputParams().channelBlock();
+        size_t blocks = getInputParams().channelBlocks();
+
+        const typename In::type* input = (const typename In::type*)dataIn.raw();
+        typename Out::type* output = (typename Out::type*)getOutputData().raw();
+
+        thread_local std::vector<T> maxVals;
+        maxVals.resize(block);
 
         // Max pooling computation
-        for (size_t c = 0; c < outputChannels; c++)
+        for (size_t cb = 0; cb < blocks; cb++)
         {
-            for (size_t h_out = 0; h_out < outputHeight; h_out++)
+            const typename In::type* inPlane = input + cb * inputHeight * inputWidth * block;
+            typename Out::type* outPlane = output + cb * outputHeight * outputWidth * block;
+            for (size_t h_out = hBegin; h_out < hEnd; h_out++)
             {
                 for (size_t w_out = 0; w_out < outputWidth; w_out++)
                 {
-                    fp32 maxVal = -INFINITY;
+                    std::fill(maxVals.begin(), maxVals.end(), lowest);
 
                     // Pool over the kernel region
                     for (size_t pool_h = 0; pool_h < poolHeight; pool_h++)
@@ -51,45 +94,73 @@ namespace ML
                             // Check bounds
                             if (h_in < inputHeight && w_in < inputWidth)
                             {
-                                size_t inputIdx = h_in * (inputWidth * inputChannels) +
-                                                  w_in * inputChannels +
-                                                  c;
-
-                                fp32 val = dataIn.get<fp32>(inputIdx);
-                                if (val > maxVal)
+                                const typename In::type* x = inPlane + (h_in * inputWidth + w_in) * block;
+                                for (size_t c = 0; c < block; c++)
                                 {
-                                    maxVal = val;
+                                    T val = in.load(x[c]);
+                                    if (val > maxVals[c])
+                                    {
+                                        maxVals[c] = val;
+                                    }
                                 }
                             }
                         }
                     }
 
-                    size_t outputIdx = h_out * (outputWidth * outputChannels) +
-                                       w_out * outputChannels +
-                                       c;
-                    
-                    output.get<fp32>(outputIdx) = maxVal;
+                    typename Out::type* y = outPlane + (h_out * outputWidth + w_out) * block;
+                    for (size_t c = 0; c < block; c++) y[c] = out.store(maxVals[c]);
                 }
             }
         }
     }
 
+    void MaxPoolingLayer::poolRowsVectorized(const LayerData &dataIn, size_t hBegin, size_t hEnd) const
+    {
+        const auto &inputDims = getInputParams().dims;   // [H_in, W_in, C_in]
+        const auto &outputDims = getOutputParams().dims; // [H_out, W_out, C_out]
+        const auto &poolDims = getPoolParams().dims;     // [pool_h, pool_w]
+        const size_t block = getInputParams().channelBlock();
+        const size_t inPlane = inputDims[0] * inputDims[1] * block, outPlane = outputDims[0] * outputDims[1] * block;
+
+        const fp32* input = (const fp32*)dataIn.raw();
+        fp32* output = (fp32*)getOutputData().raw();
+        for (size_t cb = 0; cb < getInputParams().channelBlocks(); cb++)
+        {
+            maxPoolTile(input + cb * inPlane + hBegin * poolDims[0] * inputDims[1] * block, (hEnd - hBegin) * poolDims[0], inputDims[1],
+                        block, poolDims[0], poolDims[1], output + cb * outPlane + hBegin * outputDims[1] * block);
+        }
+    }
+
+    // Output rows split across the shared pool, each range vectorized (stored fp16/uint8 activations pool naive)
     void MaxPoolingLayer::computeThreaded(const LayerData& dataIn) const {
-        // For simplicity, use naive implementation with thread hints
-        // TODO: Implement actual threading
-        computeNaive(dataIn);
+        ThreadPool::shared().parallelFor(0, getOutputParams().dims[0], [&](size_t hBegin, size_t hEnd) {
+            if (isVectorizable()) {
+                poolRowsVectorized(dataIn, hBegin, hEnd);
+            } else {
+                withStorageCodecs(*this, PoolKernel{*this, dataIn, hBegin, hEnd});
+            }
+        });
     }
 
+    // Bands of output rows whose input fits the tile budget, one after the other
     void MaxPoolingLayer::computeTiled(const LayerData& dataIn) const {
-        // For simplicity, use naive implementation 
-        // TODO: Implement tiled processing
-        computeNaive(dataIn);
+        if (!isVectorizable()) {
+            computeNaive(dataIn);
+            return;
+        }
+        const size_t outputHeight = getOutputParams().dims[0];
+        const size_t bandBytes = getPoolParams().dims[0] * getInputParams().dims[1] * getInputParams().channelBlocks() *
+                                 getInputParams().channelBlock() * sizeof(fp32);
+        const size_t rows = std::max<size_t>(1, getTileBudget() / bandBytes);
+        for (size_t hBegin = 0; hBegin < outputHeight; hBegin += rows) poolRowsVectorized(dataIn, hBegin, std::min(outputHeight, hBegin + rows));
     }
 
     void MaxPoolingLayer::computeSIMD(const LayerData& dataIn) const {
-        // For simplicity, use naive implementation
-        // TODO: Implement SIMD optimized max pooling
-        computeNaive(dataIn);
+        if (!isVectorizable()) {
+            computeNaive(dataIn);
+            return;
+        }
+        poolRowsVectorized(dataIn, 0, getOutputParams().dims[0]);
     }
 
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../Activations.h"
 #include "../Types.h"
 #include "../Utils.h"
 #include "Layer.h"
@@ -14,6 +15,20 @@ class MaxPoolingLayer : public Layer {
     // Getters
     const LayerParams& getPoolParams() const { return poolParam; }
 
+    // Max is order preserving, so fixed point and int8 pool the raw values directly (int8 keeps the input quantization)
+    virtual bool supportsPrecision(Precision p) const override {
+        return p == Precision::FP32 || p == Precision::FIXED || p == Precision::INT8;
+    }
+
+    // Stored fp16/uint8 activations are widened, compared and rounded back (exact when both sides share the storage)
+    virtual bool supportsStorage(Storage s) const override { return s == Storage::FP32 || getPrecision() == Precision::FP32; }
+
+    // Pools each stored channel block on its own, so fp32 layers keep any layout (blocked only with fp32 activations)
+    virtual bool supportsLayout(Layout in, Layout out) const override {
+        return in == out && (in == Layout::NHWC || (getPrecision() == Precision::FP32 && getInputStorage() == Storage::FP32 &&
+                                                    getOutputStorage() == Storage::FP32));
+    }
+
     // Allocate all resources needed for the layer
     virtual void allocLayer() override {
         Layer::allocLayer();
@@ -31,8 +46,34 @@ class MaxPoolingLayer : public Layer {
     virtual void computeThreaded(const LayerData& dataIn) const override;
     virtual void computeTiled(const LayerData& dataIn) const override;
     virtual void computeSIMD(const LayerData& dataIn) const override;
+    virtual void computeFixed(const LayerData& dataIn, InfType infType) const override;
+    virtual void computeInt8(const LayerData& dataIn, InfType infType) const override;
 
    private:
+    // Pooling of output rows [hBegin, hEnd) over the values loaded by the In codec (of type T), starting each window
+    // from `lowest`, one stored channel block at a time with the channels of a pixel innermost
+    template <typename In, typename Out, typename T>
+    ML_ISA_INLINE void pool(const LayerData& dataIn, In in, Out out, T lowest, std::size_t hBegin, std::size_t hEnd) const;
+
+    // fp32 pooling of output rows [hBegin, hEnd) bound to the storage codecs picked at run time
+    struct PoolKernel {
+        const MaxPoolingLayer& layer;
+        const LayerData& dataIn;
+        std::size_t hBegin, hEnd;
+
+        template <typename In, typename Out> ML_ISA_INLINE void operator()(In in, Out out) const {
+            layer.pool(dataIn, in, out, -INFINITY, hBegin, hEnd);
+        }
+    };
+
+    // Whether the vector kernel applies (fp32 activations stored as fp32)
+    bool isVectorizable() const {
+        return getPrecision() == Precision::FP32 && getInputStorage() == Storage::FP32 && getOutputStorage() == Storage::FP32;
+    }
+
+    // Output rows [hBegin, hEnd) of every channel plane through maxPoolTile
+    void poolRowsVectorized(const LayerData& dataIn, std::size_t hBegin, std::size_t hEnd) const;
+
     LayerParams poolParam; // Stores pool size parameters [pool_h, pool_w]
 };
 